@@ -7,6 +7,8 @@ local mainStats = nil
 local dispatcherStats = nil
 local render = nil
 local atlas = nil
+local thingTextures = nil
+local draws = nil
 local adaptiveRender = nil
 local slowMain = nil
 local slowRender = nil
@@ -44,6 +46,8 @@ function init()
   dispatcherStats = statsWindow:recursiveGetChildById('dispatcherStats')
   render = statsWindow:recursiveGetChildById('render')
   atlas = statsWindow:recursiveGetChildById('atlas')
+  thingTextures = statsWindow:recursiveGetChildById('thingTextures')
+  draws = statsWindow:recursiveGetChildById('draws')
   packets = statsWindow:recursiveGetChildById('packets')
   adaptiveRender = statsWindow:recursiveGetChildById('adaptiveRender')
   slowMain = statsWindow:recursiveGetChildById('slowMain')
@@ -57,6 +61,7 @@ function init()
 
   updateEvent = scheduleEvent(update, 2000)
   monitorEvent = scheduleEvent(monitor, 1000)
+  updateLuaStats()
 end
 
 function terminate()
@@ -67,10 +72,18 @@ function terminate()
 
   removeEvent(updateEvent)
   removeEvent(monitorEvent)
+  g_stats.setEnabled(StatsLua, false)
 end
 
 function onClose()
   statsButton:setOn(false)
+  updateLuaStats()
+end
+
+-- lua calls are only timed when somebody looks at them
+function updateLuaStats()
+  local reported = Services and Services.stats ~= nil and Services.stats:len() > 3
+  g_stats.setEnabled(StatsLua, statsButton:isOn() or reported)
 end
 
 function toggle()
@@ -83,6 +96,7 @@ function toggle()
     statsWindow:focus()
     statsButton:setOn(true)
   end
+  updateLuaStats()
 end
 
 function monitor()
@@ -127,6 +141,9 @@ function sendStats()
       fps = g_app.getFps(),
       maxFps = g_app.getMaxFps(),
       atlas = g_atlas.getStats(),
+      thingTextures = g_things.getTexturesStats(false),
+      draws = g_stats.getDrawsInfo(false),
+      events = g_stats.getEventsInfo(false),
       classic = tostring(g_settings.getBoolean("classicView")),
       fullscreen = tostring(g_window.isFullscreen()),
       vsync = tostring(g_settings.getBoolean("vsync")),
@@ -194,6 +211,8 @@ function update()
     local adaptive = "Adaptive: " .. g_adaptiveRenderer.getLevel() .. " | " .. g_adaptiveRenderer.getDebugInfo()
     adaptiveRender:setText(adaptive)
     atlas:setText("Atlas: " .. g_atlas.getStats())
+    thingTextures:setText("Thing textures\n" .. g_things.getTexturesStats(true) .. "\n" .. g_stats.getThingTexturesInfo(true))
+    draws:setText("Draws\n" .. g_stats.getDrawsInfo(true) .. "\nEvents\n" .. g_stats.getEventsInfo(true))
   elseif iter == 2 then
     render:setText(g_stats.get(2, 10, true))  
     mainStats:setText(g_stats.get(1, 5, true))
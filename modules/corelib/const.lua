@@ -14,6 +14,14 @@ LogWarning = 2
 LogError = 3
 LogFatal = 4
 
+StatsGeneral = 0
+StatsMain = 1
+StatsRender = 2
+StatsDispatcher = 3
+StatsLua = 4
+StatsLuaCallback = 5
+StatsPackets = 6
+
 MouseFocusReason = 0
 KeyboardFocusReason = 1
 ActiveFocusReason = 2
@@ -338,4 +346,12 @@ AlignItems = {
   START = 0,
   STRETCH = 1,
   CENTER = 2
+}
+
+AdaptiveStages = {
+  Map = 0,
+  Texts = 1,
+  UI = 2,
+  Light = 3,
+  GPU = 4
 }
\ No newline at end of file
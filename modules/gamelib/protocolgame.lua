@@ -5,11 +5,10 @@ local extendedJSONData = {}
 local maxPacketSize = 65000
 
 function ProtocolGame:onOpcode(opcode, msg)
-  for i, callback in pairs(opcodeCallbacks) do
-    if i == opcode then
-      callback(self, msg)
-      return true
-    end
+  local callback = opcodeCallbacks[opcode]
+  if callback then
+    callback(self, msg)
+    return true
   end
   return false
 end
@@ -50,10 +49,12 @@ function ProtocolGame.registerOpcode(opcode, callback)
   end
 
   opcodeCallbacks[opcode] = callback
+  ProtocolGame.setOpcodeInterest(opcode, true)
 end
 
 function ProtocolGame.unregisterOpcode(opcode)
   opcodeCallbacks[opcode] = nil
+  ProtocolGame.setOpcodeInterest(opcode, false)
 end
 
 function ProtocolGame.registerExtendedOpcode(opcode, callback)
@@ -0,0 +1,134 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Atlas replay. Replays a deterministic sequence of image hashes and sizes through the block
+// allocator of the main atlas, without textures: a map scrolled a few tiles per frame, a fixed
+// interface and bigger images like outfits and effects that come and go. The sequence only depends
+// on the arguments, with the default ones the hits, misses, evictions and failures are compared to
+// the expected numbers and it exits with an error when they differ. The atlas must never reset.
+// usage: otclient_atlas [frames] [atlas size]
+
+#include <framework/graphics/atlas.h>
+#include <framework/stdext/time.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+struct Expected {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t failures;
+};
+
+// the numbers of the default arguments, update them when the replay or the allocator changes on purpose
+static const int defaultFrames = 5000;
+static const int defaultSize = 4096;
+static const Expected expected = { 4688662, 28802, 24801, 166 };
+
+static Size imageSize(uint64_t hash)
+{
+    // mostly single tiles, some 2x2 things and a few big ones
+    if (hash % 50 == 0)
+        return Size(256, 256);
+    if (hash % 10 == 0)
+        return Size(128, 96);
+    if (hash % 4 == 0)
+        return Size(64, 64);
+    return Size(32, 32);
+}
+
+int main(int argc, const char* argv[])
+{
+    const int frames = argc > 1 ? std::atoi(argv[1]) : defaultFrames;
+    const int size = argc > 2 ? std::atoi(argv[2]) : defaultSize;
+    if (frames <= 0 || (size != 2048 && size != 4096 && size != 8192)) {
+        std::cout << "usage: " << argv[0] << " [frames] [atlas size (2048, 4096 or 8192)]" << std::endl;
+        return 1;
+    }
+
+    Atlas atlas;
+    atlas.initBlocks(size);
+
+    std::mt19937 gen(1234);
+    std::vector<uint64_t> effects;
+    uint64_t lookups = 0;
+    bool draw;
+
+    stdext::timer timer;
+    for (int frame = 0; frame < frames; ++frame) {
+        atlas.newFrame();
+
+        // the visible map, 18x14 tiles with a few things each, walking a tile every 8 frames
+        int scroll = frame / 8;
+        for (int y = 0; y < 14; ++y) {
+            for (int x = 0; x < 18; ++x) {
+                uint64_t tile = (uint64_t)(y * 4099 + x + scroll) * 7;
+                for (uint64_t thing = 0; thing < 3; ++thing) {
+                    uint64_t hash = (tile + thing) * 2654435761ULL % 1000003;
+                    atlas.cache(hash, imageSize(hash), draw);
+                    lookups += 1;
+                }
+            }
+        }
+
+        // the interface, always the same images
+        for (uint64_t hash = 2000000; hash < 2000150; ++hash) {
+            atlas.cache(hash, imageSize(hash), draw);
+            lookups += 1;
+        }
+
+        // effects and creatures, they stay on screen for a while
+        if (gen() % 100 < 30)
+            effects.push_back(3000000 + gen() % 20000);
+        if (effects.size() > 40 || (!effects.empty() && gen() % 100 < 20))
+            effects.erase(effects.begin());
+        for (uint64_t hash : effects) {
+            atlas.cache(hash, imageSize(hash), draw);
+            lookups += 1;
+        }
+    }
+    ticks_t elapsed = std::max<ticks_t>(1, timer.elapsed_micros());
+
+    Expected result = { atlas.getHits(), atlas.getMisses(), atlas.getEvictions(), atlas.getFailures() };
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << lookups << " lookups in " << elapsed / 1000.0 << " ms, " << elapsed * 1000.0 / lookups << " ns/lookup\n";
+    std::cout << "hits " << result.hits << " (" << result.hits * 100.0 / lookups << "%), misses " << result.misses
+              << ", evictions " << result.evictions << ", failures " << result.failures
+              << ", resets " << atlas.getResets() << "\n";
+
+    bool failed = false;
+    if (atlas.getResets() != 0) {
+        std::cout << "the atlas was reset, it should only evict" << std::endl;
+        failed = true;
+    }
+    if (frames == defaultFrames && size == defaultSize &&
+        (result.hits != expected.hits || result.misses != expected.misses ||
+         result.evictions != expected.evictions || result.failures != expected.failures)) {
+        std::cout << "expected hits " << expected.hits << ", misses " << expected.misses << ", evictions "
+                  << expected.evictions << ", failures " << expected.failures << std::endl;
+        failed = true;
+    }
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Draw queue benchmark. Records a frame like the render loop does, the map floors into their own
+// queues appended to the frame queue and then the interface with clipped windows, and replays it
+// up to the gl calls: the draw order batched by texture. Every command must be drawn exactly once.
+// usage: otclient_drawqueue [frames]
+
+#include <framework/graphics/drawqueue.h>
+#include <framework/graphics/texture.h>
+#include <framework/stdext/time.h>
+
+#include "allocations.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+struct Frame {
+    ticks_t record = 0;
+    ticks_t replay = 0;
+    uint64_t allocations = 0;
+    size_t commands = 0;
+};
+
+static void recordFloor(DrawQueue& queue, const std::vector<TexturePtr>& sprites, int floor, int frame)
+{
+    // 18x14 tiles, a ground and a couple of things on each, some creatures
+    for (int y = 0; y < 14; ++y) {
+        for (int x = 0; x < 18; ++x) {
+            Rect dest(x * 32 - floor * 32, y * 32 - floor * 32, 32, 32);
+            int tile = (x + frame / 8) * 31 + y * 17 + floor * 7;
+            queue.addTexturedRect(dest, sprites[tile % sprites.size()], Rect((tile % 12) * 32, 0, 32, 32));
+            for (int thing = 0; thing < tile % 3; ++thing)
+                queue.addTexturedRect(dest, sprites[(tile + thing * 5) % sprites.size()], Rect(0, (thing + 1) * 32, 32, 32));
+            if (tile % 23 == 0)
+                queue.addOutfit(Rect(dest.topLeft() - Point(16, 16), Size(64, 64)), sprites[tile % 4], Rect(64, 64, 64, 64), Point(0, 64), tile);
+        }
+    }
+}
+
+static void recordInterface(DrawQueue& queue, const std::vector<TexturePtr>& sprites, const TexturePtr& skin)
+{
+    // windows with a background, a border and a clipped list of items
+    for (int window = 0; window < 6; ++window) {
+        Rect rect(600, window * 100, 180, 96);
+        queue.addTexturedRect(rect, skin, Rect(0, 0, 180, 96));
+        queue.addBoundingRect(rect, 1, Color::black);
+        size_t start = queue.size();
+        for (int item = 0; item < 20; ++item)
+            queue.addTexturedRect(Rect(rect.x() + 4 + (item % 5) * 34, rect.y() + 4 + (item / 5) * 34, 32, 32), sprites[(window + item) % sprites.size()], Rect(0, 0, 32, 32));
+        queue.setClip(start, rect);
+        queue.addFilledRect(Rect(rect.x(), rect.bottom() - 4, rect.width(), 4), Color::red);
+    }
+    queue.addLine({ Point(10, 10), Point(100, 10), Point(100, 100) }, 2, Color::green);
+}
+
+int main(int argc, const char* argv[])
+{
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 2000;
+    if (frames <= 0) {
+        std::cout << "usage: " << argv[0] << " [frames]" << std::endl;
+        return 1;
+    }
+
+    // the textures are never uploaded, only their sizes and ids are used
+    std::vector<TexturePtr> sprites;
+    for (int i = 0; i < 24; ++i)
+        sprites.push_back(std::make_shared<Texture>(Size(384, 384)));
+    sprites[5]->setCanCache(false); // drawn outside of the atlas, like big or animated images
+    TexturePtr skin = std::make_shared<Texture>(Size(256, 256));
+
+    Frame total;
+    size_t warmup = std::min(frames / 10 + 1, 100);
+    bool failed = false;
+    std::vector<uint8_t> drawn;
+    for (int frame = 0; frame < frames; ++frame) {
+        uint64_t startAllocations = countedAllocations();
+        stdext::timer timer;
+
+        std::shared_ptr<DrawQueue> queue = DrawQueue::create();
+        for (int floor = 7; floor >= 0; --floor) {
+            std::shared_ptr<DrawQueue> floorQueue = DrawQueue::create();
+            recordFloor(*floorQueue, sprites, floor, frame);
+            queue->append(*floorQueue);
+        }
+        queue->markMapPosition();
+        recordInterface(*queue, sprites, skin);
+        ticks_t record = timer.elapsed_micros();
+
+        timer.restart();
+        const std::vector<uint32_t>& order = queue->sortBatches(0, queue->size());
+        ticks_t replay = timer.elapsed_micros();
+
+        drawn.assign(queue->size(), 0);
+        for (uint32_t index : order) {
+            if (index < drawn.size())
+                drawn[index] += 1;
+        }
+        if (order.size() != queue->size() || std::count(drawn.begin(), drawn.end(), 1) != (ptrdiff_t)drawn.size()) {
+            std::cout << "frame " << frame << ": the draw order doesn't draw every command once" << std::endl;
+            failed = true;
+            break;
+        }
+
+        size_t commands = queue->size();
+        queue = nullptr;
+        if ((size_t)frame < warmup)
+            continue;
+        total.record += record;
+        total.replay += replay;
+        total.allocations += countedAllocations() - startAllocations;
+        total.commands += commands;
+    }
+
+    size_t measured = frames - std::min<size_t>(frames, warmup);
+    if (measured > 0) {
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << total.commands / measured << " commands/frame, record " << total.record / (double)measured
+                  << " us/frame, replay " << total.replay / (double)measured << " us/frame, "
+                  << total.allocations / (double)measured << " allocations/frame after " << warmup << " frames\n";
+    }
+    return failed ? 1 : 0;
+}
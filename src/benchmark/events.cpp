@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Posted events benchmark. Threads post events to a dispatcher while the main thread polls it,
+// like the network, proxy and http threads do with g_dispatcher, first to a mutex protected list
+// as the dispatcher used before and then to the lock-free posted lists.
+// usage: otclient_events [events per thread] [max threads]
+
+#include <framework/core/eventdispatcher.h>
+#include <framework/stdext/time.h>
+#include <framework/util/stats.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+// addEventEx and poll of the dispatcher before the posted lists
+class LockedEventList
+{
+public:
+    void post(const std::function<void()>& callback) {
+        auto event = std::make_shared<Event>("", callback);
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+        m_eventList.push_back(event);
+    }
+
+    void poll() {
+        std::unique_lock<std::recursive_mutex> lock(m_mutex);
+        for (int i = 0, size = m_eventList.size(); i < size; ++i) {
+            EventPtr event = m_eventList.front();
+            m_eventList.pop_front();
+            lock.unlock();
+            event->execute();
+            lock.lock();
+        }
+    }
+
+private:
+    std::list<EventPtr> m_eventList;
+    std::recursive_mutex m_mutex;
+};
+
+template<typename Post, typename Poll>
+static ticks_t run(int threads, int events, Post post, Poll poll)
+{
+    std::atomic<int> executed{0};
+    const int total = threads * events;
+
+    stdext::timer timer;
+    std::vector<std::thread> producers;
+    for (int t = 0; t < threads; ++t) {
+        producers.emplace_back([&] {
+            for (int i = 0; i < events; ++i)
+                post([&] { executed.fetch_add(1, std::memory_order_relaxed); });
+        });
+    }
+    while (executed < total)
+        poll();
+    ticks_t elapsed = std::max<ticks_t>(1, timer.elapsed_micros());
+
+    for (auto& producer : producers)
+        producer.join();
+    return elapsed;
+}
+
+int main(int argc, const char* argv[])
+{
+    const int events = argc > 1 ? std::atoi(argv[1]) : 1000000;
+    const int maxThreads = argc > 2 ? std::atoi(argv[2]) : 8;
+    if (events <= 0 || maxThreads <= 0) {
+        std::cout << "usage: " << argv[0] << " [events per thread] [max threads]" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Threads" << std::setw(16) << "locked (M/s)" << std::setw(16) << "lock-free (M/s)" << std::setw(12) << "batches"
+              << std::setw(12) << "contended" << std::setw(12) << "retries\n";
+
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        const double total = threads * (double)events;
+
+        LockedEventList locked;
+        ticks_t lockedTime = run(threads, events,
+            [&](const std::function<void()>& callback) { locked.post(callback); },
+            [&] { locked.poll(); });
+
+        g_stats.resetEvents();
+        EventDispatcher dispatcher;
+        ticks_t lockFreeTime = run(threads, events,
+            [&](const std::function<void()>& callback) { dispatcher.addEventEx("", callback); },
+            [&] { dispatcher.poll(); });
+
+        // posted|batches|max batch|contended|retries
+        std::vector<std::string> info = stdext::split(g_stats.getEventsInfo(false), "|");
+        for (auto& value : info)
+            stdext::trim(value);
+        std::cout << std::setw(7) << threads << std::setw(16) << total / lockedTime << std::setw(16) << total / lockFreeTime
+                  << std::setw(12) << info[1] << std::setw(12) << info[3] << std::setw(12) << info[4] << "\n";
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Light map benchmark. A synthetic scene of torches, creatures walking with their lights and a roof
+// covering the fields under it now and then is lit every frame three ways: every field against every
+// light as LightView did before the LightMap, with the bounded splats of a new LightMap, and
+// incrementally with the LightMap kept between frames. The incremental light map must be the same
+// as the full one in every frame.
+// usage: otclient_lightmap [frames] [torches] [creatures]
+
+#include <framework/stdext/time.h>
+#include <client/lightview.h>
+#include <client/spritemanager.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+static const Size mapSize(64, 48);
+
+// the light map as LightView::draw computed it, every light of a floor not covered reaches every field
+static void fullLightMap(std::vector<uint8_t>& pixels, const Color& globalLight, const std::vector<LightSource>& lights,
+                         const std::vector<uint8_t>& tileFloors)
+{
+    const int spriteSize = g_sprites.spriteSize();
+    pixels.resize(mapSize.area() * 4);
+    for (int y = 0; y < mapSize.height(); ++y) {
+        for (int x = 0; x < mapSize.width(); ++x) {
+            int index = y * mapSize.width() + x;
+            uint8_t* pixel = &pixels[index * 4];
+            pixel[0] = globalLight.r();
+            pixel[1] = globalLight.g();
+            pixel[2] = globalLight.b();
+            pixel[3] = 255;
+            for (const LightSource& light : lights) {
+                if (light.floor > tileFloors[index])
+                    continue;
+                float dx = x * spriteSize + spriteSize / 2 - light.pos.x;
+                float dy = y * spriteSize + spriteSize / 2 - light.pos.y;
+                float distance = std::sqrt(dx * dx + dy * dy) / spriteSize;
+                float intensity = (-distance + light.intensity) * 0.2f;
+                if (intensity < 0.01f) continue;
+                if (intensity > 1.0f) intensity = 1.0f;
+                Color lightColor = Color::from8bit(light.color) * intensity;
+                pixel[0] = std::max<uint8_t>(pixel[0], lightColor.r());
+                pixel[1] = std::max<uint8_t>(pixel[1], lightColor.g());
+                pixel[2] = std::max<uint8_t>(pixel[2], lightColor.b());
+            }
+        }
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    const int frames = argc > 1 ? std::atoi(argv[1]) : 2000;
+    const int torches = argc > 2 ? std::atoi(argv[2]) : 60;
+    const int creatures = argc > 3 ? std::atoi(argv[3]) : 12;
+    if (frames <= 0 || torches < 0 || creatures < 0) {
+        std::cout << "usage: " << argv[0] << " [frames] [torches] [creatures]" << std::endl;
+        return 1;
+    }
+
+    const int spriteSize = g_sprites.spriteSize();
+    const Color globalLight = Color::from8bit(215) * 0.25f;
+    std::mt19937 gen(1234);
+
+    std::vector<LightSource> torchLights;
+    for (int i = 0; i < torches; ++i) {
+        Point pos((gen() % mapSize.width()) * spriteSize + spriteSize / 2, (gen() % mapSize.height()) * spriteSize + spriteSize / 2);
+        torchLights.push_back(LightSource{ pos, (uint8_t)(gen() % 216), (uint8_t)(2 + gen() % 6), (uint8_t)(gen() % 4 == 0 ? 6 : 7) });
+    }
+
+    struct Walker {
+        Point pos;
+        Point step;
+        uint8_t color;
+        uint8_t intensity;
+    };
+    std::vector<Walker> walkers;
+    for (int i = 0; i < creatures; ++i) {
+        Point pos(gen() % (mapSize.width() * spriteSize), gen() % (mapSize.height() * spriteSize));
+        Point step = gen() % 2 ? Point(gen() % 2 ? 4 : -4, 0) : Point(0, gen() % 2 ? 4 : -4);
+        walkers.push_back(Walker{ pos, step, (uint8_t)(gen() % 216), (uint8_t)(1 + gen() % 4) });
+    }
+
+    // a house of 12x10 fields whose roof hides the lights below it while the player is outside
+    const Rect roof(20, 16, 12, 10);
+
+    LightMap lightMap;
+    std::vector<uint8_t> expected;
+    ticks_t fullTime = 0, splatTime = 0, incrementalTime = 0;
+    uint64_t uploadedRows = 0;
+    for (int frame = 0; frame < frames; ++frame) {
+        std::vector<uint8_t> tileFloors(mapSize.area(), 255);
+        if ((frame / 100) % 2 == 0) {
+            for (int y = roof.top(); y <= roof.bottom(); ++y) {
+                for (int x = roof.left(); x <= roof.right(); ++x)
+                    tileFloors[y * mapSize.width() + x] = 6;
+            }
+        }
+
+        std::vector<LightSource> lights = torchLights;
+        for (Walker& walker : walkers) {
+            walker.pos += walker.step;
+            if (walker.pos.x < 0 || walker.pos.y < 0 || walker.pos.x >= mapSize.width() * spriteSize || walker.pos.y >= mapSize.height() * spriteSize) {
+                walker.step = Point(-walker.step.x, -walker.step.y);
+                walker.pos += walker.step;
+            }
+            lights.push_back(LightSource{ walker.pos, walker.color, walker.intensity, 7 });
+        }
+
+        stdext::timer timer;
+        fullLightMap(expected, globalLight, lights, tileFloors);
+        fullTime += timer.elapsed_micros();
+
+        LightMap newLightMap;
+        std::vector<LightSource> newLights = lights;
+        timer.restart();
+        newLightMap.update(mapSize, globalLight, newLights, tileFloors);
+        splatTime += timer.elapsed_micros();
+
+        timer.restart();
+        lightMap.update(mapSize, globalLight, lights, tileFloors);
+        incrementalTime += timer.elapsed_micros();
+        uploadedRows += lightMap.getDirtyRows();
+
+        if (lightMap.getPixels() != expected || newLightMap.getPixels() != expected) {
+            std::cout << "the light map of frame " << frame << " isn't the full one" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << mapSize.width() << "x" << mapSize.height() << " fields, " << torches << " torches, " << creatures << " creatures\n";
+    std::cout << "every field against every light: " << fullTime / (double)frames << " us/frame\n";
+    std::cout << "bounded splats of every light: " << splatTime / (double)frames << " us/frame\n";
+    std::cout << "incremental: " << incrementalTime / (double)frames << " us/frame, "
+              << uploadedRows / (double)frames << " of " << mapSize.height() << " rows uploaded per frame\n";
+    return 0;
+}
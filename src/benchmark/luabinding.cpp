@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Lua binding benchmark. Calls methods, reads and writes fields and calls bound C++ functions of a
+// LuaObject from lua in tight loops, like ui and bot scripts do with widgets and creatures.
+// usage: otclient_luabinding [iterations]
+
+#include <framework/core/application.h>
+#include <framework/core/eventdispatcher.h>
+#include <framework/core/resourcemanager.h>
+#include <framework/luaengine/luainterface.h>
+#include <framework/stdext/time.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+// every benchmark gets the object and the number of iterations
+static const char* script = R"(
+local bench = {}
+
+function ScheduledEvent:luaMethod()
+  return 1
+end
+
+bench["lua method call"] = function(obj, n)
+  for i = 1, n do obj:luaMethod() end
+end
+
+bench["c++ method call"] = function(obj, n)
+  for i = 1, n do obj:isCanceled() end
+end
+
+bench["c++ base class method call"] = function(obj, n)
+  for i = 1, n do obj:delay() end
+end
+
+bench["c++ getter read"] = function(obj, n)
+  for i = 1, n do local v = obj.boundDelay end
+end
+
+bench["field read"] = function(obj, n)
+  obj.field = 1
+  for i = 1, n do local v = obj.field end
+end
+
+bench["missing field read"] = function(obj, n)
+  for i = 1, n do local v = obj.onMissing end
+end
+
+bench["field write"] = function(obj, n)
+  for i = 1, n do obj.field = i end
+end
+
+benchmarks = bench
+)";
+
+int main(int argc, const char* argv[])
+{
+    std::vector<std::string> args(argv, argv + argc);
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 5000000;
+    if (iterations <= 0) {
+        std::cout << "usage: " << args[0] << " [iterations]" << std::endl;
+        return 1;
+    }
+
+    g_resources.init(argv[0]);
+    g_app.Application::init(args);
+
+    // no class binds a member field, so one is bound here
+    g_lua.bindClassMemberGetField<ScheduledEvent>("boundDelay", &ScheduledEvent::delay);
+    g_lua.runBuffer(script, "luabinding");
+
+    ScheduledEventPtr object = g_dispatcher.scheduleEvent([] {}, 1000000);
+    const std::string names[] = { "lua method call", "c++ method call", "c++ base class method call", "c++ getter read",
+                                  "field read", "missing field read", "field write" };
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (const std::string& name : names) {
+        g_lua.getGlobalField("benchmarks", name);
+        g_lua.pushObject(object);
+        g_lua.pushInteger(iterations);
+        stdext::timer timer;
+        g_lua.call(2, 0);
+        ticks_t elapsed = timer.elapsed_micros();
+        std::cout << std::left << std::setw(28) << name << std::right << std::setw(10) << elapsed * 1000.0 / iterations << " ns\n";
+    }
+
+    object->cancel();
+    object = nullptr;
+    g_app.Application::deinit();
+    g_app.Application::terminate();
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Minimap stress benchmark. Pathfinding threads search paths and check tiles read with threadGetTile
+// while the main thread keeps rewriting the tiles they read and publishes the blocks of another
+// floor, as the dispatcher does while walking. The speed and flags of every tile written are derived
+// from its color, so a tile read half written is caught.
+// usage: otclient_minimap [max threads] [milliseconds]
+
+#include <framework/stdext/time.h>
+#include <client/map.h>
+#include <client/minimap.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+
+static const Position origin(32000, 32000, 7);
+static const int areaSize = 256;
+
+static MinimapTile tileOfColor(uint8 color)
+{
+    MinimapTile tile;
+    tile.flags = MinimapTileWasSeen;
+    if (color % 11 == 0)
+        tile.flags |= MinimapTileNotWalkable;
+    else if (color % 13 == 0)
+        tile.flags |= MinimapTileNotPathable;
+    tile.color = color;
+    tile.speed = 10 + color % 16;
+    return tile;
+}
+
+// blocks not published yet read as the default tile
+static bool isConsistent(const MinimapTile& tile)
+{
+    return tile == MinimapTile() || (tile.color < 200 && tile == tileOfColor(tile.color));
+}
+
+static Position randomPosition(std::mt19937& gen, int z)
+{
+    return Position(origin.x + gen() % areaSize, origin.y + gen() % areaSize, z);
+}
+
+struct Result {
+    uint64_t searches = 0;
+    uint64_t lookups = 0;
+    uint64_t writes = 0;
+    uint64_t torn = 0;
+};
+
+// the floor below starts empty, its blocks are published while the first threads writing it read them
+static Result run(int threads, int milliseconds, bool write)
+{
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> searches{0}, lookups{0}, torn{0};
+
+    std::vector<std::thread> readers;
+    for (int t = 0; t < threads; ++t) {
+        readers.emplace_back([&, t] {
+            std::mt19937 gen(1234 + t);
+            uint64_t threadSearches = 0, threadLookups = 0, threadTorn = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                Position start = randomPosition(gen, origin.z);
+                Position goal = start.translated((int)(gen() % 61) - 30, (int)(gen() % 61) - 30);
+                g_map.newFindPath(start, goal, nullptr);
+                threadSearches += 1;
+
+                for (int i = 0; i < 256; ++i) {
+                    if (!isConsistent(g_minimap.threadGetTile(randomPosition(gen, origin.z + (i & 1)))))
+                        threadTorn += 1;
+                }
+                threadLookups += 256;
+            }
+            searches += threadSearches;
+            lookups += threadLookups;
+            torn += threadTorn;
+        });
+    }
+
+    Result result;
+    uint8 pass = 0;
+    stdext::timer timer;
+    while (timer.elapsed_millis() < milliseconds) {
+        if (!write) {
+            stdext::millisleep(1);
+            continue;
+        }
+        pass = (pass + 1) % 200;
+        for (int y = 0; y < areaSize; ++y) {
+            for (int x = 0; x < areaSize; ++x) {
+                g_minimap.updateTile(Position(origin.x + x, origin.y + y, origin.z), tileOfColor((x + y + pass) % 200));
+                g_minimap.updateTile(Position(origin.x + x, origin.y + y, origin.z + 1), tileOfColor((x * y + pass) % 200));
+            }
+        }
+        result.writes += 2 * areaSize * areaSize;
+    }
+    stop = true;
+    for (auto& reader : readers)
+        reader.join();
+
+    result.searches = searches;
+    result.lookups = lookups;
+    result.torn = torn;
+    return result;
+}
+
+int main(int argc, const char* argv[])
+{
+    const int maxThreads = argc > 1 ? std::atoi(argv[1]) : 8;
+    const int milliseconds = argc > 2 ? std::atoi(argv[2]) : 1000;
+    if (maxThreads <= 0 || milliseconds <= 0) {
+        std::cout << "usage: " << argv[0] << " [max threads] [milliseconds]" << std::endl;
+        return 1;
+    }
+
+    for (int y = 0; y < areaSize; ++y) {
+        for (int x = 0; x < areaSize; ++x)
+            g_minimap.updateTile(Position(origin.x + x, origin.y + y, origin.z), tileOfColor((x + y) % 200));
+    }
+
+    const double seconds = milliseconds / 1000.0;
+    uint64_t torn = 0;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Threads" << std::setw(18) << "searches/s idle" << std::setw(18) << "searches/s write"
+              << std::setw(16) << "M lookups/s" << std::setw(14) << "M writes/s" << std::setw(8) << "torn\n";
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        Result idle = run(threads, milliseconds, false);
+        Result writing = run(threads, milliseconds, true);
+        torn += idle.torn + writing.torn;
+        std::cout << std::setw(7) << threads << std::setw(18) << idle.searches / seconds << std::setw(18) << writing.searches / seconds
+                  << std::setw(16) << writing.lookups / seconds / 1000000 << std::setw(14) << writing.writes / seconds / 1000000
+                  << std::setw(7) << idle.torn + writing.torn << "\n";
+    }
+
+    if (torn > 0) {
+        std::cout << torn << " tiles were read half written" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Headless packet replay benchmark. Loads the things of a client version and parses a record
+// through ProtocolGame as fast as possible, without a window, graphics or ui modules.
+// usage: otclient_packetreplay <record> <client version> [protocol version]
+// the record is read from records/ in the working directory, like g_game.playRecord does
+
+#include <framework/core/application.h>
+#include <framework/core/clock.h>
+#include <framework/core/eventdispatcher.h>
+#include <framework/core/modulemanager.h>
+#include <framework/core/resourcemanager.h>
+#include <framework/luaengine/luainterface.h>
+#include <framework/net/packet_player.h>
+#include <framework/util/stats.h>
+#include <client/client.h>
+#include <client/game.h>
+#include <client/map.h>
+#include <client/protocolgame.h>
+#include <client/spritemanager.h>
+#include <client/thingtypemanager.h>
+
+#include "allocations.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+int main(int argc, const char* argv[])
+{
+    std::vector<std::string> args(argv, argv + argc);
+    if (args.size() < 3) {
+        std::cout << "usage: " << args[0] << " <record> <client version> [protocol version]" << std::endl;
+        return 1;
+    }
+
+    const std::string record = args[1];
+    const int version = stdext::unsafe_cast<int>(args[2]);
+
+    g_resources.init(argv[0]);
+    g_app.setName("OTClientV8");
+    g_app.setCompactName(g_resources.getCompactName());
+
+    // only the window-less part of the application and client, without graphics and ui
+    g_app.Application::init(args);
+    g_client.registerLuaFunctions();
+    g_map.init();
+    g_game.init();
+    g_things.init();
+
+    g_resources.setupWriteDir(g_app.getName(), g_app.getCompactName());
+    g_resources.setup();
+
+    // game features are set from lua when the client version changes
+    g_modules.discoverModules();
+    g_modules.ensureModuleLoaded("corelib");
+    g_modules.ensureModuleLoaded("gamelib");
+    g_modules.ensureModuleLoaded("game_features");
+
+    g_game.setClientVersion(version);
+    if (args.size() > 3)
+        g_game.setProtocolVersion(stdext::unsafe_cast<int>(args[3]));
+    else
+        g_game.setProtocolVersion(g_lua.callGlobalField<int, int>("g_game", "getClientProtocolVersion", version));
+
+    const std::string things = stdext::format("/things/%d/Tibia", version);
+    if (!g_things.loadDat(things)) {
+        g_game.enableFeature(Otc::GameSpritesU32);
+        if (!g_things.loadDat(things)) {
+            std::cout << "unable to load " << things << ".dat" << std::endl;
+            return 1;
+        }
+    }
+    if (!g_sprites.loadSpr(things)) {
+        std::cout << "unable to load " << things << ".spr" << std::endl;
+        return 1;
+    }
+
+    g_game.playRecord(record);
+    ProtocolGamePtr protocol = g_game.getProtocolGame();
+    PacketPlayerPtr player = protocol->getPlayer();
+
+    g_stats.clearAll();
+    g_stats.clear(STATS_PACKETS);
+    g_stats.clear(STATS_DISPATCHER);
+
+    uint64_t bytes = 0;
+    uint64_t startAllocations = countedAllocations();
+    stdext::timer timer;
+    size_t packets = player->replay([&](const std::shared_ptr<std::vector<uint8_t>>& packet) {
+        bytes += packet->size();
+        protocol->parseRecordedPacket(packet);
+        // events scheduled by the parser, like creature walks, run as they would between frames
+        g_clock.update();
+        g_dispatcher.poll();
+    });
+    ticks_t elapsed = std::max<ticks_t>(1, timer.elapsed_micros());
+    uint64_t usedAllocations = countedAllocations() - startAllocations;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Record: " << record << " (" << version << ")\n";
+    std::cout << "Packets: " << packets << " in " << elapsed / 1000.0 << " ms\n";
+    std::cout << "Packets/s: " << packets * 1000000.0 / elapsed << "\n";
+    std::cout << "MB/s: " << bytes / (double)elapsed << "\n";
+    std::cout << "Allocations: " << usedAllocations << " (" << (packets ? usedAllocations / (double)packets : 0) << " per packet)\n\n";
+    std::cout << "Opcodes\n" << g_stats.get(STATS_PACKETS, 256, true) << "\n";
+    std::cout << "Dispatcher\n" << g_stats.get(STATS_DISPATCHER, 20, true) << std::endl;
+
+    g_app.Application::deinit();
+    g_client.terminate();
+    g_app.Application::terminate();
+    return 0;
+}
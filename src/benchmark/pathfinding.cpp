@@ -0,0 +1,242 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Pathfinding benchmark. Fills the minimap of an area with rooms connected by doors, a river with
+// bridges and grounds of different speeds, then searches paths between random positions with
+// newFindPath, the search used by findPathAsync, and with findEveryPath. Every path found must lead
+// to its goal, or stop where it would enter tiles never seen, without stepping on a blocked tile.
+// Batches of goals are then searched one by one, with newFindPaths and with findPathsAsync, and
+// every path must cost the same as the one found for its goal alone.
+// usage: otclient_pathfinding [searches] [max distance]
+
+#include <framework/core/asyncdispatcher.h>
+#include <framework/core/eventdispatcher.h>
+#include <framework/stdext/time.h>
+#include <client/map.h>
+#include <client/minimap.h>
+
+#include "allocations.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+static const Position origin(32000, 32000, 7);
+static const int areaSize = 512;
+
+static MinimapTile terrain(int x, int y)
+{
+    MinimapTile tile;
+    tile.flags = MinimapTileWasSeen;
+    tile.color = 24;
+    // ground speeds from 100 to 250
+    tile.speed = 10 + ((x * 7 + y * 13) % 4) * 5;
+
+    // rooms of 16x16 with a door in the middle of every wall
+    bool wall = (x % 16 == 0 && (y % 16 < 6 || y % 16 > 8)) || (y % 16 == 0 && (x % 16 < 6 || x % 16 > 8));
+    // a river with a bridge every 50 tiles, and fields that can be walked but not pathed through
+    bool river = y % 97 >= 40 && y % 97 <= 42 && x % 50 >= 3;
+    if (wall || river)
+        tile.flags |= MinimapTileNotWalkable;
+    else if ((x * 31 + y * 17) % 53 == 0)
+        tile.flags |= MinimapTileNotPathable;
+    return tile;
+}
+
+static bool isBlocked(const Position& pos)
+{
+    const MinimapTile tile = g_minimap.threadGetTile(pos);
+    return tile.hasFlag(MinimapTileNotWalkable) || tile.hasFlag(MinimapTileNotPathable) || tile.hasFlag(MinimapTileEmpty);
+}
+
+// walks the path, a blocked goal can be reached but nothing blocked can be walked through
+static bool checkPath(const PathFindResult& result)
+{
+    if (result.status != Otc::PathFindResultOk)
+        return true;
+    Position pos = result.start;
+    for (size_t i = 0; i < result.path.size(); ++i) {
+        pos = pos.translatedToDirection(result.path[i]);
+        if (i + 1 < result.path.size() && isBlocked(pos))
+            return false;
+    }
+    if (pos == result.destination)
+        return true;
+
+    // paths going through tiles never seen stop before the first one
+    for (int x = -1; x <= 1; ++x) {
+        for (int y = -1; y <= 1; ++y) {
+            if (!g_minimap.threadGetTile(pos.translated(x, y)).hasFlag(MinimapTileWasSeen))
+                return true;
+        }
+    }
+    return false;
+}
+
+// the cost newFindPath minimizes, a path found by any search must cost the same
+static float pathCost(const PathFindResult& result)
+{
+    float cost = 0;
+    Position pos = result.start;
+    for (Otc::Direction dir : result.path) {
+        pos = pos.translatedToDirection(dir);
+        const MinimapTile tile = g_minimap.threadGetTile(pos);
+        float speed = tile.hasFlag(MinimapTileWasSeen) ? tile.getSpeed() : 2000;
+        cost += std::max(100.0f, speed) * (dir >= Otc::NorthEast ? 3 : 1);
+    }
+    return cost;
+}
+
+static bool samePaths(const std::vector<PathFindResult_ptr>& results, const std::vector<PathFindResult_ptr>& expected)
+{
+    if (results.size() != expected.size())
+        return false;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i]->destination != expected[i]->destination || results[i]->status != expected[i]->status ||
+            pathCost(*results[i]) != pathCost(*expected[i]))
+            return false;
+    }
+    return true;
+}
+
+static Position randomPosition(std::mt19937& gen, const Position& center, int distance)
+{
+    Position pos = center;
+    pos.x = std::min(std::max<int>(origin.x, pos.x + (int)(gen() % (2 * distance + 1)) - distance), origin.x + areaSize - 1);
+    pos.y = std::min(std::max<int>(origin.y, pos.y + (int)(gen() % (2 * distance + 1)) - distance), origin.y + areaSize - 1);
+    return pos;
+}
+
+int main(int argc, const char* argv[])
+{
+    const int searches = argc > 1 ? std::atoi(argv[1]) : 20000;
+    const int distance = argc > 2 ? std::atoi(argv[2]) : 40;
+    if (searches <= 0 || distance <= 0) {
+        std::cout << "usage: " << argv[0] << " [searches] [max distance]" << std::endl;
+        return 1;
+    }
+
+    for (int y = 0; y < areaSize; ++y) {
+        for (int x = 0; x < areaSize; ++x)
+            g_minimap.updateTile(Position(origin.x + x, origin.y + y, origin.z), terrain(x, y));
+    }
+
+    std::mt19937 gen(1234);
+    std::vector<std::pair<Position, Position>> queries;
+    for (int i = 0; i < searches; ++i) {
+        Position start = randomPosition(gen, Position(origin.x + areaSize / 2, origin.y + areaSize / 2, origin.z), areaSize / 2);
+        queries.emplace_back(start, randomPosition(gen, start, distance));
+    }
+
+    // the first searches grow the state of the path finder
+    for (int i = 0; i < std::min(searches, 100); ++i)
+        g_map.newFindPath(queries[i].first, queries[i].second, nullptr);
+
+    size_t found = 0, steps = 0, complexity = 0;
+    bool failed = false;
+    uint64_t startAllocations = countedAllocations();
+    stdext::timer timer;
+    for (auto& query : queries) {
+        PathFindResult_ptr result = g_map.newFindPath(query.first, query.second, nullptr);
+        complexity += result->complexity;
+        if (result->status != Otc::PathFindResultOk)
+            continue;
+        found += 1;
+        steps += result->path.size();
+        if (!checkPath(*result)) {
+            std::cout << "the path from " << query.first << " doesn't lead to " << query.second << std::endl;
+            failed = true;
+        }
+    }
+    ticks_t elapsed = std::max<ticks_t>(1, timer.elapsed_micros());
+    uint64_t allocations = countedAllocations() - startAllocations;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "newFindPath: " << elapsed / (double)searches << " us/search, " << found << " found, "
+              << steps / (double)std::max<size_t>(found, 1) << " steps and " << complexity / (double)searches
+              << " nodes per search, " << allocations / (double)searches << " allocations/search\n";
+
+    // every position reachable within the distance, with the map empty it reads the minimap too
+    const int everyPathSearches = std::max(searches / 50, 1);
+    size_t reached = 0;
+    timer.restart();
+    for (int i = 0; i < everyPathSearches; ++i)
+        reached += g_map.findEveryPath(queries[i].first, distance / 2, {}).size();
+    elapsed = std::max<ticks_t>(1, timer.elapsed_micros());
+    std::cout << "findEveryPath: " << elapsed / (double)everyPathSearches << " us/search, "
+              << reached / (double)everyPathSearches << " positions per search\n";
+
+    // a creature choosing its target: a batch of goals close to each other, searched one by one, with
+    // the single multi goal search and with findPathsAsync, which picks one of them on the async threads
+    const int batches = std::max(searches / 20, 1);
+    const int goalsPerBatch = 16;
+    std::vector<std::pair<Position, std::vector<Position>>> goalBatches;
+    for (int i = 0; i < batches; ++i) {
+        Position start = randomPosition(gen, Position(origin.x + areaSize / 2, origin.y + areaSize / 2, origin.z), areaSize / 2 - 60);
+        std::vector<Position> goals;
+        for (int j = 0; j < goalsPerBatch; ++j)
+            goals.push_back(randomPosition(gen, start, 25));
+        goalBatches.emplace_back(start, goals);
+    }
+
+    std::vector<std::vector<PathFindResult_ptr>> expected;
+    timer.restart();
+    for (auto& batch : goalBatches) {
+        expected.emplace_back();
+        for (const Position& goal : batch.second)
+            expected.back().push_back(g_map.newFindPath(batch.first, goal, nullptr));
+    }
+    ticks_t perGoal = std::max<ticks_t>(1, timer.elapsed_micros());
+
+    timer.restart();
+    for (size_t i = 0; i < goalBatches.size(); ++i) {
+        if (!samePaths(g_map.newFindPaths(goalBatches[i].first, goalBatches[i].second, nullptr), expected[i])) {
+            std::cout << "the multi goal search from " << goalBatches[i].first << " found other paths" << std::endl;
+            failed = true;
+        }
+    }
+    ticks_t multiGoal = std::max<ticks_t>(1, timer.elapsed_micros());
+
+    g_asyncDispatcher.init();
+    size_t done = 0;
+    timer.restart();
+    for (size_t i = 0; i < goalBatches.size(); ++i) {
+        g_map.findPathsAsync(goalBatches[i].first, goalBatches[i].second, Otc::PathFindAllowNotSeenTiles, [&, i](std::vector<PathFindResult_ptr> results) {
+            if (!samePaths(results, expected[i])) {
+                std::cout << "findPathsAsync from " << goalBatches[i].first << " found other paths" << std::endl;
+                failed = true;
+            }
+            done += 1;
+        });
+    }
+    while (done < goalBatches.size())
+        g_dispatcher.poll();
+    ticks_t async = std::max<ticks_t>(1, timer.elapsed_micros());
+    size_t threads = g_asyncDispatcher.getThreadCount();
+    g_asyncDispatcher.terminate();
+
+    std::cout << goalsPerBatch << " goals: " << perGoal / (double)batches << " us/batch one by one, "
+              << multiGoal / (double)batches << " us/batch with newFindPaths, " << async / (double)batches
+              << " us/batch with findPathsAsync on " << threads << " threads\n";
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Packet record benchmark. Records a synthetic session with PacketRecorder and in the text format
+// it wrote before, then compares their sizes and how long PacketPlayer takes to open and replay them,
+// and to open the binary record at random times. Every packet replayed must be the next one
+// received at or after the time, in order.
+// usage: otclient_records [minutes] [seeks]
+// the records are written to records/ in the working directory and removed at the end
+
+#include <framework/net/packet_player.h>
+#include <framework/net/packet_recorder.h>
+#include <framework/stdext/time.h>
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+struct RecordedPacket {
+    uint8 direction;
+    uint32 time;
+    std::string data;
+};
+
+// game packets repeat a few bytes a lot (opcodes, positions, item ids), the first 4 bytes number the input ones
+static std::vector<RecordedPacket> makeSession(int minutes)
+{
+    static const uint8 common[] = { 0x00, 0x01, 0x6A, 0x6B, 0x6C, 0x7D, 0x80, 0xFF };
+    std::mt19937 gen(1234);
+    std::vector<RecordedPacket> packets;
+    uint32 inputs = 0;
+    for (uint32 time = 0; time < (uint32)minutes * 60000; time += gen() % 100) {
+        RecordedPacket packet;
+        packet.direction = gen() % 10 == 0 ? PACKET_RECORD_OUTPUT : PACKET_RECORD_INPUT;
+        packet.time = time;
+        size_t size = packet.direction == PACKET_RECORD_OUTPUT ? 8 + gen() % 16 : 10 + gen() % (gen() % 8 == 0 ? 4000 : 400);
+        for (size_t i = 0; i < size; ++i)
+            packet.data.push_back((char)(gen() % 4 == 0 ? gen() % 256 : common[gen() % 8]));
+        if (packet.direction == PACKET_RECORD_INPUT) {
+            stdext::writeULE32((uchar*)&packet.data[0], inputs);
+            inputs += 1;
+        }
+        packets.push_back(std::move(packet));
+    }
+    return packets;
+}
+
+// one line per packet as PacketRecorder wrote them before the binary format
+static void writeText(const std::string& file, const std::vector<RecordedPacket>& packets)
+{
+    std::ofstream stream(std::filesystem::path("records") / file);
+    for (const RecordedPacket& packet : packets) {
+        stream << (packet.direction == PACKET_RECORD_INPUT ? "< " : "> ") << packet.time << " ";
+        for (char byte : packet.data)
+            stream << std::setfill('0') << std::setw(2) << std::hex << (uint16_t)(uint8_t)byte;
+        stream << std::dec << "\n";
+    }
+}
+
+// replays what is left and checks it's every input packet from the first one, in order
+static bool replayFrom(PacketPlayer& player, uint32 first, uint32 inputs)
+{
+    uint32 next = first;
+    bool ordered = true;
+    player.replay([&](const std::shared_ptr<std::vector<uint8_t>>& packet) {
+        if (packet->size() < 4 || stdext::readULE32(packet->data()) != next)
+            ordered = false;
+        next += 1;
+    });
+    return ordered && next == inputs;
+}
+
+int main(int argc, const char* argv[])
+{
+    const int minutes = argc > 1 ? std::atoi(argv[1]) : 30;
+    const int seeks = argc > 2 ? std::atoi(argv[2]) : 50;
+    if (minutes <= 0 || seeks < 0) {
+        std::cout << "usage: " << argv[0] << " [minutes] [seeks]" << std::endl;
+        return 1;
+    }
+
+    const std::string binaryFile = "benchmark.otrb", textFile = "benchmark.record";
+    std::vector<RecordedPacket> packets = makeSession(minutes);
+    std::vector<uint32> inputTimes;
+    for (const RecordedPacket& packet : packets) {
+        if (packet.direction == PACKET_RECORD_INPUT)
+            inputTimes.push_back(packet.time);
+    }
+    const uint32 inputs = inputTimes.size();
+
+    stdext::timer timer;
+    {
+        PacketRecorder recorder(binaryFile);
+        for (const RecordedPacket& packet : packets)
+            recorder.addPacket(packet.direction, packet.time, packet.data);
+    }
+    ticks_t binaryWrite = timer.elapsed_micros();
+
+    timer.restart();
+    writeText(textFile, packets);
+    ticks_t textWrite = timer.elapsed_micros();
+
+    bool failed = false;
+    timer.restart();
+    PacketPlayer textPlayer(textFile);
+    ticks_t textOpen = timer.elapsed_micros();
+    timer.restart();
+    if (!replayFrom(textPlayer, 0, inputs)) {
+        std::cout << "the text record doesn't replay the packets recorded" << std::endl;
+        failed = true;
+    }
+    ticks_t textReplay = timer.elapsed_micros();
+
+    timer.restart();
+    PacketPlayer binaryPlayer(binaryFile);
+    ticks_t binaryOpen = timer.elapsed_micros();
+    timer.restart();
+    if (!replayFrom(binaryPlayer, 0, inputs)) {
+        std::cout << "the binary record doesn't replay the packets recorded" << std::endl;
+        failed = true;
+    }
+    ticks_t binaryReplay = timer.elapsed_micros();
+
+    // a bug report jumping to the moment it happened, the packets replayed after the seek aren't timed
+    std::mt19937 gen(4321);
+    ticks_t seekTime = 0;
+    for (int i = 0; i < seeks; ++i) {
+        uint32 time = gen() % (minutes * 60000);
+        timer.restart();
+        PacketPlayer player(binaryFile);
+        player.seek(time);
+        seekTime += timer.elapsed_micros();
+
+        uint32 first = std::lower_bound(inputTimes.begin(), inputTimes.end(), time) - inputTimes.begin();
+        if (!replayFrom(player, first, inputs)) {
+            std::cout << "seeking to " << time << " ms doesn't continue with the next packet" << std::endl;
+            failed = true;
+        }
+    }
+
+    const double megabytes = 1024.0 * 1024.0;
+    const auto binarySize = std::filesystem::file_size(std::filesystem::path("records") / binaryFile);
+    const auto textSize = std::filesystem::file_size(std::filesystem::path("records") / textFile);
+    std::filesystem::remove(std::filesystem::path("records") / binaryFile);
+    std::filesystem::remove(std::filesystem::path("records") / textFile);
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << minutes << " minutes, " << packets.size() << " packets, " << inputs << " received\n";
+    std::cout << "text: " << textSize / megabytes << " MB, written in " << textWrite / 1000.0 << " ms, opened in "
+              << textOpen / 1000.0 << " ms, replayed in " << textReplay / 1000.0 << " ms\n";
+    std::cout << "binary: " << binarySize / megabytes << " MB, written in " << binaryWrite / 1000.0 << " ms, opened in "
+              << binaryOpen / 1000.0 << " ms, replayed in " << binaryReplay / 1000.0 << " ms\n";
+    if (seeks > 0)
+        std::cout << "opened and seeked in " << seekTime / 1000.0 / seeks << " ms\n";
+    return failed ? 1 : 0;
+}
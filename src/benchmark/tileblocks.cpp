@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Tile blocks benchmark. Fills the blocks of a map area, then looks up random positions in and
+// around it, iterates every block and drops the ones out of a smaller area, like getTile, getTiles
+// and removeUnawareThings do, first with the std::map the map used before and then with
+// TileBlockMap. Both must find the same blocks.
+// usage: otclient_tileblocks [blocks per side] [lookups]
+
+#include <framework/stdext/time.h>
+#include <client/map.h>
+
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+
+struct Result {
+    ticks_t insert = 0;
+    ticks_t lookup = 0;
+    ticks_t iterate = 0;
+    ticks_t erase = 0;
+    size_t found = 0;
+    size_t remaining = 0;
+};
+
+// same as Map::getBlockIndex
+static uint getBlockIndex(int x, int y)
+{
+    return ((y / BLOCK_SIZE) * (65536 / BLOCK_SIZE)) + (x / BLOCK_SIZE);
+}
+
+template<typename Insert, typename Find, typename Iterate, typename Erase>
+static Result run(int side, int lookups, Insert insert, Find find, Iterate iterate, Erase erase)
+{
+    const int origin = 32000 - side * BLOCK_SIZE / 2;
+    Result result;
+
+    stdext::timer timer;
+    for (int y = 0; y < side; ++y) {
+        for (int x = 0; x < side; ++x)
+            insert(getBlockIndex(origin + x * BLOCK_SIZE, origin + y * BLOCK_SIZE));
+    }
+    result.insert = timer.elapsed_micros();
+
+    // a quarter of the lookups fall around the filled area, the blocks aren't there
+    std::mt19937 gen(1234);
+    const uint32 range = side * BLOCK_SIZE * 3 / 2;
+    const int start = origin - side * BLOCK_SIZE / 4;
+    timer.restart();
+    for (int i = 0; i < lookups; ++i) {
+        int x = start + gen() % range;
+        int y = start + gen() % range;
+        result.found += find(getBlockIndex(x, y));
+    }
+    result.lookup = timer.elapsed_micros();
+
+    timer.restart();
+    for (int i = 0; i < 100; ++i)
+        result.remaining += iterate();
+    result.remaining /= 100;
+    result.iterate = timer.elapsed_micros();
+
+    // keeps the blocks of the middle half
+    timer.restart();
+    erase([&](uint index) {
+        int x = (int)(index % (65536 / BLOCK_SIZE)) * BLOCK_SIZE - origin;
+        int y = (int)(index / (65536 / BLOCK_SIZE)) * BLOCK_SIZE - origin;
+        int border = side * BLOCK_SIZE / 4;
+        return x < border || y < border || x >= side * BLOCK_SIZE - border || y >= side * BLOCK_SIZE - border;
+    });
+    result.erase = timer.elapsed_micros();
+    result.remaining = iterate();
+    return result;
+}
+
+static void print(const std::string& name, const Result& result, int side, int lookups)
+{
+    std::cout << std::left << std::setw(16) << name << std::right
+              << " insert " << std::setw(8) << result.insert * 1000.0 / (side * side) << " ns/block"
+              << " lookup " << std::setw(8) << result.lookup * 1000.0 / lookups << " ns"
+              << " iterate " << std::setw(8) << result.iterate / 100.0 << " us"
+              << " erase " << std::setw(8) << result.erase / 1000.0 << " ms\n";
+}
+
+int main(int argc, const char* argv[])
+{
+    const int side = argc > 1 ? std::atoi(argv[1]) : 48;
+    const int lookups = argc > 2 ? std::atoi(argv[2]) : 10000000;
+    if (side <= 0 || side > 512 || lookups <= 0) {
+        std::cout << "usage: " << argv[0] << " [blocks per side (up to 512)] [lookups]" << std::endl;
+        return 1;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+
+    std::map<uint, TileBlock> tree;
+    Result treeResult = run(side, lookups,
+        [&](uint index) { tree[index]; },
+        [&](uint index) { return tree.find(index) != tree.end(); },
+        [&]() {
+            size_t blocks = 0;
+            for (auto& it : tree)
+                blocks += !it.second.getTiles()[0];
+            return blocks;
+        },
+        [&](const std::function<bool(uint)>& outside) {
+            for (auto it = tree.begin(); it != tree.end();) {
+                if (outside(it->first))
+                    it = tree.erase(it);
+                else
+                    ++it;
+            }
+        });
+    print("std::map", treeResult, side, lookups);
+
+    TileBlockMap blocks;
+    std::vector<uint> keys;
+    Result hashResult = run(side, lookups,
+        [&](uint index) { blocks[index]; keys.push_back(index); },
+        [&](uint index) { return blocks.find(index) != nullptr; },
+        [&]() {
+            size_t count = 0;
+            for (auto& block : blocks)
+                count += !block->getTiles()[0];
+            return count;
+        },
+        [&](const std::function<bool(uint)>& outside) {
+            for (uint index : keys) {
+                if (outside(index))
+                    blocks.erase(index);
+            }
+        });
+    print("TileBlockMap", hashResult, side, lookups);
+
+    if (treeResult.found != hashResult.found || treeResult.remaining != hashResult.remaining) {
+        std::cout << "the blocks differ: " << hashResult.found << " found and " << hashResult.remaining
+                  << " kept instead of " << treeResult.found << " and " << treeResult.remaining << std::endl;
+        return 1;
+    }
+    return 0;
+}
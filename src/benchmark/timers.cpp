@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Scheduled events benchmark. Schedules events with random delays, like walks, animations and
+// timeouts do, cancels most of them before they are due and polls the due ones every millisecond,
+// first with the priority queue the dispatcher used before and then with the timer wheel.
+// usage: otclient_timers [events] [max delay in ms]
+
+#include <framework/core/clock.h>
+#include <framework/core/scheduledevent.h>
+#include <framework/core/timerwheel.h>
+#include <framework/stdext/time.h>
+
+#include "allocations.h"
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <random>
+
+struct Result {
+    ticks_t micros = 0;
+    uint64_t allocations = 0;
+    size_t executed = 0;
+    size_t maxPending = 0;
+};
+
+// every millisecond of simulated time schedules the same events, canceled in the same order
+template<typename Schedule, typename Cancel, typename Poll, typename Pending>
+static Result run(int events, int maxDelay, Schedule schedule, Cancel cancel, Poll poll, Pending pending)
+{
+    std::mt19937 gen(1234);
+    std::uniform_int_distribution<int> delays(0, maxDelay);
+    std::uniform_int_distribution<int> chance(0, 99);
+    std::vector<ScheduledEventPtr> live;
+    Result result;
+
+    const int perMilli = 100;
+    uint64_t startAllocations = countedAllocations();
+    stdext::timer timer;
+    for (int i = 0; i < events || pending() > 0; i += perMilli) {
+        for (int j = 0; j < perMilli && i < events; ++j) {
+            live.push_back(schedule(delays(gen)));
+            // most events are canceled or rescheduled before they are due
+            if (chance(gen) < 75) {
+                size_t index = std::uniform_int_distribution<size_t>(0, live.size() - 1)(gen);
+                cancel(live[index]);
+                live[index] = live.back();
+                live.pop_back();
+            }
+        }
+        if (live.size() > 1000)
+            live.erase(live.begin(), live.begin() + 500);
+        result.maxPending = std::max(result.maxPending, pending());
+        result.executed += poll();
+    }
+    result.micros = std::max<ticks_t>(1, timer.elapsed_micros());
+    result.allocations = countedAllocations() - startAllocations;
+    return result;
+}
+
+static void print(const std::string& name, const Result& result, int events)
+{
+    std::cout << name << ": " << result.micros * 1000.0 / events << " ns/event, "
+              << result.allocations / (double)events << " allocations/event, "
+              << result.executed << " executed, " << result.maxPending << " pending at most\n";
+}
+
+int main(int argc, const char* argv[])
+{
+    const int events = argc > 1 ? std::atoi(argv[1]) : 2000000;
+    const int maxDelay = argc > 2 ? std::atoi(argv[2]) : 5000;
+    if (events <= 0 || maxDelay < 0) {
+        std::cout << "usage: " << argv[0] << " [events] [max delay in ms]" << std::endl;
+        return 1;
+    }
+
+    g_clock.update();
+    const ticks_t start = g_clock.millis();
+    std::cout << std::fixed << std::setprecision(2);
+
+    // the ticks of the events are relative to the clock when they were created
+    ticks_t now = start;
+    auto delayFrom = [&](int delay) { return (int)(now - start) + delay; };
+
+    std::priority_queue<ScheduledEventPtr, std::vector<ScheduledEventPtr>, lessScheduledEvent> queue;
+    Result queueResult = run(events, maxDelay,
+        [&](int delay) {
+            auto event = std::make_shared<ScheduledEvent>("", [] {}, delayFrom(delay), 1);
+            queue.push(event);
+            return event;
+        },
+        [&](const ScheduledEventPtr& event) { event->Event::cancel(); },
+        [&]() {
+            size_t executed = 0;
+            now++;
+            // canceled events stay in the queue until they are due
+            while (!queue.empty() && queue.top()->ticks() <= now) {
+                ScheduledEventPtr event = queue.top();
+                queue.pop();
+                event->execute();
+                executed += event->isExecuted();
+            }
+            return executed;
+        },
+        [&]() { return queue.size(); });
+    print("priority queue", queueResult, events);
+
+    now = start;
+    TimerWheel wheel;
+    Result wheelResult = run(events, maxDelay,
+        [&](int delay) {
+            auto event = ScheduledEvent::create("", [] {}, delayFrom(delay), 1);
+            wheel.add(event);
+            return event;
+        },
+        [&](const ScheduledEventPtr& event) {
+            event->cancel();
+            wheel.remove(event.get());
+        },
+        [&]() {
+            static std::vector<ScheduledEventPtr> due;
+            now++;
+            wheel.poll(now, due);
+            size_t executed = 0;
+            for (auto& event : due) {
+                event->execute();
+                executed += event->isExecuted();
+            }
+            due.clear();
+            return executed;
+        },
+        [&]() { return wheel.size(); });
+    print("timer wheel", wheelResult, events);
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// UI styles benchmark. Creates rows of a list from a typical otui style, like the market, containers
+// and battle list do, by the style name, from a style with ! tags and from an instance node.
+// usage: otclient_uistyles [rows]
+
+#include <framework/core/application.h>
+#include <framework/core/eventdispatcher.h>
+#include <framework/core/resourcemanager.h>
+#include <framework/luaengine/luainterface.h>
+#include <framework/otml/otml.h>
+#include <framework/stdext/time.h>
+#include <framework/ui/uimanager.h>
+#include <framework/ui/uiwidget.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+// only UIWidget is used, the classes of the lua modules are not loaded
+static const char* styles = R"(
+BenchPanel < UIWidget
+  size: 200 20
+  background-color: #00000044
+  focusable: false
+
+BenchLabel < UIWidget
+  size: 60 14
+  color: #dfdfdf
+  text-align: left
+  phantom: true
+  $disabled:
+    color: #808080
+
+BenchRow < BenchPanel
+  height: 20
+  margin-top: 1
+  focusable: true
+  $hover:
+    background-color: #ffffff22
+  $focus:
+    background-color: #404040
+  $!on:
+    opacity: 0.9
+
+  BenchLabel
+    id: name
+    anchors.left: parent.left
+    anchors.verticalCenter: parent.verticalCenter
+    text: Item name
+
+  BenchLabel
+    id: amount
+    anchors.left: prev.right
+    anchors.verticalCenter: parent.verticalCenter
+    text-align: right
+    text: 100
+
+  BenchLabel
+    id: price
+    anchors.left: prev.right
+    anchors.verticalCenter: parent.verticalCenter
+    margin-left: 5
+    text: 1000 gp
+
+BenchDynamicRow < BenchRow
+  !text: 'Row ' .. 1
+)";
+
+// a row declared inside another widget, each one has its own properties
+static const char* instance = R"(
+BenchRow
+  id: row
+  margin-top: 2
+)";
+
+int main(int argc, const char* argv[])
+{
+    std::vector<std::string> args(argv, argv + argc);
+    const int rows = argc > 1 ? std::atoi(argv[1]) : 10000;
+    if (rows <= 0) {
+        std::cout << "usage: " << args[0] << " [rows]" << std::endl;
+        return 1;
+    }
+
+    g_resources.init(argv[0]);
+    g_app.Application::init(args);
+    g_ui.init();
+
+    for (const OTMLNodePtr& node : OTMLDocument::parseString(styles, "uistyles")->children())
+        g_ui.importStyleFromOTML(node);
+    OTMLNodePtr instanceNode = OTMLDocument::parseString(instance, "uistyles")->children().front();
+
+    UIWidgetPtr list = g_ui.createWidget("UIWidget", g_ui.getRootWidget());
+    const std::string names[] = { "style name", "style with ! tags", "instance node" };
+
+    std::cout << std::fixed << std::setprecision(2);
+    for (const std::string& name : names) {
+        stdext::timer timer;
+        for (int i = 0; i < rows; ++i) {
+            if (name == "style name")
+                g_ui.createWidget("BenchRow", list);
+            else if (name == "style with ! tags")
+                g_ui.createWidget("BenchDynamicRow", list);
+            else
+                g_ui.createWidgetFromOTML(instanceNode, list);
+        }
+        ticks_t elapsed = timer.elapsed_micros();
+        std::cout << std::left << std::setw(20) << name << std::right << std::setw(10) << elapsed / 1000.0 << " ms "
+                  << std::setw(10) << elapsed * 1000.0 / rows << " ns/row\n";
+
+        list->destroyChildren();
+        g_dispatcher.poll();
+    }
+
+    list->destroy();
+    g_ui.terminate();
+    g_app.Application::deinit();
+    g_app.Application::terminate();
+    return 0;
+}
@@ -0,0 +1,221 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Visible tiles benchmark. Walks a camera over a generated map with roofs, a cave below and tiles
+// changing on the way, the way the server sends them, and keeps two map views updated: one with the
+// incremental cache, which only reads the tiles entering the view, and one rescanned every step. The
+// tiles listed for each floor must be the same in both after every scroll and floor change.
+// usage: otclient_visibletiles <client version> [steps]
+// the things are read from things/<client version>/ in the working directory, like packetreplay
+
+#include <framework/core/application.h>
+#include <framework/core/modulemanager.h>
+#include <framework/core/resourcemanager.h>
+#include <framework/luaengine/luainterface.h>
+#include <framework/stdext/time.h>
+#include <client/client.h>
+#include <client/creature.h>
+#include <client/game.h>
+#include <client/item.h>
+#include <client/map.h>
+#include <client/mapview.h>
+#include <client/thingtypemanager.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+
+static uint16 groundId = 0;
+static uint16 itemId = 0;
+
+// ground everywhere on the surface and in the cave, houses with roofs and a few higher buildings
+static bool hasTile(const Position& pos)
+{
+    if (pos.z == 7 || pos.z == 8)
+        return true;
+    if (pos.z == 6)
+        return ((pos.x >> 4) + (pos.y >> 4)) % 3 == 0 && (pos.x & 15) < 10 && (pos.y & 15) < 10;
+    if (pos.z == 5)
+        return ((pos.x >> 5) + (pos.y >> 5)) % 4 == 0 && (pos.x & 31) < 12 && (pos.y & 31) < 12;
+    return false;
+}
+
+static void addTile(const Position& pos)
+{
+    g_map.addThing(Item::create(groundId), pos);
+    if ((pos.x * 7 + pos.y * 13) % 5 == 0)
+        g_map.addThing(Item::create(itemId), pos);
+}
+
+// the server sends the tiles entering the aware range before the player moves
+static void sendAwareTiles(const Position& center)
+{
+    const AwareRange range = g_map.getAwareRange();
+    const int firstFloor = center.z > Otc::SEA_FLOOR ? center.z - Otc::AWARE_UNDEGROUND_FLOOR_RANGE : 0;
+    const int lastFloor = center.z > Otc::SEA_FLOOR ? center.z + Otc::AWARE_UNDEGROUND_FLOOR_RANGE : Otc::SEA_FLOOR;
+    for (int z = std::max(firstFloor, 0); z <= std::min(lastFloor, (int)Otc::MAX_Z); ++z) {
+        const int offset = center.z - z;
+        for (int y = -range.top; y <= range.bottom; ++y) {
+            for (int x = -range.left; x <= range.right; ++x) {
+                Position pos(center.x + x + offset, center.y + y + offset, z);
+                if (hasTile(pos) && !g_map.getTile(pos))
+                    addTile(pos);
+            }
+        }
+    }
+}
+
+static Position nextPosition(const Position& pos, int step)
+{
+    // a loop around the map, with diagonal steps, going down into the cave and back up from time to time
+    Position next = pos;
+    int phase = (step / 40) % 4;
+    next.x += phase == 0 ? 1 : phase == 2 ? -1 : 0;
+    next.y += phase == 1 ? 1 : phase == 3 ? -1 : 0;
+    if (step % 5 == 0)
+        next.y += phase == 0 ? 1 : phase == 2 ? -1 : 0;
+    if (step % 150 == 0)
+        next.z = 8;
+    else if (step % 150 == 12)
+        next.z = 7;
+    return next;
+}
+
+int main(int argc, const char* argv[])
+{
+    std::vector<std::string> args(argv, argv + argc);
+    if (args.size() < 2 || (args.size() > 2 && stdext::unsafe_cast<int>(args[2]) <= 0)) {
+        std::cout << "usage: " << args[0] << " <client version> [steps]" << std::endl;
+        return 1;
+    }
+
+    const int version = stdext::unsafe_cast<int>(args[1]);
+    const int steps = args.size() > 2 ? stdext::unsafe_cast<int>(args[2]) : 3000;
+
+    g_resources.init(argv[0]);
+    g_app.setName("OTClientV8");
+    g_app.setCompactName(g_resources.getCompactName());
+
+    g_app.Application::init(args);
+    g_client.registerLuaFunctions();
+    g_map.init();
+    g_game.init();
+    g_things.init();
+
+    g_resources.setupWriteDir(g_app.getName(), g_app.getCompactName());
+    g_resources.setup();
+
+    // game features are set from lua when the client version changes
+    g_modules.discoverModules();
+    g_modules.ensureModuleLoaded("corelib");
+    g_modules.ensureModuleLoaded("gamelib");
+    g_modules.ensureModuleLoaded("game_features");
+
+    g_game.setClientVersion(version);
+    g_game.setProtocolVersion(g_lua.callGlobalField<int, int>("g_game", "getClientProtocolVersion", version));
+
+    const std::string things = stdext::format("/things/%d/Tibia", version);
+    if (!g_things.loadDat(things)) {
+        g_game.enableFeature(Otc::GameSpritesU32);
+        if (!g_things.loadDat(things)) {
+            std::cout << "unable to load " << things << ".dat" << std::endl;
+            return 1;
+        }
+    }
+
+    const ThingTypeList& itemTypes = g_things.getThingTypes(ThingCategoryItem);
+    for (size_t id = 100; id < itemTypes.size() && (!groundId || !itemId); ++id) {
+        const ThingTypePtr& type = itemTypes[id];
+        if (!groundId && type->isGround() && !type->isDontHide())
+            groundId = id;
+        else if (!itemId && !type->isGround() && !type->isGroundBorder() && !type->isOnBottom() && !type->isOnTop())
+            itemId = id;
+    }
+
+    Position position(32000, 32000, 7);
+    CreaturePtr camera = std::make_shared<Creature>();
+    camera->setPosition(position);
+    sendAwareTiles(position);
+    g_map.setCentralPosition(position);
+
+    MapViewPtr incremental = std::make_shared<MapView>();
+    MapViewPtr full = std::make_shared<MapView>();
+    for (const MapViewPtr& view : { incremental, full }) {
+        g_map.addMapView(view);
+        view->followCreature(camera);
+        view->updateVisibleTilesCache();
+    }
+
+    ticks_t incrementalTime = 0, fullTime = 0;
+    size_t listed = 0;
+    bool failed = false;
+    for (int step = 1; step <= steps && !failed; ++step) {
+        position = nextPosition(position, step);
+        sendAwareTiles(position);
+        camera->setPosition(position);
+        g_map.setCentralPosition(position);
+
+        // a few tiles in view are cleared and sent again, like items being moved
+        for (int i = 0; i < 3; ++i) {
+            Position pos(position.x + (step * 7 + i * 5) % 15 - 7, position.y + (step * 3 + i * 11) % 11 - 5, position.z);
+            g_map.cleanTile(pos);
+            if ((step + i) % 2 == 0 && hasTile(pos))
+                addTile(pos);
+        }
+
+        stdext::timer timer;
+        incremental->updateVisibleTilesCache();
+        incrementalTime += timer.elapsed_micros();
+
+        timer.restart();
+        full->requestVisibleTilesCacheUpdate();
+        full->updateVisibleTilesCache();
+        fullTime += timer.elapsed_micros();
+
+        for (int z = 0; z <= Otc::MAX_Z; ++z) {
+            listed += full->getCachedVisibleTiles(z).size();
+            if (incremental->getCachedVisibleTiles(z) != full->getCachedVisibleTiles(z)) {
+                std::cout << "step " << step << " at " << position << ": the tiles of floor " << z
+                          << " differ from a full rescan, " << incremental->getCachedVisibleTiles(z).size()
+                          << " listed instead of " << full->getCachedVisibleTiles(z).size() << std::endl;
+                failed = true;
+                break;
+            }
+        }
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << steps << " steps, " << listed / std::max(steps, 1) << " tiles listed per step\n";
+    std::cout << std::left << std::setw(14) << "full" << std::right << std::setw(10) << fullTime / (double)steps << " us/step\n";
+    std::cout << std::left << std::setw(14) << "incremental" << std::right << std::setw(10) << incrementalTime / (double)steps << " us/step\n";
+
+    for (const MapViewPtr& view : { incremental, full })
+        g_map.removeMapView(view);
+    incremental = nullptr;
+    full = nullptr;
+    camera = nullptr;
+
+    g_app.Application::deinit();
+    g_client.terminate();
+    g_app.Application::terminate();
+    return failed ? 1 : 0;
+}
@@ -108,6 +108,7 @@ void Animator::setPhase(int phase)
 
 int Animator::getPhase()
 {
+    std::lock_guard<std::mutex> lock(m_mutex);
     ticks_t ticks = g_clock.millis();
     if(ticks != m_lastPhaseTicks && !m_isComplete) {
         int elapsedTicks = (int)(ticks - m_lastPhaseTicks);
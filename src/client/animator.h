@@ -85,6 +85,9 @@ private:
     bool m_isComplete;
 
     int m_phase;
+
+    // thing type animators are shared by every thing of the type, which may be drawn by several threads
+    std::mutex m_mutex;
 };
 
 #endif
@@ -46,6 +46,7 @@
 #include <framework/util/extras.h>
 
 std::array<double, Otc::LastSpeedFormula> Creature::m_speedFormula = { -1,-1,-1 };
+thread_local bool Creature::m_drawWidgets = true;
 
 Creature::Creature() : Thing()
 {
@@ -1137,6 +1138,9 @@ void Creature::clearDirectionalWidgets()
 
 void Creature::drawTopWidgets(const Point& dest, const Otc::Direction direction)
 {
+    if (!m_drawWidgets)
+        return;
+
     if (direction == Otc::North || direction == Otc::West) {
         for (auto& widget : m_directionalWidgets) {
             Rect dest_rect = widget->getRect();
@@ -1155,6 +1159,9 @@ void Creature::drawTopWidgets(const Point& dest, const Otc::Direction direction)
 
 void Creature::drawBottomWidgets(const Point& dest, const Otc::Direction direction)
 {
+    if (!m_drawWidgets)
+        return;
+
     for (auto& widget : m_bottomWidgets) {
         Rect dest_rect = widget->getRect();
         dest_rect = Rect(dest - Point(dest_rect.width() / 2, dest_rect.height() / 2), dest_rect.width(), dest_rect.height());
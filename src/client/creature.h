@@ -192,6 +192,9 @@ public:
     void clearDirectionalWidgets();
     void drawTopWidgets(const Point& rect, const Otc::Direction direction);
     void drawBottomWidgets(const Point& rect, const Otc::Direction direction);
+    bool hasWidgets() { return !m_topWidgets.empty() || !m_bottomWidgets.empty() || !m_directionalWidgets.empty(); }
+    // widgets aren't thread safe, they are left out while the map is drawn outside of the dispatcher thread
+    static void setDrawWidgets(bool drawWidgets) { m_drawWidgets = drawWidgets; }
 
     // progress bar
     uint8 getProgressBarPercent() { return m_progressBarPercent; }
@@ -249,6 +252,7 @@ protected:
     Color m_titleColor;
 
     static std::array<double, Otc::LastSpeedFormula> m_speedFormula;
+    static thread_local bool m_drawWidgets;
 
     // walk related
     int m_walkAnimationPhase;
@@ -603,6 +603,14 @@ void Game::playRecord(const std::string& file)
     m_worldName = "Record";
 }
 
+void Game::seekRecord(ticks_t time)
+{
+    if (!m_protocolGame || !m_protocolGame->getPlayer())
+        stdext::throw_exception("Unable to seek, no record is being played.");
+
+    m_protocolGame->getPlayer()->seek(time);
+}
+
 void Game::cancelLogin()
 {
     // send logout even if the game has not started yet, to make sure that the player doesn't stay logged there
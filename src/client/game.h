@@ -171,6 +171,7 @@ public:
     // login related
     void loginWorld(const std::string& account, const std::string& password, const std::string& worldName, const std::string& worldHost, int worldPort, const std::string& characterName, const std::string& authenticatorToken, const std::string& sessionKey, const std::string& recordTo = "");
     void playRecord(const std::string& file);
+    void seekRecord(ticks_t time);
     void cancelLogin();
     void forceLogout();
     void safeLogout();
@@ -23,62 +23,198 @@
 #include "lightview.h"
 #include "spritemanager.h"
 #include <framework/graphics/painter.h>
+#include <framework/core/adaptiverenderer.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define LIGHTVIEW_SSE2
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define LIGHTVIEW_NEON
+#endif
+
+namespace {
+
+// dst = max(dst, src) for every byte, 16 bytes at once when the cpu can
+void maxBytes(uint8_t* dst, const uint8_t* src, size_t size)
+{
+    size_t i = 0;
+#if defined(LIGHTVIEW_SSE2)
+    for (; i + 16 <= size; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(src + i));
+        _mm_storeu_si128((__m128i*)(dst + i), _mm_max_epu8(a, b));
+    }
+#elif defined(LIGHTVIEW_NEON)
+    for (; i + 16 <= size; i += 16)
+        vst1q_u8(dst + i, vmaxq_u8(vld1q_u8(dst + i), vld1q_u8(src + i)));
+#endif
+    for (; i < size; ++i)
+        dst[i] = std::max(dst[i], src[i]);
+}
+
+}
+
+void LightMap::update(const Size& size, const Color& globalLight, std::vector<LightSource>& lights, const std::vector<uint8_t>& tileFloors)
+{
+    std::sort(lights.begin(), lights.end());
+    lights.erase(std::unique(lights.begin(), lights.end()), lights.end());
+
+    m_dirtyMinX.assign(size.height(), size.width());
+    m_dirtyMaxX.assign(size.height(), -1);
+    m_uploadTop = size.height();
+    m_uploadBottom = -1;
+
+    if (size != m_size || globalLight != m_globalLight || m_pixels.empty()) {
+        m_size = size;
+        m_globalLight = globalLight;
+        m_pixels.resize(size.area() * 4);
+        m_lightRow.resize(size.width() * 4);
+        m_textureId = 0; // upload everything
+        markDirty(Rect(0, 0, size));
+    } else {
+        // both lists are sorted, lights found in only one of them were added or removed
+        auto prev = m_lights.begin(), cur = lights.begin();
+        while (prev != m_lights.end() || cur != lights.end()) {
+            if (cur == lights.end() || (prev != m_lights.end() && *prev < *cur))
+                markDirty(getBounds(*prev++));
+            else if (prev == m_lights.end() || *cur < *prev)
+                markDirty(getBounds(*cur++));
+            else
+                ++prev, ++cur;
+        }
+        for (size_t i = 0; i < tileFloors.size(); ++i) {
+            if (tileFloors[i] != m_tileFloors[i])
+                markDirty(Rect(i % size.width(), i / size.width(), 1, 1));
+        }
+    }
+    m_tileFloors = tileFloors;
+    m_lights.swap(lights);
+
+    for (int y = m_uploadTop; y <= m_uploadBottom; ++y) {
+        for (int x = m_dirtyMinX[y]; x <= m_dirtyMaxX[y]; ++x) {
+            uint8_t* pixel = &m_pixels[(y * size.width() + x) * 4];
+            pixel[0] = m_globalLight.r();
+            pixel[1] = m_globalLight.g();
+            pixel[2] = m_globalLight.b();
+            pixel[3] = 255; // alpha channel
+        }
+    }
+
+    for (const LightSource& light : m_lights) {
+        Rect bounds = getBounds(light);
+        int top = std::max<int>(bounds.top(), m_uploadTop), bottom = std::min<int>(bounds.bottom(), m_uploadBottom);
+        for (int y = top; y <= bottom; ++y) {
+            int minX = std::max<int>(bounds.left(), m_dirtyMinX[y]), maxX = std::min<int>(bounds.right(), m_dirtyMaxX[y]);
+            if (minX <= maxX)
+                splat(light, y, minX, maxX);
+        }
+    }
+}
+
+bool LightMap::mustUpdate(const TexturePtr& texture, const Size& size, int interval)
+{
+    if (size != m_size || texture->getId() != m_textureId || stdext::millis() >= m_lastUpdate + interval) {
+        m_lastUpdate = stdext::millis();
+        return true;
+    }
+    return false;
+}
+
+void LightMap::upload(const TexturePtr& texture)
+{
+    texture->update();
+    glBindTexture(GL_TEXTURE_2D, texture->getId());
+    if (texture->getId() != m_textureId) {
+        m_textureId = texture->getId();
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_size.width(), m_size.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, m_pixels.data());
+    } else if (m_uploadTop <= m_uploadBottom) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, m_uploadTop, m_size.width(), m_uploadBottom - m_uploadTop + 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                        &m_pixels[m_uploadTop * m_size.width() * 4]);
+    }
+}
+
+Rect LightMap::getBounds(const LightSource& light)
+{
+    // the light only reaches fields whose center is closer than its intensity, in fields
+    const int spriteSize = g_sprites.spriteSize();
+    const int radius = light.intensity * spriteSize;
+    int left = std::max<int>(0, std::floor((float)(light.pos.x - radius) / spriteSize));
+    int top = std::max<int>(0, std::floor((float)(light.pos.y - radius) / spriteSize));
+    int right = std::min<int>(m_size.width() - 1, std::floor((float)(light.pos.x + radius) / spriteSize));
+    int bottom = std::min<int>(m_size.height() - 1, std::floor((float)(light.pos.y + radius) / spriteSize));
+    return Rect(Point(left, top), Point(right, bottom));
+}
+
+void LightMap::markDirty(const Rect& rect)
+{
+    if (rect.left() > rect.right() || rect.top() > rect.bottom()) // off the map
+        return;
+
+    for (int y = rect.top(); y <= rect.bottom(); ++y) {
+        m_dirtyMinX[y] = std::min<int>(m_dirtyMinX[y], rect.left());
+        m_dirtyMaxX[y] = std::max<int>(m_dirtyMaxX[y], rect.right());
+    }
+    m_uploadTop = std::min<int>(m_uploadTop, rect.top());
+    m_uploadBottom = std::max<int>(m_uploadBottom, rect.bottom());
+}
+
+void LightMap::splat(const LightSource& light, int y, int minX, int maxX)
+{
+    const int spriteSize = g_sprites.spriteSize();
+    const Color color = Color::from8bit(light.color);
+    const float dy = y * spriteSize + spriteSize / 2 - light.pos.y;
+
+    bool lit = false;
+    uint8_t* row = m_lightRow.data();
+    for (int x = minX; x <= maxX; ++x, row += 4) {
+        row[0] = row[1] = row[2] = row[3] = 0;
+        if (light.floor > m_tileFloors[y * m_size.width() + x])
+            continue;
+        float dx = x * spriteSize + spriteSize / 2 - light.pos.x;
+        float distance = std::sqrt(dx * dx + dy * dy) / spriteSize;
+        float intensity = (-distance + light.intensity) * 0.2f;
+        if (intensity < 0.01f) continue;
+        if (intensity > 1.0f) intensity = 1.0f;
+        Color lightColor = color * intensity;
+        row[0] = lightColor.r();
+        row[1] = lightColor.g();
+        row[2] = lightColor.b();
+        lit = true;
+    }
+
+    if (lit)
+        maxBytes(&m_pixels[(y * m_size.width() + minX) * 4], m_lightRow.data(), (maxX - minX + 1) * 4);
+}
 
 void LightView::addLight(const Point& pos, uint8_t color, uint8_t intensity)
 {
     if (!m_lights.empty()) {
-        Light& prevLight = m_lights.back();
-        if (prevLight.pos == pos && prevLight.color == color) {
+        LightSource& prevLight = m_lights.back();
+        if (prevLight.pos == pos && prevLight.color == color && prevLight.floor == m_floor) {
             prevLight.intensity = std::max(prevLight.intensity, intensity);
             return;
         }
     }
-    m_lights.push_back(Light{ pos, color, intensity });
+    m_lights.push_back(LightSource{ pos, color, intensity, m_floor });
 }
 
-void LightView::setFieldBrightness(const Point& pos, size_t start, uint8_t color)
+void LightView::setFieldBrightness(const Point& pos, int floor)
 {
     size_t index = (pos.y / g_sprites.spriteSize()) * m_mapSize.width() + (pos.x / g_sprites.spriteSize());
-    if (index >= m_tiles.size()) return;
-    m_tiles[index].start = start;
-    m_tiles[index].color = color;
+    if (index >= m_tileFloors.size()) return;
+    m_tileFloors[index] = floor;
 }
 
 void LightView::draw() // render thread
 {
-    // TODO: optimize in the future for big areas
-    static std::vector<uint8_t> buffer;
-    if (buffer.size() < 4u * m_mapSize.area())
-        buffer.resize(m_mapSize.area() * 4);
-
-    for (int x = 0; x < m_mapSize.width(); ++x) {
-        for (int y = 0; y < m_mapSize.height(); ++y) {
-            Point pos(x * g_sprites.spriteSize() + g_sprites.spriteSize() / 2, y * g_sprites.spriteSize() + g_sprites.spriteSize() / 2);
-            int index = (y * m_mapSize.width() + x);
-            int colorIndex = index * 4;
-            buffer[colorIndex] = m_globalLight.r();
-            buffer[colorIndex + 1] = m_globalLight.g();
-            buffer[colorIndex + 2] = m_globalLight.b();
-            buffer[colorIndex + 3] = 255; // alpha channel
-            for (size_t i = m_tiles[index].start; i < m_lights.size(); ++i) {
-                Light& light = m_lights[i];
-                float distance = std::sqrt((pos.x - light.pos.x) * (pos.x - light.pos.x) +
-                                           (pos.y - light.pos.y) * (pos.y - light.pos.y));
-                distance /= g_sprites.spriteSize();
-                float intensity = (-distance + light.intensity) * 0.2f;
-                if (intensity < 0.01f) continue;
-                if (intensity > 1.0f) intensity = 1.0f;
-                Color lightColor = Color::from8bit(light.color) * intensity;
-                buffer[colorIndex] = std::max<int>(buffer[colorIndex], lightColor.r());
-                buffer[colorIndex + 1] = std::max<int>(buffer[colorIndex + 1], lightColor.g());
-                buffer[colorIndex + 2] = std::max<int>(buffer[colorIndex + 2], lightColor.b());
-            }
-        }
+    ticks_t start = stdext::micros();
+    // the lights may lag behind the map when they are the expensive part of the frame
+    if (m_lightMap->mustUpdate(m_lightTexture, m_mapSize, g_adaptiveRenderer.lightUpdateInterval())) {
+        m_lightMap->update(m_mapSize, m_globalLight, m_lights, m_tileFloors);
+        m_lightMap->upload(m_lightTexture);
     }
-
-    m_lightTexture->update();
-    glBindTexture(GL_TEXTURE_2D, m_lightTexture->getId());
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_mapSize.width(), m_mapSize.height(), 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer.data());
+    g_adaptiveRenderer.addStageTime(ADAPTIVE_STAGE_LIGHT, stdext::micros() - start);
 
     Point offset = m_src.topLeft();
     Size size = m_src.size();
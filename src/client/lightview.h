@@ -29,18 +29,59 @@
 #include <framework/graphics/drawqueue.h>
 #include <set>
 
-struct TileLight {
-    size_t start;
+struct LightSource {
+    Point pos;
     uint8_t color;
+    uint8_t intensity;
+    uint8_t floor;
+
+    bool operator<(const LightSource& other) const {
+        return std::tie(pos.y, pos.x, color, intensity, floor) < std::tie(other.pos.y, other.pos.x, other.color, other.intensity, other.floor);
+    }
+    bool operator==(const LightSource& other) const {
+        return pos == other.pos && color == other.color && intensity == other.intensity && floor == other.floor;
+    }
+};
+
+// Light map kept by the map view between frames, only used by the render thread.
+// Only the tiles reached by lights that appeared or disappeared since the previous frame,
+// or whose covering floor changed, are recomputed and uploaded again.
+class LightMap
+{
+public:
+    void update(const Size& size, const Color& globalLight, std::vector<LightSource>& lights, const std::vector<uint8_t>& tileFloors);
+    void upload(const TexturePtr& texture);
+    // false while the texture still shows a light map updated less than interval ms ago
+    bool mustUpdate(const TexturePtr& texture, const Size& size, int interval);
+    const std::vector<uint8_t>& getPixels() { return m_pixels; }
+    // rows uploaded by the next upload to the same texture
+    int getDirtyRows() { return std::max(0, m_uploadBottom - m_uploadTop + 1); }
+
+private:
+    Rect getBounds(const LightSource& light);
+    void markDirty(const Rect& rect);
+    void splat(const LightSource& light, int y, int minX, int maxX);
+
+    Size m_size;
+    Color m_globalLight;
+    std::vector<LightSource> m_lights;
+    std::vector<uint8_t> m_tileFloors;
+    std::vector<uint8_t> m_pixels;
+    std::vector<uint8_t> m_lightRow;
+    std::vector<int> m_dirtyMinX, m_dirtyMaxX;
+    int m_uploadTop = 0, m_uploadBottom = -1;
+    uint m_textureId = 0;
+    ticks_t m_lastUpdate = 0;
 };
+using LightMapPtr = std::shared_ptr<LightMap>;
 
 class LightView : public DrawQueueItem
 {
 public:
-    LightView(TexturePtr& lightTexture, const Size& mapSize, const Rect& dest, const Rect& src, uint8_t color, uint8_t intensity) :
-        DrawQueueItem(nullptr), m_lightTexture(lightTexture), m_mapSize(mapSize), m_dest(dest), m_src(src) {
+    LightView(TexturePtr& lightTexture, const LightMapPtr& lightMap, const Size& mapSize, const Rect& dest, const Rect& src, uint8_t color, uint8_t intensity) :
+        DrawQueueItem(nullptr), m_lightTexture(lightTexture), m_lightMap(lightMap), m_mapSize(mapSize), m_dest(dest), m_src(src) {
         m_globalLight = Color::from8bit(color) * ((float)intensity / 255.f);
-        m_tiles.resize(m_mapSize.area(), TileLight{ 0, 0 });
+        m_tileFloors.resize(m_mapSize.area(), 255);
     }
 
     inline void addLight(const Point& pos, const Light& light)
@@ -48,18 +89,22 @@ public:
         return addLight(pos, light.color, light.intensity);
     }
     void addLight(const Point& pos, uint8_t color, uint8_t intensity);
-    void setFieldBrightness(const Point& pos, size_t start, uint8_t color);
+    // lights of the floors drawn before this one don't reach the field
+    void setFieldBrightness(const Point& pos, int floor);
+    void setFloor(int floor) { m_floor = floor; }
     size_t size() { return m_lights.size(); }
 
     void draw() override;
 
 private:
     TexturePtr m_lightTexture;
+    LightMapPtr m_lightMap;
     Size m_mapSize;
     Rect m_dest, m_src;
     Color m_globalLight;
-    std::vector<Light> m_lights;
-    std::vector<TileLight> m_tiles;
+    uint8_t m_floor = 0;
+    std::vector<LightSource> m_lights;
+    std::vector<uint8_t> m_tileFloors;
 };
 
 #endif
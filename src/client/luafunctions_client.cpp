@@ -58,6 +58,11 @@ void Client::registerLuaFunctions()
 {
     g_lua.registerSingletonClass("g_things");
     g_lua.bindSingletonFunction("g_things", "loadDat", &ThingTypeManager::loadDat, &g_things);
+    g_lua.bindSingletonFunction("g_things", "setTexturesMemoryBudget", &ThingTypeManager::setTexturesMemoryBudget, &g_things);
+    g_lua.bindSingletonFunction("g_things", "getTexturesMemoryBudget", &ThingTypeManager::getTexturesMemoryBudget, &g_things);
+    g_lua.bindSingletonFunction("g_things", "getTexturesMemoryUsage", &ThingTypeManager::getTexturesMemoryUsage, &g_things);
+    g_lua.bindSingletonFunction("g_things", "getTexturesStats", &ThingTypeManager::getTexturesStats, &g_things);
+    g_lua.bindSingletonFunction("g_things", "resetTexturesStats", &ThingTypeManager::resetTexturesStats, &g_things);
 #ifdef WITH_ENCRYPTION
     g_lua.bindSingletonFunction("g_things", "saveDat", &ThingTypeManager::saveDat, &g_things);
     g_lua.bindSingletonFunction("g_things", "dumpTextures", &ThingTypeManager::dumpTextures, &g_things);
@@ -170,6 +175,7 @@ void Client::registerLuaFunctions()
     g_lua.bindSingletonFunction("g_map", "findItemsById", &Map::findItemsById, &g_map);
     g_lua.bindSingletonFunction("g_map", "getAwareRange", &Map::getAwareRangeAsSize, &g_map);
     g_lua.bindSingletonFunction("g_map", "findEveryPath", &Map::findEveryPath, &g_map);
+    g_lua.bindSingletonFunction("g_map", "findPathsAsync", &Map::findPathsAsync, &g_map);
     g_lua.bindSingletonFunction("g_map", "getMinimapColor", &Map::getMinimapColor, &g_map);
     g_lua.bindSingletonFunction("g_map", "isPatchable", &Map::isPatchable, &g_map);
     g_lua.bindSingletonFunction("g_map", "isWalkable", &Map::isWalkable, &g_map);
@@ -208,6 +214,7 @@ void Client::registerLuaFunctions()
     g_lua.registerSingletonClass("g_game");
     g_lua.bindSingletonFunction("g_game", "loginWorld", &Game::loginWorld, &g_game);
     g_lua.bindSingletonFunction("g_game", "playRecord", &Game::playRecord, &g_game);
+    g_lua.bindSingletonFunction("g_game", "seekRecord", &Game::seekRecord, &g_game);
     g_lua.bindSingletonFunction("g_game", "cancelLogin", &Game::cancelLogin, &g_game);
     g_lua.bindSingletonFunction("g_game", "forceLogout", &Game::forceLogout, &g_game);
     g_lua.bindSingletonFunction("g_game", "safeLogout", &Game::safeLogout, &g_game);
@@ -374,6 +381,8 @@ void Client::registerLuaFunctions()
 
     g_lua.registerClass<ProtocolGame, Protocol>();
     g_lua.bindClassStaticFunction<ProtocolGame>("create", []{ return std::make_shared<ProtocolGame>(); });
+    g_lua.bindClassStaticFunction<ProtocolGame>("setOpcodeInterest", &ProtocolGame::setOpcodeInterest);
+    g_lua.bindClassStaticFunction<ProtocolGame>("hasOpcodeInterest", &ProtocolGame::hasOpcodeInterest);
     g_lua.bindClassMemberFunction<ProtocolGame>("login", &ProtocolGame::login);
     g_lua.bindClassMemberFunction<ProtocolGame>("sendExtendedOpcode", &ProtocolGame::sendExtendedOpcode);
     g_lua.bindClassMemberFunction<ProtocolGame>("addPosition", &ProtocolGame::addPosition);
@@ -349,3 +349,19 @@ bool luavalue_cast(int index, UnjustifiedPoints& unjustifiedPoints)
     }
     return false;
 }
+
+int push_luavalue(const PathFindResult_ptr& result)
+{
+    g_lua.createTable(0, 5);
+    g_lua.pushInteger(result->status);
+    g_lua.setField("status");
+    push_luavalue(result->path);
+    g_lua.setField("path");
+    g_lua.pushInteger(result->complexity);
+    g_lua.setField("complexity");
+    push_luavalue(result->start);
+    g_lua.setField("start");
+    push_luavalue(result->destination);
+    g_lua.setField("destination");
+    return 1;
+}
@@ -27,6 +27,7 @@
 #include <framework/luaengine/declarations.h>
 #include "game.h"
 #include "outfit.h"
+#include "map.h"
 
 // outfit
 int push_luavalue(const Outfit& outfit);
@@ -59,4 +60,7 @@ bool luavalue_cast(int index, Light& light);
 int push_luavalue(const UnjustifiedPoints& unjustifiedPoints);
 bool luavalue_cast(int index, UnjustifiedPoints& unjustifiedPoints);
 
+// path find result
+int push_luavalue(const PathFindResult_ptr& result);
+
 #endif
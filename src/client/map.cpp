@@ -39,6 +39,70 @@
 Map g_map;
 TilePtr Map::m_nulltile = nullptr;
 
+uint TileBlockMap::findSlot(uint index) const
+{
+    const uint mask = m_slots.size() - 1;
+    for(uint slot = hash(index); ; slot = (slot + 1) & mask) {
+        if(m_slots[slot] == 0 || m_keys[m_slots[slot] - 1] == index)
+            return slot;
+    }
+}
+
+TileBlock& TileBlockMap::insert(uint index)
+{
+    // keep load factor under 50%, so probe sequences stay short
+    if((m_blocks.size() + 1) * 2 > m_slots.size())
+        rehash(std::max<size_t>(64, m_slots.size() * 2));
+
+    m_keys.push_back(index);
+    m_blocks.push_back(std::make_unique<TileBlock>());
+    m_slots[findSlot(index)] = m_blocks.size();
+    return *m_blocks.back();
+}
+
+void TileBlockMap::erase(uint index)
+{
+    if(m_slots.empty())
+        return;
+
+    uint slot = findSlot(index);
+    uint32 dense = m_slots[slot];
+    if(dense == 0)
+        return;
+
+    // move last block into the hole to keep blocks contiguous
+    size_t last = m_blocks.size();
+    if(dense != last) {
+        m_slots[findSlot(m_keys[last - 1])] = dense;
+        m_keys[dense - 1] = m_keys[last - 1];
+        m_blocks[dense - 1] = std::move(m_blocks[last - 1]);
+    }
+    m_keys.pop_back();
+    m_blocks.pop_back();
+
+    // backward shift deletion, no tombstones needed
+    const uint mask = m_slots.size() - 1;
+    uint hole = slot;
+    for(uint next = (hole + 1) & mask; m_slots[next] != 0; next = (next + 1) & mask) {
+        uint home = hash(m_keys[m_slots[next] - 1]);
+        if(((next - home) & mask) >= ((next - hole) & mask)) {
+            m_slots[hole] = m_slots[next];
+            hole = next;
+        }
+    }
+    m_slots[hole] = 0;
+}
+
+void TileBlockMap::rehash(size_t capacity)
+{
+    m_shift = 32;
+    for(size_t size = capacity; size > 1; size >>= 1)
+        --m_shift;
+    m_slots.assign(capacity, 0);
+    for(size_t i = 0; i < m_keys.size(); ++i)
+        m_slots[findSlot(m_keys[i])] = i + 1;
+}
+
 void Map::init()
 {
     resetAwareRange();
@@ -80,7 +144,7 @@ void Map::notificateTileUpdate(const Position& pos, bool updateMinimap)
 
 void Map::requestVisibleTilesCacheUpdate() {
     for (const MapViewPtr& mapView : m_mapViews)
-        mapView->requestVisibleTilesCacheUpdate();
+        mapView->requestVisibleTilesCacheUpdate(false);
 }
 
 void Map::clean()
@@ -90,6 +154,9 @@ void Map::clean()
     for(int i=0;i<=Otc::MAX_Z;++i)
         m_tileBlocks[i].clear();
 
+    for(const MapViewPtr& mapView : m_mapViews)
+        mapView->requestVisibleTilesCacheUpdate();
+
     m_waypoints.clear();
 
     g_towns.clear();
@@ -308,7 +375,9 @@ const TilePtr& Map::createTile(const Position& pos)
     if(pos.y > m_tilesRect.bottom())
         m_tilesRect.setBottom(pos.y);
     TileBlock& block = m_tileBlocks[pos.z][getBlockIndex(pos)];
-    return block.create(pos);
+    const TilePtr& tile = block.create(pos);
+    notificateTileUpdate(pos, false);
+    return tile;
 }
 
 template <typename... Items>
@@ -337,16 +406,19 @@ const TilePtr& Map::getOrCreateTile(const Position& pos)
     if(pos.y > m_tilesRect.bottom())
         m_tilesRect.setBottom(pos.y);
     TileBlock& block = m_tileBlocks[pos.z][getBlockIndex(pos)];
-    return block.getOrCreate(pos);
+    if(const TilePtr& tile = block.get(pos))
+        return tile;
+    const TilePtr& tile = block.create(pos);
+    notificateTileUpdate(pos, false);
+    return tile;
 }
 
 const TilePtr& Map::getTile(const Position& pos)
 {
     if(!pos.isMapPosition())
         return m_nulltile;
-    auto it = m_tileBlocks[pos.z].find(getBlockIndex(pos));
-    if(it != m_tileBlocks[pos.z].end())
-        return it->second.get(pos);
+    if(TileBlock* block = m_tileBlocks[pos.z].find(getBlockIndex(pos)))
+        return block->get(pos);
     return m_nulltile;
 }
 
@@ -359,9 +431,8 @@ const TileList Map::getTiles(int floor/* = -1*/)
     else if(floor < 0) {
         // Search all floors
         for(uint8_t z = 0; z <= Otc::MAX_Z; ++z) {
-            for(const auto& pair : m_tileBlocks[z]) {
-                const TileBlock& block = pair.second;
-                for(const TilePtr& tile : block.getTiles()) {
+            for(const auto& block : m_tileBlocks[z]) {
+                for(const TilePtr& tile : block->getTiles()) {
                     if(tile != nullptr)
                         tiles.push_back(tile);
                 }
@@ -369,9 +440,8 @@ const TileList Map::getTiles(int floor/* = -1*/)
         }
     }
     else {
-        for(const auto& pair : m_tileBlocks[floor]) {
-            const TileBlock& block = pair.second;
-            for(const TilePtr& tile : block.getTiles()) {
+        for(const auto& block : m_tileBlocks[floor]) {
+            for(const TilePtr& tile : block->getTiles()) {
                 if(tile != nullptr)
                     tiles.push_back(tile);
             }
@@ -384,13 +454,11 @@ void Map::cleanTile(const Position& pos)
 {
     if(!pos.isMapPosition())
         return;
-    auto it = m_tileBlocks[pos.z].find(getBlockIndex(pos));
-    if(it != m_tileBlocks[pos.z].end()) {
-        TileBlock& block = it->second;
-        if(const TilePtr& tile = block.get(pos)) {
+    if(TileBlock* block = m_tileBlocks[pos.z].find(getBlockIndex(pos))) {
+        if(const TilePtr& tile = block->get(pos)) {
             tile->clean();
             if(tile->canErase())
-                block.remove(pos);
+                block->remove(pos);
 
             notificateTileUpdate(pos, false);
         }
@@ -471,9 +539,8 @@ std::map<Position, ItemPtr> Map::findItemsById(uint16 clientId, uint32 max)
     std::map<Position, ItemPtr> ret;
     uint32 count = 0;
     for(uint8_t z = 0; z <= Otc::MAX_Z; ++z) {
-        for(const auto& pair : m_tileBlocks[z]) {
-            const TileBlock& block = pair.second;
-            for(const TilePtr& tile : block.getTiles()) {
+        for(const auto& block : m_tileBlocks[z]) {
+            for(const TilePtr& tile : block->getTiles()) {
                 if(unlikely(!tile || tile->isEmpty()))
                     continue;
                 for(const ItemPtr& item : tile->getItems()) {
@@ -536,8 +603,8 @@ void Map::removeUnawareThings()
         // remove tiles that we are not aware anymore
         for(int z = 0; z <= Otc::MAX_Z; ++z) {
             auto& tileBlocks = m_tileBlocks[z];
-            for(auto it = tileBlocks.begin(); it != tileBlocks.end();) {
-                TileBlock& block = (*it).second;
+            for(size_t i = 0; i < tileBlocks.size();) {
+                TileBlock& block = tileBlocks.at(i);
                 bool blockEmpty = true;
                 for(const TilePtr& tile : block.getTiles()) {
                     if(!tile)
@@ -545,16 +612,17 @@ void Map::removeUnawareThings()
 
                     const Position& pos = tile->getPosition();
 
-                    if(!isAwareOfPositionForClean(pos, extended))
+                    if(!isAwareOfPositionForClean(pos, extended)) {
+                        notificateTileUpdate(pos, false);
                         block.remove(pos);
-                    else
+                    } else
                         blockEmpty = false;
                 }
 
                 if(blockEmpty)
-                    it = tileBlocks.erase(it);
+                    tileBlocks.eraseAt(i);
                 else
-                    ++it;
+                    ++i;
             }
         }
     }
@@ -843,21 +911,6 @@ std::tuple<std::vector<Otc::Direction>, Otc::PathFindResult> Map::findPath(const
     // pathfinding using A* search algorithm (otclientv8 note: it's dijkstra algorithm)
     // as described in http://en.wikipedia.org/wiki/A*_search_algorithm
 
-    struct SNode {
-        SNode(const Position& pos) : cost(0), totalCost(0), pos(pos), prev(nullptr), dir(Otc::InvalidDirection) { }
-        float cost;
-        float totalCost;
-        Position pos;
-        SNode *prev;
-        Otc::Direction dir;
-    };
-
-    struct LessNode {
-        bool operator()(std::pair<SNode*, float> a, std::pair<SNode*, float> b) const {
-            return b.second < a.second;
-        }
-    };
-
     std::tuple<std::vector<Otc::Direction>, Otc::PathFindResult> ret;
     std::vector<Otc::Direction>& dirs = std::get<0>(ret);
     Otc::PathFindResult& result = std::get<1>(ret);
@@ -888,25 +941,26 @@ std::tuple<std::vector<Otc::Direction>, Otc::PathFindResult> Map::findPath(const
         }
     }
 
-    std::unordered_map<Position, SNode*, PositionHasher> nodes;
-    std::priority_queue<std::pair<SNode*, float>, std::vector<std::pair<SNode*, float>>, LessNode> searchList;
+    PathFinder& pathFinder = PathFinder::get();
+    pathFinder.reset();
 
-    SNode *currentNode = new SNode(startPos);
-    currentNode->pos = startPos;
-    nodes[startPos] = currentNode;
-    SNode *foundNode = nullptr;
-    while(currentNode) {
-        if((int)nodes.size() > maxComplexity) {
+    uint32 currentNode = pathFinder.add(startPos);
+    uint32 foundNode = PathFinder::InvalidNode;
+    while(currentNode != PathFinder::InvalidNode) {
+        if((int)pathFinder.size() > maxComplexity) {
             result = Otc::PathFindResultTooFar;
             break;
         }
 
+        Position currentPos = pathFinder.node(currentNode).pos;
+        const float currentCost = pathFinder.node(currentNode).cost;
+
         // path found
-        if(currentNode->pos == goalPos && (!foundNode || currentNode->cost < foundNode->cost))
+        if(currentPos == goalPos && (foundNode == PathFinder::InvalidNode || currentCost < pathFinder.node(foundNode).cost))
             foundNode = currentNode;
 
         // cost too high
-        if(foundNode && currentNode->totalCost >= foundNode->cost)
+        if(foundNode != PathFinder::InvalidNode && pathFinder.node(currentNode).totalCost >= pathFinder.node(foundNode).cost)
             break;
 
         for(int i=-1;i<=1;++i) {
@@ -920,8 +974,8 @@ std::tuple<std::vector<Otc::Direction>, Otc::PathFindResult> Map::findPath(const
                 bool isNotPathable = true;
                 int speed = 100;
 
-                Position neighborPos = currentNode->pos.translated(i, j);
-                if (neighborPos.x < 0 || neighborPos.y < 0) continue;
+                Position neighborPos = currentPos.translated(i, j);
+                if (neighborPos.x < 0 || neighborPos.y < 0 || neighborPos.x > 65535 || neighborPos.y > 65535) continue;
                 if(g_map.isAwareOfPosition(neighborPos)) {
                     wasSeen = true;
                     if(const TilePtr& tile = getTile(neighborPos)) {
@@ -961,53 +1015,44 @@ std::tuple<std::vector<Otc::Direction>, Otc::PathFindResult> Map::findPath(const
                     }
                 }
 
-                Otc::Direction walkDir = currentNode->pos.getDirectionFromPosition(neighborPos);
+                Otc::Direction walkDir = currentPos.getDirectionFromPosition(neighborPos);
                 if(walkDir >= Otc::NorthEast)
                     walkFactor += 3.0f;
                 else
                     walkFactor += 1.0f;
 
-                float cost = currentNode->cost + (speed * walkFactor) / 100.0f;
+                float cost = currentCost + (speed * walkFactor) / 100.0f;
 
-                SNode *neighborNode;
-                if(nodes.find(neighborPos) == nodes.end()) {
-                    neighborNode = new SNode(neighborPos);
-                    nodes[neighborPos] = neighborNode;
-                } else {
-                    neighborNode = nodes[neighborPos];
-                    if(neighborNode->cost <= cost)
-                        continue;
+                uint32 neighborNode = pathFinder.find(neighborPos);
+                if(neighborNode == PathFinder::InvalidNode) {
+                    neighborNode = pathFinder.add(neighborPos);
+                } else if(pathFinder.node(neighborNode).cost <= cost) {
+                    continue;
                 }
 
-                neighborNode->prev = currentNode;
-                neighborNode->cost = cost;
-                neighborNode->totalCost = neighborNode->cost + neighborPos.distance(goalPos);
-                neighborNode->dir = walkDir;
-                searchList.push(std::make_pair(neighborNode, neighborNode->totalCost));
+                PathNode& neighbor = pathFinder.node(neighborNode);
+                neighbor.prev = currentNode;
+                neighbor.cost = cost;
+                neighbor.totalCost = neighbor.cost + neighborPos.distance(goalPos);
+                neighbor.dir = walkDir;
+                pathFinder.push(neighborNode);
             }
         }
 
-        if(!searchList.empty()) {
-            currentNode = searchList.top().first;
-            searchList.pop();
-        } else
-            currentNode = nullptr;
+        currentNode = pathFinder.empty() ? PathFinder::InvalidNode : pathFinder.pop();
     }
 
-    if(foundNode) {
+    if(foundNode != PathFinder::InvalidNode) {
         currentNode = foundNode;
-        while(currentNode) {
-            dirs.push_back(currentNode->dir);
-            currentNode = currentNode->prev;
+        while(currentNode != PathFinder::InvalidNode) {
+            dirs.push_back(pathFinder.node(currentNode).dir);
+            currentNode = pathFinder.node(currentNode).prev;
         }
         dirs.pop_back();
         std::reverse(dirs.begin(), dirs.end());
         result = Otc::PathFindResultOk;
     }
 
-    for(auto it : nodes)
-        delete it.second;
-
     return ret;
 }
 
@@ -1095,148 +1140,239 @@ bool Map::checkSightLine(const Position& fromPos, const Position& toPos)
     return checkSightLine(fromPos, toPos) || checkSightLine(toPos, fromPos);
 }
 
-PathFindResult_ptr Map::newFindPath(const Position& start, const Position& goal, std::shared_ptr<std::list<Node*>> visibleNodes)
+PathFindResult_ptr Map::newFindPath(const Position& start, const Position& goal, const PathTileListPtr& visibleTiles, int flags)
 {
-    auto ret = std::make_shared<PathFindResult>();
-    ret->start = start;
-    ret->destination = goal;
+    return newFindPaths(start, { goal }, visibleTiles, flags).front();
+}
 
-    if (start == goal) {
-        ret->status = Otc::PathFindResultSamePosition;
-        return ret;
-    }
-    if (goal.z != start.z) {
-        return ret;
+std::vector<PathFindResult_ptr> Map::newFindPaths(const Position& start, const std::vector<Position>& goals, const PathTileListPtr& visibleTiles,
+                                                  int flags, int maxComplexity)
+{
+    // A* search, step cost is tile speed (3x for diagonal moves) and it's never lower than MIN_STEP_COST,
+    // so MIN_STEP_COST * manhattan distance never overestimates and the heuristic is consistent.
+    // With more than one goal there's no heuristic, it's dijkstra which stops once every goal was reached.
+    const float MIN_STEP_COST = 100.0f;
+    const float NOT_VISITED = 10000000.0f;
+
+    std::vector<PathFindResult_ptr> results;
+    results.reserve(goals.size());
+    size_t remaining = 0;
+    for (const Position& goal : goals) {
+        auto ret = std::make_shared<PathFindResult>();
+        ret->start = start;
+        ret->destination = goal;
+        if (start == goal)
+            ret->status = Otc::PathFindResultSamePosition;
+        else if (goal.z == start.z)
+            ++remaining;
+        results.push_back(ret);
     }
+    if (remaining == 0)
+        return results;
 
-    struct LessNode {
-        bool operator()(Node* a, Node* b) const
-        {
-            return b->totalCost < a->totalCost;
-        }
+    auto isGoal = [&](const Position& pos) {
+        return std::find(goals.begin(), goals.end(), pos) != goals.end();
+    };
+    auto heuristic = [&](const Position& pos) {
+        if (goals.size() != 1)
+            return 0.0f;
+        return MIN_STEP_COST * (std::abs(pos.x - goals[0].x) + std::abs(pos.y - goals[0].y));
     };
 
-    std::unordered_map<Position, Node*, PositionHasher> nodes;
-    std::priority_queue<Node*, std::vector<Node*>, LessNode> searchList;
+    PathFinder& pathFinder = PathFinder::get();
+    pathFinder.reset();
 
-    if (visibleNodes) {
-        for (auto& node : *visibleNodes)
-            nodes.emplace(node->pos, node);
+    if (visibleTiles) {
+        for (const PathTile& tile : *visibleTiles) {
+            PathNode& node = pathFinder.node(pathFinder.add(tile.pos));
+            node.speed = tile.speed;
+            node.cost = NOT_VISITED;
+            node.endpoint = tile.blocked && isGoal(tile.pos);
+            node.blocked = tile.blocked && !node.endpoint;
+        }
     }
 
-    Node* initNode = new Node{ 1, 0, start, nullptr, 0, 0 };
-    nodes[start] = initNode;
-    searchList.push(initNode);
-
-    int limit = 50000;
-    float distance = start.distance(goal);
+    uint32 startNode = pathFinder.find(start);
+    if (startNode == PathFinder::InvalidNode)
+        startNode = pathFinder.add(start);
+    PathNode& initNode = pathFinder.node(startNode);
+    initNode.cost = 0;
+    initNode.blocked = false;
+    initNode.totalCost = heuristic(start);
+    pathFinder.push(startNode);
+
+    auto buildPath = [&](uint32 dstNode, const PathFindResult_ptr& ret) {
+        while (pathFinder.node(dstNode).prev != PathFinder::InvalidNode) {
+            const PathNode& node = pathFinder.node(dstNode);
+            PathNode& prev = pathFinder.node(node.prev);
+            if (node.unseen) {
+                ret->path.clear();
+            } else {
+                ret->path.push_back(prev.pos.getDirectionFromPosition(node.pos));
+            }
+            dstNode = node.prev;
+        }
+        std::reverse(ret->path.begin(), ret->path.end());
+        ret->status = Otc::PathFindResultOk;
+    };
 
-    Node* dstNode = nullptr;
-    while (!searchList.empty() && --limit) {
-        Node* node = searchList.top();
-        searchList.pop();
-        if (node->pos == goal) {
-            dstNode = node;
-            break;
+    int limit = maxComplexity;
+    while (!pathFinder.empty() && --limit) {
+        uint32 current = pathFinder.pop();
+        // copy, adding new nodes may reallocate them
+        PathNode node = pathFinder.node(current);
+        if (isGoal(node.pos)) {
+            for (const PathFindResult_ptr& ret : results) {
+                if (ret->destination == node.pos && ret->status == Otc::PathFindResultNoWay) {
+                    buildPath(current, ret);
+                    --remaining;
+                }
+            }
+            if (remaining == 0)
+                break;
+            // a path to another goal can't go through this one, per goal searches keep it blocked too
+            if (node.endpoint)
+                continue;
         }
-        if (node->pos.distance(goal) > distance + 10000)
-            continue;
         for (int i = -1; i <= 1; ++i) {
             for (int j = -1; j <= 1; ++j) {
                 if (i == 0 && j == 0)
                     continue;
-                Position neighbor = node->pos.translated(i, j);
-                if (neighbor.x < 0 || neighbor.y < 0) continue;
-                auto it = nodes.find(neighbor);
-                if (it == nodes.end()) {
-                    auto blockAndTile = g_minimap.threadGetTile(neighbor);
-                    bool wasSeen = blockAndTile.second.hasFlag(MinimapTileWasSeen);
-                    bool isNotWalkable = blockAndTile.second.hasFlag(MinimapTileNotWalkable);
-                    bool isNotPathable = blockAndTile.second.hasFlag(MinimapTileNotPathable);
-                    bool isEmpty = blockAndTile.second.hasFlag(MinimapTileEmpty);
-                    float speed = blockAndTile.second.getSpeed();
-                    if ((isNotWalkable || isNotPathable || isEmpty) && neighbor != goal) {
-                        it = nodes.emplace(neighbor, nullptr).first;
-                    } else {
-                        if (!wasSeen)
-                            speed = 2000;
-                        it = nodes.emplace(neighbor, new Node{ speed, 10000000.0f, neighbor, node, node->distance + 1, wasSeen ? 0 : 1 }).first;
-                    }
+                Position neighborPos = node.pos.translated(i, j);
+                if (neighborPos.x < 0 || neighborPos.y < 0 || neighborPos.x > 65535 || neighborPos.y > 65535) continue;
+                uint32 neighborNode = pathFinder.find(neighborPos);
+                if (neighborNode == PathFinder::InvalidNode) {
+                    const MinimapTile mtile = g_minimap.threadGetTile(neighborPos);
+                    bool wasSeen = mtile.hasFlag(MinimapTileWasSeen);
+                    bool isNotWalkable = mtile.hasFlag(MinimapTileNotWalkable);
+                    bool isNotPathable = mtile.hasFlag(MinimapTileNotPathable);
+                    bool isEmpty = mtile.hasFlag(MinimapTileEmpty);
+
+                    neighborNode = pathFinder.add(neighborPos);
+                    PathNode& neighbor = pathFinder.node(neighborNode);
+                    bool blocked = ((isNotWalkable || isEmpty) && !(flags & Otc::PathFindAllowNonWalkable)) ||
+                        (isNotPathable && !(flags & Otc::PathFindAllowNonPathable)) || (!wasSeen && !(flags & Otc::PathFindAllowNotSeenTiles));
+                    neighbor.endpoint = blocked && isGoal(neighborPos);
+                    neighbor.blocked = blocked && !neighbor.endpoint;
+                    neighbor.speed = wasSeen ? mtile.getSpeed() : 2000;
+                    neighbor.cost = NOT_VISITED;
+                    neighbor.unseen = wasSeen ? 0 : 1;
                 }
-                if (!it->second) // no way
+
+                PathNode& neighbor = pathFinder.node(neighborNode);
+                if (neighbor.blocked) // no way
                     continue;
-                if (it->second->unseen > 50)
+                if (neighbor.unseen > 50)
                     continue;
 
                 float diagonal = ((i == 0 || j == 0) ? 1.0f : 3.0f);
-                float cost = it->second->cost * diagonal;
-                cost += diagonal * (50.0f * std::max<float>(5.0f, it->second->pos.distance(goal))); // heuristic
-                if (node->totalCost + cost + 50 < it->second->totalCost) {
-                    it->second->totalCost = node->totalCost + cost;
-                    it->second->prev = node;
-                    if (it->second->unseen)
-                        it->second->unseen = node->unseen + 1;
-                    it->second->distance = node->distance + 1;
-                    searchList.push(it->second);
+                float cost = node.cost + std::max<float>(MIN_STEP_COST, neighbor.speed) * diagonal;
+                if (cost < neighbor.cost) {
+                    neighbor.cost = cost;
+                    neighbor.totalCost = cost + heuristic(neighborPos);
+                    neighbor.prev = current;
+                    if (neighbor.unseen)
+                        neighbor.unseen = node.unseen + 1;
+                    neighbor.distance = node.distance + 1;
+                    pathFinder.push(neighborNode);
                 }
             }
         }
     }
 
-    if (dstNode) {
-        while (dstNode && dstNode->prev) {
-            if (dstNode->unseen) {
-                ret->path.clear();
-            } else {
-                ret->path.push_back(dstNode->prev->pos.getDirectionFromPosition(dstNode->pos));
-            }
-            dstNode = dstNode->prev;
-        }
-        std::reverse(ret->path.begin(), ret->path.end());
-        ret->status = Otc::PathFindResultOk;
-    }
-    ret->complexity = 50000 - limit;
-
-    for (auto& node : nodes) {
-        if (node.second)
-            delete node.second;
-    }
+    for (const PathFindResult_ptr& ret : results)
+        ret->complexity = maxComplexity - limit;
 
-    return ret;
+    return results;
 }
 
-void Map::findPathAsync(const Position& start, const Position& goal, std::function<void(PathFindResult_ptr)> callback)
+PathTileListPtr Map::getPathTiles(const Position& start, int flags)
 {
-    auto visibleNodes = std::make_shared<std::list<Node*>>();
-    for (auto& tile : getTiles(start.z)) {
-        if (tile->getPosition() == start)
-            continue;
-        bool isNotWalkable = !tile->isWalkable(false);
-        bool isNotPathable = !tile->isPathable();
-        float speed = tile->getGroundSpeed();
-        if ((isNotWalkable || isNotPathable) && tile->getPosition() != goal) {
-            visibleNodes->push_back(new Node{ speed, 0, tile->getPosition(), nullptr, 0, 0 });
-        } else {
-            visibleNodes->push_back(new Node{ speed, 10000000.0f, tile->getPosition(), nullptr, 0, 0 });
+    bool ignoreCreatures = flags & (Otc::PathFindIgnoreCreatures | Otc::PathFindAllowCreatures);
+    auto visibleTiles = std::make_shared<PathTileList>();
+    if (start.z > Otc::MAX_Z)
+        return visibleTiles;
+
+    for (const auto& block : m_tileBlocks[start.z]) {
+        for (const TilePtr& tile : block->getTiles()) {
+            if (!tile || tile->getPosition() == start)
+                continue;
+            bool isNotWalkable = !tile->isWalkable(ignoreCreatures) && !(flags & Otc::PathFindAllowNonWalkable);
+            bool isNotPathable = !tile->isPathable() && !(flags & Otc::PathFindAllowNonPathable);
+            visibleTiles->push_back(PathTile{ tile->getPosition(), (float)tile->getGroundSpeed(), isNotWalkable || isNotPathable });
         }
     }
+    return visibleTiles;
+}
 
+void Map::findPathAsync(const Position& start, const Position& goal, std::function<void(PathFindResult_ptr)> callback)
+{
+    auto visibleTiles = getPathTiles(start, 0);
     g_asyncDispatcher.dispatch([=] {
-        auto ret = g_map.newFindPath(start, goal, visibleNodes);
+        auto ret = g_map.newFindPath(start, goal, visibleTiles);
         g_dispatcher.addEvent(std::bind(callback, ret));
     });
 }
 
-std::map<std::string, std::tuple<int, int, int, std::string>> Map::findEveryPath(const Position& start, int maxDistance, const std::map<std::string, std::string>& params)
+void Map::findPathsAsync(const Position& start, const std::vector<Position>& goals, int flags, std::function<void(std::vector<PathFindResult_ptr>)> callback)
 {
-    // using Dijkstra's algorithm
-    struct LessNode {
-        bool operator()(Node* a, Node* b) const
-        {
-            return b->totalCost < a->totalCost;
+    // a single dijkstra is cheaper when there are many goals close to each other,
+    // otherwise every goal gets its own A* search on one of the async dispatcher threads
+    const int MULTI_GOAL_DISTANCE = 30;
+
+    auto visibleTiles = getPathTiles(start, flags);
+    if (goals.empty()) {
+        g_dispatcher.addEvent(std::bind(callback, std::vector<PathFindResult_ptr>()));
+        return;
+    }
+
+    size_t threads = g_asyncDispatcher.getThreadCount();
+    if (threads == 0) {
+        // no async threads were started, jobs dispatched to them would never run
+        g_dispatcher.addEvent(std::bind(callback, newFindPaths(start, goals, visibleTiles, flags)));
+        return;
+    }
+
+    bool multiGoal = goals.size() > 1 && goals.size() >= threads * 2;
+    for (const Position& goal : goals) {
+        if (start.distance(goal) > MULTI_GOAL_DISTANCE) {
+            multiGoal = false;
+            break;
         }
+    }
+
+    if (multiGoal) {
+        g_asyncDispatcher.dispatch([=] {
+            auto results = g_map.newFindPaths(start, goals, visibleTiles, flags);
+            g_dispatcher.addEvent(std::bind(callback, results));
+        });
+        return;
+    }
+
+    struct Batch {
+        std::vector<PathFindResult_ptr> results;
+        std::atomic<size_t> remaining;
     };
+    auto batch = std::make_shared<Batch>();
+    batch->results.resize(goals.size());
+    batch->remaining = goals.size();
+
+    // split goals into one job per thread, so each job reuses its thread's search state
+    size_t jobs = std::min(threads, goals.size());
+    for (size_t job = 0; job < jobs; ++job) {
+        g_asyncDispatcher.dispatch([=] {
+            for (size_t i = job; i < goals.size(); i += jobs) {
+                batch->results[i] = g_map.newFindPath(start, goals[i], visibleTiles, flags);
+                if (--batch->remaining == 0)
+                    g_dispatcher.addEvent(std::bind(callback, batch->results));
+            }
+        });
+    }
+}
 
+std::map<std::string, std::tuple<int, int, int, std::string>> Map::findEveryPath(const Position& start, int maxDistance, const std::map<std::string, std::string>& params)
+{
+    // using Dijkstra's algorithm
     if (g_extras.debugPathfinding) {
         g_logger.info(stdext::format("findEveryPath: %i %i %i - %i", start.x, start.y, start.z, maxDistance));
         for (auto& param : params) {
@@ -1288,36 +1424,38 @@ std::map<std::string, std::tuple<int, int, int, std::string>> Map::findEveryPath
     }
 
     std::map<std::string, std::tuple<int, int, int, std::string>> ret;
-    std::unordered_map<Position, Node*, PositionHasher> nodes;
-    std::priority_queue<Node*, std::vector<Node*>, LessNode> searchList;
-
-    Node* initNode = new Node{ 1, 0, start, nullptr, 0, 0 };
-    nodes[start] = initNode;
-    searchList.push(initNode);
-
-    while (!searchList.empty()) {
-        Node* node = searchList.top();
-        searchList.pop();
-        ret[node->pos.toString()] = std::make_tuple(node->totalCost, node->distance,
-                                                    node->prev ? node->prev->pos.getDirectionFromPosition(node->pos) : -1,
-                                                    node->prev ? node->prev->pos.toString() : "");
-        if (node->pos == destPos) {
+    PathFinder& pathFinder = PathFinder::get();
+    pathFinder.reset();
+
+    uint32 initNode = pathFinder.add(start);
+    pathFinder.node(initNode).speed = 1;
+    pathFinder.push(initNode);
+
+    while (!pathFinder.empty()) {
+        uint32 current = pathFinder.pop();
+        // copy, adding new nodes may reallocate them
+        PathNode node = pathFinder.node(current);
+        PathNode* prev = node.prev != PathFinder::InvalidNode ? &pathFinder.node(node.prev) : nullptr;
+        ret[node.pos.toString()] = std::make_tuple(node.totalCost, node.distance,
+                                                   prev ? prev->pos.getDirectionFromPosition(node.pos) : -1,
+                                                   prev ? prev->pos.toString() : "");
+        if (node.pos == destPos) {
             if (hasMargin) {
-                maxDistance = std::min<int>(node->distance + 4, maxDistance);
+                maxDistance = std::min<int>(node.distance + 4, maxDistance);
             } else {
                 break;
             }
         }
-        if (node->distance >= maxDistance)
+        if (node.distance >= maxDistance)
             continue;
         for (int i = -1; i <= 1; ++i) {
             for (int j = -1; j <= 1; ++j) {
                 if (i == 0 && j == 0)
                     continue;
-                Position neighbor = node->pos.translated(i, j);
-                if (neighbor.x < 0 || neighbor.y < 0) continue;
-                auto it = nodes.find(neighbor);
-                if (it == nodes.end()) {
+                Position neighbor = node.pos.translated(i, j);
+                if (neighbor.x < 0 || neighbor.y < 0 || neighbor.x > 65535 || neighbor.y > 65535) continue;
+                uint32 neighborNode = pathFinder.find(neighbor);
+                if (neighborNode == PathFinder::InvalidNode) {
                     bool wasSeen = false;
                     bool hasCreature = false;
                     bool isNotWalkable = true;
@@ -1345,46 +1483,47 @@ std::map<std::string, std::tuple<int, int, int, std::string>> Map::findEveryPath
                     }
                     bool hasStairs = isNotPathable && mapColor >= 210 && mapColor <= 213;
                     bool hasReachedMaxDistance = maxDistanceFrom && maxDistanceFromPos.isValid() && maxDistanceFromPos.distance(neighbor) > maxDistanceFrom;
+
+                    neighborNode = pathFinder.add(neighbor);
+                    PathNode& newNode = pathFinder.node(neighborNode);
                     if ((!wasSeen && !allowUnseen) || (hasStairs && !ignoreStairs && neighbor != destPos) || 
                         (isNotPathable && !ignoreNonPathable && neighbor != destPos) || (isNotWalkable && !ignoreNonWalkable) ||
                         hasReachedMaxDistance) {
-                        it = nodes.emplace(neighbor, nullptr).first;
+                        newNode.blocked = true;
                     } else if ((hasCreature && !ignoreCreatures)) {
-                        it = nodes.emplace(neighbor, nullptr).first;
+                        newNode.blocked = true;
                         if (ignoreLastCreature) {
-                            ret[neighbor.toString()] = std::make_tuple(node->totalCost + 100, node->distance + 1,
-                                                                       node->pos.getDirectionFromPosition(neighbor),
-                                                                       node->pos.toString());
+                            ret[neighbor.toString()] = std::make_tuple(node.totalCost + 100, node.distance + 1,
+                                                                       node.pos.getDirectionFromPosition(neighbor),
+                                                                       node.pos.toString());
                         }
                     } else {
-                        it = nodes.emplace(neighbor, new Node{ (float)speed, 10000000.0f, neighbor, node, node->distance + 1, wasSeen ? 0 : 1 }).first;
+                        newNode.speed = speed;
+                        newNode.totalCost = 10000000.0f;
+                        newNode.unseen = wasSeen ? 0 : 1;
                     }
                 }
 
-                if (!it->second) {
+                PathNode& neighborData = pathFinder.node(neighborNode);
+                if (neighborData.blocked) {
                     continue;
                 }
 
                 float diagonal = ((i == 0 || j == 0) ? 1.0f : 3.0f);
-                float cost = it->second->cost * diagonal;
+                float cost = neighborData.speed * diagonal;
                 if (ignoreCost)
                     cost = 1;
-                if (node->totalCost + cost < it->second->totalCost) {
-                    it->second->totalCost = node->totalCost + cost;
-                    it->second->prev = node;
-                    if (it->second->unseen)
-                        it->second->unseen = node->unseen + 1;
-                    it->second->distance = node->distance + 1;
-                    searchList.push(it->second);
+                if (node.totalCost + cost < neighborData.totalCost) {
+                    neighborData.totalCost = node.totalCost + cost;
+                    neighborData.prev = current;
+                    if (neighborData.unseen)
+                        neighborData.unseen = node.unseen + 1;
+                    neighborData.distance = node.distance + 1;
+                    pathFinder.push(neighborNode);
                 }
             }
         }
     }
 
-    for (auto& node : nodes) {
-        if (node.second)
-            delete node.second;
-    }
-
     return ret;
 }
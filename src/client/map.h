@@ -30,6 +30,7 @@
 #include "animatedtext.h"
 #include "statictext.h"
 #include "tile.h"
+#include "pathfinding.h"
 
 #include <framework/core/clock.h>
 
@@ -124,6 +125,53 @@ private:
     std::array<TilePtr, BLOCK_SIZE*BLOCK_SIZE> m_tiles;
 };
 
+// open addressing hash of block index -> TileBlock, blocks are kept in a dense array for fast iteration
+class TileBlockMap {
+public:
+    using BlockList = std::vector<std::unique_ptr<TileBlock>>;
+
+    TileBlock* find(uint index) const {
+        if(m_slots.empty())
+            return nullptr;
+        const uint mask = m_slots.size() - 1;
+        for(uint slot = hash(index); ; slot = (slot + 1) & mask) {
+            uint32 dense = m_slots[slot];
+            if(dense == 0)
+                return nullptr;
+            if(m_keys[dense - 1] == index)
+                return m_blocks[dense - 1].get();
+        }
+    }
+    TileBlock& operator[](uint index) {
+        if(TileBlock* block = find(index))
+            return *block;
+        return insert(index);
+    }
+
+    // erasing swaps the last block into the erased place, so eraseAt(i) must not advance i
+    void erase(uint index);
+    void eraseAt(size_t pos) { erase(m_keys[pos]); }
+    void clear() { m_slots.clear(); m_keys.clear(); m_blocks.clear(); m_shift = 32; }
+
+    size_t size() const { return m_blocks.size(); }
+    bool empty() const { return m_blocks.empty(); }
+    TileBlock& at(size_t pos) const { return *m_blocks[pos]; }
+
+    BlockList::const_iterator begin() const { return m_blocks.begin(); }
+    BlockList::const_iterator end() const { return m_blocks.end(); }
+
+private:
+    uint hash(uint index) const { return (uint32)(index * 2654435761u) >> m_shift; }
+    uint findSlot(uint index) const;
+    TileBlock& insert(uint index);
+    void rehash(size_t capacity);
+
+    std::vector<uint32> m_slots; // dense position + 1, 0 means empty slot
+    std::vector<uint> m_keys;
+    BlockList m_blocks;
+    uint m_shift = 32;
+};
+
 struct AwareRange
 {
     int top;
@@ -145,15 +193,6 @@ struct PathFindResult
 };
 using PathFindResult_ptr = std::shared_ptr<PathFindResult>;
 
-struct Node {
-    float cost;
-    float totalCost;
-    Position pos;
-    Node *prev;
-    int distance;
-    int unseen;
-};
-
 //@bindsingleton g_map
 class Map
 {
@@ -268,8 +307,12 @@ public:
     std::vector<StaticTextPtr> getStaticTexts() { return m_staticTexts; }
 
     std::tuple<std::vector<Otc::Direction>, Otc::PathFindResult> findPath(const Position& start, const Position& goal, int maxComplexity, int flags = 0);
-    PathFindResult_ptr newFindPath(const Position& start, const Position& goal, std::shared_ptr<std::list<Node*>> visibleNodes);
+    // flags are Otc::PathFindFlags as for findPath, findPathAsync crosses tiles never seen
+    PathFindResult_ptr newFindPath(const Position& start, const Position& goal, const PathTileListPtr& visibleTiles, int flags = Otc::PathFindAllowNotSeenTiles);
+    std::vector<PathFindResult_ptr> newFindPaths(const Position& start, const std::vector<Position>& goals, const PathTileListPtr& visibleTiles,
+                                                 int flags = Otc::PathFindAllowNotSeenTiles, int maxComplexity = 50000);
     void findPathAsync(const Position & start, const Position & goal, std::function<void(PathFindResult_ptr)> callback);
+    void findPathsAsync(const Position& start, const std::vector<Position>& goals, int flags, std::function<void(std::vector<PathFindResult_ptr>)> callback);
 
     // tuple = <cost, distance, prevPos>
     std::map<std::string, std::tuple<int, int, int, std::string>> findEveryPath(const Position& start, int maxDistance, const std::map<std::string, std::string>& params);
@@ -282,9 +325,10 @@ public:
 
 private:
     void removeUnawareThings();
+    PathTileListPtr getPathTiles(const Position& start, int flags);
     uint getBlockIndex(const Position& pos) { return ((pos.y / BLOCK_SIZE) * (65536 / BLOCK_SIZE)) + (pos.x / BLOCK_SIZE); }
 
-    std::map<uint, TileBlock> m_tileBlocks[Otc::MAX_Z+1];
+    TileBlockMap m_tileBlocks[Otc::MAX_Z+1];
     std::map<uint32, CreaturePtr> m_knownCreatures;
     std::array<std::vector<MissilePtr>, Otc::MAX_Z+1> m_floorMissiles;
     std::vector<AnimatedTextPtr> m_animatedTexts;
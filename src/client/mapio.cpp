@@ -298,9 +298,8 @@ void Map::saveOtbm(const std::string& fileName)
                 bool firstNode = true;
 
                 for(uint8_t z = 0; z <= Otc::MAX_Z; ++z) {
-                    for(const auto& it : m_tileBlocks[z]) {
-                        const TileBlock& block = it.second;
-                        for(const TilePtr& tile : block.getTiles()) {
+                    for(const auto& block : m_tileBlocks[z]) {
+                        for(const TilePtr& tile : block->getTiles()) {
                             if(unlikely(!tile || tile->isEmpty()))
                                 continue;
 
@@ -498,9 +497,8 @@ void Map::saveOtcm(const std::string& fileName)
         fin->seek(start);
 
         for(uint8_t z = 0; z <= Otc::MAX_Z; ++z) {
-            for(const auto& it : m_tileBlocks[z]) {
-                const TileBlock& block = it.second;
-                for(const TilePtr& tile : block.getTiles()) {
+            for(const auto& block : m_tileBlocks[z]) {
+                for(const TilePtr& tile : block->getTiles()) {
                     if(!tile || tile->isEmpty())
                         continue;
 
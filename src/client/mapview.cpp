@@ -32,6 +32,7 @@
 #include "localplayer.h"
 #include "game.h"
 #include "spritemanager.h"
+#include "thingtexturecache.h"
 
 #include <framework/graphics/graphics.h>
 #include <framework/graphics/image.h>
@@ -44,7 +45,9 @@
 #include <framework/graphics/shadermanager.h>
 
 #include <framework/util/extras.h>
+#include <framework/util/stats.h>
 #include <framework/core/adaptiverenderer.h>
+#include <framework/core/asyncdispatcher.h>
 
 MapView::MapView()
 {
@@ -107,6 +110,28 @@ void MapView::drawTileWidget(const Rect& rect, const Rect& srcRect)
     }
 }
 
+// Floors don't share drawing state, so their draw queues can be built at the same time and appended
+// in painter order. Tiles, creatures and items are only read by the floor being drawn, with these exceptions:
+// - thing textures, the cache is only used by the dispatcher, the uses are recorded and replayed after the jobs
+// - thing type animators are shared by floors, they are locked
+// - the light view is shared, nothing is drawn in parallel with light
+// - creature widgets run lua, floors with them are drawn by the dispatcher after the jobs
+struct MapFloorJobs {
+    struct Job {
+        short floor;
+        std::shared_ptr<DrawQueue> queue;
+        ThingTextureUses uses;
+    };
+
+    std::vector<Job> jobs; // one for each drawn floor
+    std::vector<size_t> parallel; // jobs drawn by the worker threads
+    std::vector<size_t> sequential; // jobs with creature widgets, drawn by the dispatcher after the others
+    std::atomic<size_t> next;
+    std::atomic<size_t> done;
+    std::mutex mutex;
+    std::condition_variable finished;
+};
+
 void MapView::drawMapBackground(const Rect& rect, const TilePtr& crosshairTile) {
     Position cameraPosition = getCameraPosition();
     if (m_mustUpdateVisibleTilesCache) {
@@ -127,10 +152,13 @@ void MapView::drawMapBackground(const Rect& rect, const TilePtr& crosshairTile)
             ambientLight = g_map.getLight();
         if (!m_lightTexture || m_lightTexture->getSize() != m_drawDimension)
             m_lightTexture = std::make_shared<Texture>(m_drawDimension, false, true);
-        m_lightView = std::make_unique<LightView>(m_lightTexture, m_drawDimension, rect, srcRect, ambientLight.color,
+        if (!m_lightMap)
+            m_lightMap = std::make_shared<LightMap>();
+        m_lightView = std::make_unique<LightView>(m_lightTexture, m_lightMap, m_drawDimension, rect, srcRect, ambientLight.color,
                                                   std::max<int>(m_minimumAmbientLight * 255, ambientLight.intensity));
     }
 
+    m_drawnFloors.clear();
     for (int z = m_cachedLastVisibleFloor; z >= m_cachedFirstFadingFloor; --z) {
         float fading = 1.0;
         if (m_floorFading > 0) {
@@ -142,6 +170,16 @@ void MapView::drawMapBackground(const Rect& rect, const TilePtr& crosshairTile)
             }
             if (fading == 0) break;
         }
+        m_drawnFloors.emplace_back(z, fading);
+    }
+
+    bool parallel = canDrawFloorsInParallel();
+    if (parallel)
+        drawFloorsInParallel(cameraPosition, crosshairTile);
+
+    for (size_t i = 0; i < m_drawnFloors.size(); ++i) {
+        short z = m_drawnFloors[i].first;
+        float fading = m_drawnFloors[i].second;
 
         if (g_game.getFeature(Otc::GameDrawFloorShadow)) {
             if (cameraPosition.z >= Otc::UNDERGROUND_FLOOR && cameraPosition.z == z) {
@@ -149,7 +187,12 @@ void MapView::drawMapBackground(const Rect& rect, const TilePtr& crosshairTile)
             }
         }
         size_t floorStart = g_drawQueue->size();
-        drawFloor(z, cameraPosition, crosshairTile);
+        if (parallel) {
+            g_drawQueue->append(*m_floorJobs->jobs[i].queue);
+            m_floorJobs->jobs[i].queue = nullptr;
+        } else {
+            drawFloor(z, cameraPosition, crosshairTile);
+        }
 
         if (fading < 0.99)
             g_drawQueue->setOpacity(floorStart, fading);
@@ -170,6 +213,81 @@ void MapView::drawMapBackground(const Rect& rect, const TilePtr& crosshairTile)
     }
 }
 
+bool MapView::canDrawFloorsInParallel()
+{
+    return g_extras.parallelMapDraw && !m_lightView && m_drawnFloors.size() > 1 && g_asyncDispatcher.getThreadCount() > 0;
+}
+
+void MapView::drawFloorsInParallel(const Position& cameraPosition, const TilePtr& crosshairTile)
+{
+    AutoStat s(STATS_ZONE(STATS_MAIN, "DrawFloorsInParallel"));
+
+    // a worker that didn't start before the last frame was done still holds the jobs, it will find nothing to draw
+    if (!m_floorJobs || m_floorJobs.use_count() > 1)
+        m_floorJobs = std::make_shared<MapFloorJobs>();
+
+    std::shared_ptr<MapFloorJobs> jobs = m_floorJobs;
+    jobs->jobs.resize(m_drawnFloors.size());
+    jobs->parallel.clear();
+    jobs->sequential.clear();
+    for (size_t i = 0; i < m_drawnFloors.size(); ++i) {
+        MapFloorJobs::Job& job = jobs->jobs[i];
+        job.floor = m_drawnFloors[i].first;
+        job.queue = DrawQueue::create();
+        auto& tiles = m_cachedVisibleTiles[job.floor];
+        if (std::any_of(tiles.begin(), tiles.end(), [](const TilePtr& tile) { return tile->hasCreatureWithWidgets(); }))
+            jobs->sequential.push_back(i);
+        else
+            jobs->parallel.push_back(i);
+    }
+    jobs->next = 0;
+    jobs->done = 0;
+
+    auto run = [this, jobs, cameraPosition, crosshairTile] {
+        size_t index;
+        while ((index = jobs->next++) < jobs->parallel.size()) {
+            MapFloorJobs::Job& job = jobs->jobs[jobs->parallel[index]];
+            std::shared_ptr<DrawQueue> previousQueue = g_drawQueue;
+            g_drawQueue = job.queue;
+            ThingTextureCache::setThreadUses(&job.uses);
+            Creature::setDrawWidgets(false); // only reached by tiles redrawn for corpses, out of the view
+            try {
+                drawFloor(job.floor, cameraPosition, crosshairTile);
+            } catch (std::exception& e) {
+                g_logger.error(stdext::format("failed to draw floor %d: %s", job.floor, e.what()));
+            }
+            Creature::setDrawWidgets(true);
+            ThingTextureCache::setThreadUses(nullptr);
+            g_drawQueue = previousQueue;
+
+            if (++jobs->done == jobs->parallel.size()) {
+                std::lock_guard<std::mutex> lock(jobs->mutex);
+                jobs->finished.notify_all();
+            }
+        }
+    };
+
+    // the dispatcher draws too, so the floors are done even if the workers are busy baking textures
+    for (size_t i = 1; i < jobs->parallel.size() && i <= g_asyncDispatcher.getThreadCount(); ++i)
+        g_asyncDispatcher.dispatch(run);
+    run();
+    {
+        std::unique_lock<std::mutex> lock(jobs->mutex);
+        jobs->finished.wait(lock, [&] { return jobs->done == jobs->parallel.size(); });
+    }
+
+    for (auto& job : jobs->jobs)
+        g_thingTextureCache.replay(job.uses);
+
+    for (size_t index : jobs->sequential) {
+        MapFloorJobs::Job& job = jobs->jobs[index];
+        std::shared_ptr<DrawQueue> previousQueue = g_drawQueue;
+        g_drawQueue = job.queue;
+        drawFloor(job.floor, cameraPosition, crosshairTile);
+        g_drawQueue = previousQueue;
+    }
+}
+
 void MapView::setShader(const std::string& shader)
 {
     m_shader = shader;
@@ -183,15 +301,15 @@ void MapView::drawFloor(short floor, const Position& cameraPosition, const TileP
         return;
 
     auto& tiles = m_cachedVisibleTiles[floor];
-    size_t lightFloorStart = m_lightView ? m_lightView->size() : 0;
 
     // light
     if (m_lightView) {
+        m_lightView->setFloor(floor);
         for (auto& tile : tiles) {
             Point tileDrawPos = transformPositionTo2D(tile->getPosition(), cameraPosition);
             ItemPtr ground = tile->getGround();
             if (ground && ground->isGround() && !ground->isTranslucent()) {
-                m_lightView->setFieldBrightness(tileDrawPos, lightFloorStart, 0);
+                m_lightView->setFieldBrightness(tileDrawPos, floor);
             }
         }
     }
@@ -224,7 +342,7 @@ void MapView::drawFloor(short floor, const Position& cameraPosition, const TileP
             if (m_lightView) {
                 ItemPtr ground = tile->getGround();
                 if (ground && ground->isGround() && !ground->isTranslucent()) {
-                    m_lightView->setFieldBrightness(tileDrawPos, lightFloorStart, 0);
+                    m_lightView->setFieldBrightness(tileDrawPos, floor);
                 }
             }
 
@@ -390,33 +508,125 @@ void MapView::updateVisibleTilesCache()
 
     m_lastCameraPosition = cameraPosition;
 
-    const int numDiagonals = m_drawDimension.width() + m_drawDimension.height() - 1;
+    const int firstFloor = m_floorFading ? m_cachedFirstFadingFloor : m_cachedFirstVisibleFloor;
+    Point scroll(cameraPosition.x - m_visibleTilesGridCamera.x, cameraPosition.y - m_visibleTilesGridCamera.y);
+    if (m_mustRescanVisibleTiles || m_visibleTilesGridSize != m_drawDimension || !m_visibleTilesGridCamera.isValid() ||
+        m_visibleTilesGridCamera.z != cameraPosition.z || std::abs(scroll.x) > 1 || std::abs(scroll.y) > 1) {
+        m_mustRescanVisibleTiles = false;
+        m_visibleTilesGridSize = m_drawDimension;
+        m_visibleTilesGridScroll = Point(0, 0);
+        for (int iz = 0; iz <= Otc::MAX_Z; ++iz) {
+            m_visibleTilesGridValid[iz] = false;
+            m_visibleTilesGrid[iz].assign(m_drawDimension.area(), nullptr);
+        }
+        scroll = Point(0, 0);
+        m_updatedTiles.clear();
+    }
+    m_visibleTilesGridCamera = cameraPosition;
+
+    // floors which aren't visible anymore are dropped, new ones are scanned whole
+    for (int iz = 0; iz <= Otc::MAX_Z; ++iz) {
+        if (iz >= firstFloor && iz <= m_cachedLastVisibleFloor)
+            continue;
+        if (m_visibleTilesGridValid[iz])
+            std::fill(m_visibleTilesGrid[iz].begin(), m_visibleTilesGrid[iz].end(), nullptr);
+        m_visibleTilesGridValid[iz] = false;
+    }
+    if (scroll.x != 0 || scroll.y != 0)
+        scrollVisibleTiles(cameraPosition, firstFloor, scroll);
+    for (int iz = m_cachedLastVisibleFloor; iz >= firstFloor; --iz) {
+        if (!m_visibleTilesGridValid[iz])
+            scanVisibleTiles(cameraPosition, iz);
+    }
+    for (const Position& pos : m_updatedTiles)
+        updateVisibleTile(cameraPosition, firstFloor, pos);
+    m_updatedTiles.clear();
+
     for (auto& cachedVisibleTiles : m_cachedVisibleTiles) {
         cachedVisibleTiles.clear();
     }
 
+    const int width = m_drawDimension.width(), height = m_drawDimension.height();
+    const int numDiagonals = width + height - 1;
     // draw from last floor (the lower) to first floor (the higher)
-    for(int iz = m_cachedLastVisibleFloor; iz >= (m_floorFading ? m_cachedFirstFadingFloor : m_cachedFirstVisibleFloor); --iz) {
+    for (int iz = m_cachedLastVisibleFloor; iz >= firstFloor; --iz) {
+        auto& grid = m_visibleTilesGrid[iz];
         for (int diagonal = 0; diagonal < numDiagonals; ++diagonal) {
             // loop current diagonal tiles
-            int advance = std::max<int>(diagonal - m_drawDimension.height(), 0);
-            for (int iy = diagonal - advance, ix = advance; iy >= 0 && ix < m_drawDimension.width(); --iy, ++ix) {
-                // position on current floor
-                //TODO: check position limits
-                Position tilePos = cameraPosition.translated(ix - m_virtualCenterOffset.x, iy - m_virtualCenterOffset.y);
-                // adjust tilePos to the wanted floor
-                tilePos.coveredUp(cameraPosition.z - iz);
-                if (const TilePtr& tile = g_map.getTile(tilePos)) {
-                    if (!tile->isDrawable())
-                        continue;
-                    m_cachedVisibleTiles[tilePos.z].push_back(tile);
-                    tile->calculateCorpseCorrection();
-                }
+            int advance = std::max<int>(diagonal - height, 0);
+            for (int iy = diagonal - advance, ix = advance; iy >= 0 && ix < width; --iy, ++ix) {
+                const TilePtr& tile = grid[((iy + m_visibleTilesGridScroll.y) % height) * width + (ix + m_visibleTilesGridScroll.x) % width];
+                if (!tile || !tile->isDrawable())
+                    continue;
+                m_cachedVisibleTiles[iz].push_back(tile);
+                tile->calculateCorpseCorrection();
             }
         }
     }
 }
 
+const TilePtr& MapView::getVisibleTile(const Position& cameraPosition, int ix, int iy, int floor)
+{
+    static const TilePtr nullTile;
+    //TODO: check position limits
+    Position tilePos = cameraPosition.translated(ix - m_virtualCenterOffset.x, iy - m_virtualCenterOffset.y);
+    // adjust tilePos to the wanted floor
+    if (!tilePos.coveredUp(cameraPosition.z - floor))
+        return nullTile;
+    return g_map.getTile(tilePos);
+}
+
+void MapView::scanVisibleTiles(const Position& cameraPosition, int floor)
+{
+    const int width = m_drawDimension.width(), height = m_drawDimension.height();
+    auto& grid = m_visibleTilesGrid[floor];
+    for (int iy = 0; iy < height; ++iy) {
+        for (int ix = 0; ix < width; ++ix)
+            grid[((iy + m_visibleTilesGridScroll.y) % height) * width + (ix + m_visibleTilesGridScroll.x) % width] = getVisibleTile(cameraPosition, ix, iy, floor);
+    }
+    m_visibleTilesGridValid[floor] = true;
+}
+
+void MapView::scrollVisibleTiles(const Position& cameraPosition, int firstFloor, const Point& offset)
+{
+    // the draw position (x, y) shows what (x + offset.x, y + offset.y) showed, only the entering row and column are read
+    const int width = m_drawDimension.width(), height = m_drawDimension.height();
+    m_visibleTilesGridScroll.x = (m_visibleTilesGridScroll.x + offset.x + width) % width;
+    m_visibleTilesGridScroll.y = (m_visibleTilesGridScroll.y + offset.y + height) % height;
+
+    const int column = offset.x > 0 ? width - 1 : 0;
+    const int row = offset.y > 0 ? height - 1 : 0;
+    for (int iz = m_cachedLastVisibleFloor; iz >= firstFloor; --iz) {
+        if (!m_visibleTilesGridValid[iz])
+            continue;
+        auto& grid = m_visibleTilesGrid[iz];
+        const int rowSlot = ((row + m_visibleTilesGridScroll.y) % height) * width;
+        const int columnSlot = (column + m_visibleTilesGridScroll.x) % width;
+        if (offset.x != 0) {
+            for (int iy = 0; iy < height; ++iy)
+                grid[((iy + m_visibleTilesGridScroll.y) % height) * width + columnSlot] = getVisibleTile(cameraPosition, column, iy, iz);
+        }
+        if (offset.y != 0) {
+            for (int ix = 0; ix < width; ++ix)
+                grid[rowSlot + (ix + m_visibleTilesGridScroll.x) % width] = getVisibleTile(cameraPosition, ix, row, iz);
+        }
+    }
+}
+
+void MapView::updateVisibleTile(const Position& cameraPosition, int firstFloor, const Position& pos)
+{
+    if (pos.z < firstFloor || pos.z > m_cachedLastVisibleFloor || !m_visibleTilesGridValid[pos.z])
+        return;
+
+    const int width = m_drawDimension.width(), height = m_drawDimension.height();
+    int covered = cameraPosition.z - pos.z;
+    int ix = pos.x - covered - cameraPosition.x + m_virtualCenterOffset.x;
+    int iy = pos.y - covered - cameraPosition.y + m_virtualCenterOffset.y;
+    if (ix < 0 || iy < 0 || ix >= width || iy >= height)
+        return;
+    m_visibleTilesGrid[pos.z][((iy + m_visibleTilesGridScroll.y) % height) * width + (ix + m_visibleTilesGridScroll.x) % width] = getVisibleTile(cameraPosition, ix, iy, pos.z);
+}
+
 void MapView::updateGeometry(const Size& visibleDimension, const Size& optimizedSize)
 {
     m_multifloor = true;
@@ -430,12 +640,28 @@ void MapView::updateGeometry(const Size& visibleDimension, const Size& optimized
 
 void MapView::onTileUpdate(const Position& pos)
 {
-    requestVisibleTilesCacheUpdate();
+    // every update is queued, the map doesn't tell whether the tile was created or removed, and the
+    // things of a tile decide whether it's drawn, which is only checked when the tiles are listed again
+    if (!m_visibleTilesGridValid[pos.z])
+        return;
+
+    // skip tiles out of the view, with a margin for the next camera step
+    const Position& cameraPosition = m_visibleTilesGridCamera;
+    int covered = cameraPosition.z - pos.z;
+    int ix = pos.x - covered - cameraPosition.x + m_virtualCenterOffset.x;
+    int iy = pos.y - covered - cameraPosition.y + m_virtualCenterOffset.y;
+    if (ix < -1 || iy < -1 || ix > m_drawDimension.width() || iy > m_drawDimension.height())
+        return;
+
+    bool rescan = m_updatedTiles.size() >= 256;
+    if (!rescan)
+        m_updatedTiles.push_back(pos);
+    requestVisibleTilesCacheUpdate(rescan);
 }
 
 void MapView::onMapCenterChange(const Position& pos)
 {
-    requestVisibleTilesCacheUpdate();
+    requestVisibleTilesCacheUpdate(false);
 }
 
 void MapView::lockFirstVisibleFloor(int firstVisibleFloor)
@@ -553,7 +779,7 @@ void MapView::move(int x, int y)
     }
 
     if(requestTilesUpdate)
-        requestVisibleTilesCacheUpdate();
+        requestVisibleTilesCacheUpdate(false);
 }
 
 Rect MapView::calcFramebufferSource(const Size& destSize, bool inNextFrame)
@@ -30,6 +30,8 @@
 #include <framework/core/declarations.h>
 #include "lightview.h"
 
+struct MapFloorJobs;
+
 // @bindclass
 class MapView : public LuaObject
 {
@@ -41,11 +43,15 @@ public:
 
 private:
     void drawFloor(short floor, const Position& cameraPosition, const TilePtr& crosshairTile = nullptr);
+    bool canDrawFloorsInParallel();
+    void drawFloorsInParallel(const Position& cameraPosition, const TilePtr& crosshairTile);
     void drawTileTexts(const Rect& rect, const Rect& srcRect);
     void drawTileWidget(const Rect& rect, const Rect& srcRect);
     void updateGeometry(const Size& visibleDimension, const Size& optimizedSize);
-    void updateVisibleTilesCache();
-    void requestVisibleTilesCacheUpdate() { m_mustUpdateVisibleTilesCache = true; }
+    void scanVisibleTiles(const Position& cameraPosition, int floor);
+    void scrollVisibleTiles(const Position& cameraPosition, int firstFloor, const Point& offset);
+    void updateVisibleTile(const Position& cameraPosition, int firstFloor, const Position& pos);
+    const TilePtr& getVisibleTile(const Position& cameraPosition, int ix, int iy, int floor);
 
 protected:
     void onTileUpdate(const Position& pos);
@@ -70,6 +76,18 @@ public:
     int getCachedFirstVisibleFloor() { return m_cachedFirstVisibleFloor; }
     int getCachedLastVisibleFloor() { return m_cachedLastVisibleFloor; }
 
+    // tiles drawn on each floor, the cache is updated before drawing when it was requested
+    void updateVisibleTilesCache();
+    // rescan drops the tiles cached for the current view, without it only the camera movement
+    // and the tiles reported by onTileUpdate are read from the map again
+    void requestVisibleTilesCacheUpdate(bool rescan = true)
+    {
+        m_mustUpdateVisibleTilesCache = true;
+        if (rescan)
+            m_mustRescanVisibleTiles = true;
+    }
+    const std::vector<TilePtr>& getCachedVisibleTiles(int floor) { return m_cachedVisibleTiles[floor]; }
+
     // camera related
     void followCreature(const CreaturePtr& creature);
     CreaturePtr getFollowingCreature() { return m_followingCreature; }
@@ -163,15 +181,27 @@ private:
     Position m_shaderPosition;
 
     stdext::timer m_fadingFloorTimers[Otc::MAX_Z + 1];
+    // floors drawn in this frame, from the bottom one, with their fading
+    std::vector<std::pair<short, float>> m_drawnFloors;
+    std::shared_ptr<MapFloorJobs> m_floorJobs;
 
     stdext::boolean<true> m_follow;
     std::vector<TilePtr> m_cachedVisibleTiles[Otc::MAX_Z + 1];
+    // tiles of every draw position of each floor, kept in a ring that scrolls with the camera
+    std::vector<TilePtr> m_visibleTilesGrid[Otc::MAX_Z + 1];
+    bool m_visibleTilesGridValid[Otc::MAX_Z + 1] = {};
+    Size m_visibleTilesGridSize;
+    Point m_visibleTilesGridScroll;
+    Position m_visibleTilesGridCamera;
+    std::vector<Position> m_updatedTiles;
+    stdext::boolean<true> m_mustRescanVisibleTiles;
     CreaturePtr m_followingCreature;
     Otc::DrawFlags m_drawFlags;
     bool m_drawLight = false;
     float m_minimumAmbientLight;
     std::unique_ptr<LightView> m_lightView;
     TexturePtr m_lightTexture;
+    LightMapPtr m_lightMap;
 
     Color m_floorShadow = Color(0.0f, 0.0f, 0.0f, 0.5f);
 };
@@ -41,9 +41,15 @@ Minimap g_minimap;
 
 void MinimapBlock::clean()
 {
+    std::lock_guard<std::mutex> lock(m_sourceMutex);
+    m_source.reset();
+    m_loaded.store(true, std::memory_order_release);
+    beginWrite();
     m_tiles.fill(MinimapTile());
+    endWrite();
     m_texture.reset();
     m_mustUpdate = false;
+    m_wasSeen = false;
 }
 
 void MinimapBlock::update()
@@ -76,10 +82,91 @@ void MinimapBlock::update()
 
 void MinimapBlock::updateTile(int x, int y, const MinimapTile& tile)
 {
-    if(m_tiles[getTileIndex(x,y)].color != tile.color)
+    load();
+    MinimapTile& current = m_tiles[getTileIndex(x,y)];
+    if(current == tile)
+        return;
+    if(current.color != tile.color)
         m_mustUpdate = true;
 
-    m_tiles[getTileIndex(x,y)] = tile;
+    beginWrite();
+    current = tile;
+    endWrite();
+
+    std::lock_guard<std::mutex> lock(m_sourceMutex);
+    m_source.reset();
+}
+
+void MinimapBlock::resetTile(int x, int y)
+{
+    updateTile(x, y, MinimapTile());
+}
+
+MinimapTile MinimapBlock::readTile(int x, int y)
+{
+    load();
+    while(true) {
+        uint32 version = m_version.load(std::memory_order_acquire);
+        if(version & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+        MinimapTile tile = m_tiles[getTileIndex(x,y)];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if(m_version.load(std::memory_order_relaxed) == version)
+            return tile;
+    }
+}
+
+void MinimapBlock::setCompressed(const std::shared_ptr<std::string>& source, uint32 offset, uint16 length, bool decompressLater)
+{
+    std::lock_guard<std::mutex> lock(m_sourceMutex);
+    m_source = source;
+    m_sourceOffset = offset;
+    m_sourceLength = length;
+    if(decompressLater)
+        m_loaded.store(false, std::memory_order_release);
+}
+
+std::shared_ptr<std::string> MinimapBlock::getCompressed(uint32& offset, uint16& length)
+{
+    std::lock_guard<std::mutex> lock(m_sourceMutex);
+    offset = m_sourceOffset;
+    length = m_sourceLength;
+    return m_source;
+}
+
+bool MinimapBlock::isDirty()
+{
+    std::lock_guard<std::mutex> lock(m_sourceMutex);
+    return !m_source;
+}
+
+void MinimapBlock::decompress()
+{
+    // may run on any thread, the first one to get here decompresses and the others wait for it
+    std::lock_guard<std::mutex> lock(m_sourceMutex);
+    if(m_loaded.load(std::memory_order_relaxed))
+        return;
+
+    const uLongf blockSize = MMBLOCK_SIZE * MMBLOCK_SIZE * sizeof(MinimapTile);
+    uLongf destLen = blockSize;
+    beginWrite();
+    int ret = uncompress((uchar*)m_tiles.data(), &destLen, (const uchar*)m_source->data() + m_sourceOffset, m_sourceLength);
+    if(ret != Z_OK || destLen != blockSize) {
+        m_tiles.fill(MinimapTile());
+        m_source.reset();
+    }
+    endWrite();
+    m_loaded.store(true, std::memory_order_release);
+}
+
+Minimap::~Minimap()
+{
+    for(auto& pages : m_pages) {
+        for(auto& page : pages)
+            delete page.load();
+    }
 }
 
 void Minimap::init()
@@ -93,9 +180,32 @@ void Minimap::terminate()
 
 void Minimap::clean()
 {
-    std::lock_guard<std::mutex> lock(m_lock);
-    for(int i=0;i<=Otc::MAX_Z;++i)
-        m_tileBlocks[i].clear();
+    // blocks may still be read by other threads, they are emptied instead of freed
+    m_otmmFile.clear();
+    for(int i=0;i<=Otc::MAX_Z;++i) {
+        for(auto& it : m_tileBlocks[i])
+            it.second->clean();
+    }
+}
+
+MinimapBlock& Minimap::getBlock(const Position& pos)
+{
+    if(MinimapBlock* block = findBlock(pos))
+        return *block;
+
+    uint bx = pos.x / MMBLOCK_SIZE, by = pos.y / MMBLOCK_SIZE;
+    std::atomic<MinimapPage*>& pagePtr = m_pages[pos.z][(by / MMPAGE_SIZE) * MMPAGES_PER_SIDE + bx / MMPAGE_SIZE];
+    MinimapPage* page = pagePtr.load(std::memory_order_relaxed);
+    if(!page) {
+        page = new MinimapPage;
+        pagePtr.store(page, std::memory_order_release);
+    }
+
+    auto block = std::make_unique<MinimapBlock>();
+    MinimapBlock* blockPtr = block.get();
+    m_tileBlocks[pos.z].emplace_back(getBlockIndex(pos), std::move(block));
+    page->blocks[(by % MMPAGE_SIZE) * MMPAGE_SIZE + bx % MMPAGE_SIZE].store(blockPtr, std::memory_order_release);
+    return *blockPtr;
 }
 
 void Minimap::draw(const Rect& screenRect, const Position& mapCenter, float scale, const Color& color)
@@ -123,14 +233,13 @@ void Minimap::draw(const Rect& screenRect, const Position& mapCenter, float scal
             if(x < 0 || x >= 65536)
                 continue;
 
-            Position blockPos(x, y, mapCenter.z);
-            if(!hasBlock(blockPos))
+            MinimapBlock* block = findBlock(Position(x, y, mapCenter.z));
+            if(!block)
                 continue;
 
-            MinimapBlock& block = getBlock(Position(x, y, mapCenter.z));
-            block.update();
+            block->update();
 
-            const TexturePtr& tex = block.getTexture();
+            const TexturePtr& tex = block->getTexture();
             if(tex) {
                 Rect src(0, 0, MMBLOCK_SIZE, MMBLOCK_SIZE);
                 Rect dest(xs, ys, MMBLOCK_SIZE * scale, MMBLOCK_SIZE * scale);
@@ -200,11 +309,15 @@ void Minimap::updateTile(const Position& pos, const TilePtr& tile)
         minimapTile.flags |= MinimapTileEmpty;
         minimapTile.speed = 1;
     }
+    updateTile(pos, minimapTile);
+}
 
-    if(minimapTile != MinimapTile()) {
+void Minimap::updateTile(const Position& pos, const MinimapTile& tile)
+{
+    if(tile != MinimapTile() && isInside(pos)) {
         MinimapBlock& block = getBlock(pos);
         Point offsetPos = getBlockOffset(Point(pos.x, pos.y));
-        block.updateTile(pos.x - offsetPos.x, pos.y - offsetPos.y, minimapTile);
+        block.updateTile(pos.x - offsetPos.x, pos.y - offsetPos.y, tile);
         block.justSaw();
     }
 }
@@ -212,26 +325,20 @@ void Minimap::updateTile(const Position& pos, const TilePtr& tile)
 const MinimapTile& Minimap::getTile(const Position& pos)
 {
     static MinimapTile nulltile;
-    if(pos.z <= Otc::MAX_Z && hasBlock(pos)) {
-        MinimapBlock& block = getBlock(pos);
+    if(MinimapBlock* block = findBlock(pos)) {
         Point offsetPos = getBlockOffset(Point(pos.x, pos.y));
-        return block.getTile(pos.x - offsetPos.x, pos.y - offsetPos.y);
+        return block->getTile(pos.x - offsetPos.x, pos.y - offsetPos.y);
     }
     return nulltile;
 }
 
-std::pair<MinimapBlock_ptr, MinimapTile> Minimap::threadGetTile(const Position& pos) {
-    std::lock_guard<std::mutex> lock(m_lock);
-    static MinimapTile nulltile;
-    
-    if (pos.z <= Otc::MAX_Z && hasBlock(pos)) {
-        MinimapBlock_ptr block = m_tileBlocks[pos.z][getBlockIndex(pos)];
-        if (block) {
-            Point offsetPos = getBlockOffset(Point(pos.x, pos.y));
-            return std::make_pair(block, block->getTile(pos.x - offsetPos.x, pos.y - offsetPos.y));
-        }
+MinimapTile Minimap::threadGetTile(const Position& pos)
+{
+    if(MinimapBlock* block = findBlock(pos)) {
+        Point offsetPos = getBlockOffset(Point(pos.x, pos.y));
+        return block->readTile(pos.x - offsetPos.x, pos.y - offsetPos.y);
     }
-    return std::make_pair(nullptr, nulltile);
+    return MinimapTile();
 }
 
 bool Minimap::loadImage(const std::string& fileName, const Position& topLeft, float colorFactor)
@@ -293,12 +400,16 @@ bool Minimap::loadImage(const std::string& fileName, const Position& topLeft, fl
                     continue;
 
                 Position pos(topLeft.x + x, topLeft.y + y, topLeft.z);
+                if(!isInside(pos))
+                    continue;
+
                 MinimapBlock& block = getBlock(pos);
                 Point offsetPos = getBlockOffset(Point(pos.x, pos.y));
-                MinimapTile& tile = block.getTile(pos.x - offsetPos.x, pos.y - offsetPos.y);
+                MinimapTile tile = block.getTile(pos.x - offsetPos.x, pos.y - offsetPos.y);
                 if(!(tile.flags & MinimapTileWasSeen)) {
                     tile.color = c;
                     tile.flags = flags;
+                    block.updateTile(pos.x - offsetPos.x, pos.y - offsetPos.y, tile);
                     block.mustUpdate();
                 }
             }
@@ -346,7 +457,8 @@ bool Minimap::loadOtmm(const std::string& fileName)
         fin->getU32(); // flags
 
         switch(version) {
-            case 1: {
+            case 1:
+            case 2: {
                 fin->getString(); // description
                 break;
             }
@@ -354,36 +466,58 @@ bool Minimap::loadOtmm(const std::string& fileName)
                 stdext::throw_exception("OTMM version not supported");
         }
 
+        // the whole file stays in memory and blocks are decompressed from it on first use
+        auto data = std::make_shared<std::string>(fin->size(), '\0');
+        fin->seek(0);
+        if(fin->read(&(*data)[0], data->size()) != (int)data->size())
+            stdext::throw_exception("unable to read file");
         fin->seek(start);
 
-        uint blockSize = MMBLOCK_SIZE * MMBLOCK_SIZE * sizeof(MinimapTile);
-        std::vector<uchar> compressBuffer(compressBound(blockSize));
-        std::vector<uchar> decompressBuffer(blockSize);
-
-        while(true) {
-            Position pos;
-            pos.x = fin->getU16();
-            pos.y = fin->getU16();
-            pos.z = fin->getU8();
-
-            // end of file or file is corrupted
-            if(!pos.isValid() || pos.z >= Otc::MAX_Z+1)
-                break;
+        auto addBlock = [&](const Position& pos, uint32 offset, uint16 len) {
+            if(offset + len > data->size())
+                stdext::throw_exception("block data out of bounds");
 
             MinimapBlock& block = getBlock(pos);
-            ulong len = fin->getU16();
-            ulong destLen = blockSize;
-            fin->read(compressBuffer.data(), len);
-            int ret = uncompress(decompressBuffer.data(), &destLen, compressBuffer.data(), len);
-            if(ret != Z_OK || destLen != blockSize)
-                break;
-
-            memcpy((uchar*)&block.getTiles(), decompressBuffer.data(), blockSize);
+            block.setCompressed(data, offset, len, true);
             block.mustUpdate();
             block.justSaw();
+        };
+
+        if(version == 1) {
+            // no index, walk the blocks skipping their data
+            while(true) {
+                Position pos;
+                pos.x = fin->getU16();
+                pos.y = fin->getU16();
+                pos.z = fin->getU8();
+
+                // end of file or file is corrupted
+                if(!pos.isValid() || pos.z >= Otc::MAX_Z+1)
+                    break;
+
+                uint16 len = fin->getU16();
+                uint32 offset = fin->tell();
+                addBlock(pos, offset, len);
+                fin->skip(len);
+            }
+        } else {
+            uint32 blocks = fin->getU32();
+            for(uint32 i = 0; i < blocks; ++i) {
+                Position pos;
+                pos.x = fin->getU16();
+                pos.y = fin->getU16();
+                pos.z = fin->getU8();
+                uint32 offset = fin->getU32();
+                uint16 len = fin->getU16();
+
+                if(!pos.isValid() || pos.z >= Otc::MAX_Z+1)
+                    stdext::throw_exception("invalid block position");
+                addBlock(pos, offset, len);
+            }
         }
 
         fin->close();
+        m_otmmFile = fileName;
         return true;
     } catch(stdext::exception& e) {
         g_logger.error(stdext::format("failed to load OTMM minimap: %s", e.what()));
@@ -396,12 +530,52 @@ void Minimap::saveOtmm(const std::string& fileName)
     try {
         stdext::timer saveTimer;
 
+        struct BlockEntry {
+            Position pos;
+            std::shared_ptr<std::string> data;
+            uint32 offset;
+            uint16 length;
+        };
+        std::vector<BlockEntry> entries;
+        bool changed = fileName != m_otmmFile;
+
+        // blocks that didn't change since they were loaded or saved keep their compressed data
+        uint blockSize = MMBLOCK_SIZE * MMBLOCK_SIZE * sizeof(MinimapTile);
+        const int COMPRESS_LEVEL = 3;
+        for(uint8_t z = 0; z <= Otc::MAX_Z; ++z) {
+            for(auto& it : m_tileBlocks[z]) {
+                MinimapBlock& block = *it.second;
+                if(!block.wasSeen())
+                    continue;
+
+                BlockEntry entry;
+                entry.pos = getIndexPosition(it.first, z);
+                entry.data = block.getCompressed(entry.offset, entry.length);
+                if(!entry.data) {
+                    ulong len = compressBound(blockSize);
+                    entry.data = std::make_shared<std::string>(len, '\0');
+                    int ret = compress2((uchar*)&(*entry.data)[0], &len, (uchar*)&block.getTiles(), blockSize, COMPRESS_LEVEL);
+                    VALIDATE(ret == Z_OK);
+                    entry.data->resize(len);
+                    entry.offset = 0;
+                    entry.length = len;
+                    block.setCompressed(entry.data, 0, len, false);
+                    changed = true;
+                }
+                entries.push_back(std::move(entry));
+            }
+        }
+
+        if(!changed)
+            return;
+
 #ifndef ANDROID
         std::string tmpFileName = fileName;
         tmpFileName += ".tmp";
         FileStreamPtr fin = g_resources.createFile(tmpFileName);
 #else
         FileStreamPtr fin = g_resources.createFile(fileName);
+        m_otmmFile = fileName;
 #endif
 
         //TODO: compression flag with zlib
@@ -413,8 +587,8 @@ void Minimap::saveOtmm(const std::string& fileName)
         fin->addU16(OTMM_VERSION);
         fin->addU32(flags);
 
-        // version 1 header
-        fin->addString("OTMM 1.0"); // description
+        // version 2 header
+        fin->addString("OTMM 2.0"); // description
 
         // go back and rewrite where the map data starts
         uint32 start = fin->tell();
@@ -422,35 +596,21 @@ void Minimap::saveOtmm(const std::string& fileName)
         fin->addU16(start);
         fin->seek(start);
 
-        uint blockSize = MMBLOCK_SIZE * MMBLOCK_SIZE * sizeof(MinimapTile);
-        std::vector<uchar> compressBuffer(compressBound(blockSize));
-        const int COMPRESS_LEVEL = 3;
-
-        for(uint8_t z = 0; z <= Otc::MAX_Z; ++z) {
-            for(auto& it : m_tileBlocks[z]) {
-                int index = it.first;
-                MinimapBlock& block = *it.second;
-                if(!block.wasSeen())
-                    continue;
-
-                Position pos = getIndexPosition(index, z);
-                fin->addU16(pos.x);
-                fin->addU16(pos.y);
-                fin->addU8(pos.z);
-
-                ulong len = blockSize;
-                int ret = compress2(compressBuffer.data(), &len, (uchar*)&block.getTiles(), blockSize, COMPRESS_LEVEL);
-                VALIDATE(ret == Z_OK);
-                fin->addU16(len);
-                fin->write(compressBuffer.data(), len);
-            }
+        // block index, each entry is x, y, z, data offset and data length
+        const uint32 entrySize = 2 + 2 + 1 + 4 + 2;
+        uint32 offset = start + 4 + entries.size() * entrySize;
+        fin->addU32(entries.size());
+        for(const BlockEntry& entry : entries) {
+            fin->addU16(entry.pos.x);
+            fin->addU16(entry.pos.y);
+            fin->addU8(entry.pos.z);
+            fin->addU32(offset);
+            fin->addU16(entry.length);
+            offset += entry.length;
         }
 
-        // end of file
-        Position invalidPos;
-        fin->addU16(invalidPos.x);
-        fin->addU16(invalidPos.y);
-        fin->addU8(invalidPos.z);
+        for(const BlockEntry& entry : entries)
+            fin->write(entry.data->data() + entry.offset, entry.length);
 
         fin->flush();
 
@@ -461,6 +621,7 @@ void Minimap::saveOtmm(const std::string& fileName)
         tmpFilePath += tmpFileName;
         if(std::filesystem::file_size(tmpFilePath) > 1024) {
             std::filesystem::rename(tmpFilePath, filePath);
+            m_otmmFile = fileName;
         }
 /*
         std::stringstream path;
@@ -30,7 +30,7 @@
 enum {
     MMBLOCK_SIZE = 64,
     OTMM_SIGNATURE = 0x4D4d544F,
-    OTMM_VERSION = 1
+    OTMM_VERSION = 2
 };
 
 enum MinimapTileFlags {
@@ -53,35 +53,79 @@ struct MinimapTile
     bool operator!=(const MinimapTile& other) const { return !(*this == other); }
 };
 
+#pragma pack(pop)
+
+// Tiles are only written by the dispatcher thread. Other threads read them with readTile,
+// which never locks: writes bump m_version to an odd value while in progress (seqlock)
+// and readers retry when the version changed under them.
+// Blocks loaded from an OTMM file only reference their compressed bytes until the first access
+// decompresses them. Those bytes are kept until a tile changes, so unchanged blocks are saved
+// back without being recompressed.
 class MinimapBlock
 {
 public:
     void clean();
     void update();
     void updateTile(int x, int y, const MinimapTile& tile);
-    MinimapTile& getTile(int x, int y) { return m_tiles[getTileIndex(x,y)]; }
-    void resetTile(int x, int y) { m_tiles[getTileIndex(x,y)] = MinimapTile(); }
-    uint getTileIndex(int x, int y) { return ((y % MMBLOCK_SIZE) * MMBLOCK_SIZE) + (x % MMBLOCK_SIZE); }
+    MinimapTile& getTile(int x, int y) { load(); return m_tiles[getTileIndex(x,y)]; }
+    MinimapTile readTile(int x, int y);
+    void resetTile(int x, int y);
+    uint getTileIndex(int x, int y) const { return ((y % MMBLOCK_SIZE) * MMBLOCK_SIZE) + (x % MMBLOCK_SIZE); }
     const TexturePtr& getTexture() { return m_texture; }
-    std::array<MinimapTile, MMBLOCK_SIZE * MMBLOCK_SIZE>& getTiles() { return m_tiles; }
+    std::array<MinimapTile, MMBLOCK_SIZE * MMBLOCK_SIZE>& getTiles() { load(); return m_tiles; }
     void mustUpdate() { m_mustUpdate = true; }
     void justSaw() { m_wasSeen = true; }
     bool wasSeen() { return m_wasSeen; }
+
+    void setCompressed(const std::shared_ptr<std::string>& source, uint32 offset, uint16 length, bool decompressLater);
+    std::shared_ptr<std::string> getCompressed(uint32& offset, uint16& length);
+    bool isDirty();
+    void load() {
+        if(!m_loaded.load(std::memory_order_acquire))
+            decompress();
+    }
+
+    void beginWrite() {
+        m_version.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    void endWrite() { m_version.fetch_add(1, std::memory_order_release); }
+
 private:
+    void decompress();
+
     TexturePtr m_texture;
     std::array<MinimapTile, MMBLOCK_SIZE * MMBLOCK_SIZE> m_tiles;
+    std::atomic<uint32> m_version{0};
+    std::atomic<bool> m_loaded{true};
+    std::mutex m_sourceMutex;
+    std::shared_ptr<std::string> m_source;
+    uint32 m_sourceOffset = 0;
+    uint16 m_sourceLength = 0;
     stdext::boolean<true> m_mustUpdate;
     stdext::boolean<false> m_wasSeen;
 };
 
-#pragma pack(pop)
+enum {
+    MMPAGE_SIZE = 32, // blocks per page side
+    MMPAGES_PER_SIDE = 65536 / MMBLOCK_SIZE / MMPAGE_SIZE
+};
 
-using MinimapBlock_ptr = std::shared_ptr<MinimapBlock>;
+// Blocks are published through a two level radix directory of atomic pointers, so threads
+// looking them up never take a lock. Published blocks are never freed while the client runs,
+// clean() only resets their tiles.
+struct MinimapPage
+{
+    MinimapPage() { for(auto& block : blocks) block.store(nullptr, std::memory_order_relaxed); }
+    std::atomic<MinimapBlock*> blocks[MMPAGE_SIZE * MMPAGE_SIZE];
+};
 
 class Minimap
 {
 
 public:
+    ~Minimap();
+
     void init();
     void terminate();
 
@@ -93,8 +137,9 @@ public:
     Rect getTileRect(const Position& pos, const Rect& screenRect, const Position& mapCenter, float scale);
 
     void updateTile(const Position& pos, const TilePtr& tile);
+    void updateTile(const Position& pos, const MinimapTile& tile);
     const MinimapTile& getTile(const Position& pos);
-    std::pair<MinimapBlock_ptr, MinimapTile> threadGetTile(const Position& pos);
+    MinimapTile threadGetTile(const Position& pos);
 
     bool loadImage(const std::string& fileName, const Position& topLeft, float colorFactor);
     void saveImage(const std::string& fileName, int minX, int minY, int maxX, int maxY, short z);
@@ -103,21 +148,29 @@ public:
 
 private:
     Rect calcMapRect(const Rect& screenRect, const Position& mapCenter, float scale);
-    bool hasBlock(const Position& pos) { return m_tileBlocks[pos.z].find(getBlockIndex(pos)) != m_tileBlocks[pos.z].end(); }
-    MinimapBlock& getBlock(const Position& pos) { 
-        std::lock_guard<std::mutex> lock(m_lock);
-        auto& ptr = m_tileBlocks[pos.z][getBlockIndex(pos)];
-        if (!ptr)
-            ptr = std::make_shared<MinimapBlock>();
-        return *ptr;
+    static bool isInside(const Position& pos) { return pos.x >= 0 && pos.y >= 0 && pos.x <= 65535 && pos.y <= 65535 && pos.z >= 0 && pos.z <= Otc::MAX_Z; }
+    MinimapBlock* findBlock(const Position& pos) {
+        if(!isInside(pos))
+            return nullptr;
+        uint bx = pos.x / MMBLOCK_SIZE, by = pos.y / MMBLOCK_SIZE;
+        MinimapPage* page = m_pages[pos.z][(by / MMPAGE_SIZE) * MMPAGES_PER_SIDE + bx / MMPAGE_SIZE].load(std::memory_order_acquire);
+        if(!page)
+            return nullptr;
+        return page->blocks[(by % MMPAGE_SIZE) * MMPAGE_SIZE + bx % MMPAGE_SIZE].load(std::memory_order_acquire);
     }
+    bool hasBlock(const Position& pos) { return findBlock(pos) != nullptr; }
+    MinimapBlock& getBlock(const Position& pos);
     Point getBlockOffset(const Point& pos) { return Point(pos.x - pos.x % MMBLOCK_SIZE,
                                                           pos.y - pos.y % MMBLOCK_SIZE); }
     Position getIndexPosition(int index, int z) { return Position((index % (65536 / MMBLOCK_SIZE))*MMBLOCK_SIZE,
                                                                   (index / (65536 / MMBLOCK_SIZE))*MMBLOCK_SIZE, z); }
     uint getBlockIndex(const Position& pos) { return ((pos.y / MMBLOCK_SIZE) * (65536 / MMBLOCK_SIZE)) + (pos.x / MMBLOCK_SIZE); }
-    std::unordered_map<uint, MinimapBlock_ptr> m_tileBlocks[Otc::MAX_Z+1];
-    std::mutex m_lock;
+
+    std::atomic<MinimapPage*> m_pages[Otc::MAX_Z+1][MMPAGES_PER_SIDE * MMPAGES_PER_SIDE] = {};
+    // every published block with its index, only used by the dispatcher thread
+    std::vector<std::pair<uint, std::unique_ptr<MinimapBlock>>> m_tileBlocks[Otc::MAX_Z+1];
+    // file the blocks were last loaded from or saved to, saving there again is skipped when nothing changed
+    std::string m_otmmFile;
 };
 
 extern Minimap g_minimap;
@@ -316,15 +316,14 @@ void Outfit::draw(Point dest, Otc::Direction direction, uint walkAnimationPhase,
         if (!outfitParams)
             continue;
 
-        DrawQueueItemTexturedRect* outfit = nullptr;
-        if (m_shader.empty())
-            outfit = new DrawQueueItemOutfit(outfitParams->dest, outfitParams->texture, outfitParams->src, outfitParams->offset, colors, outfitParams->color);
-        else {
-            if (yPattern == 0)
-                center = outfitParams->dest.center();
-            outfit = new DrawQueueItemOutfitWithShader(outfitParams->dest, outfitParams->texture, outfitParams->src, outfitParams->offset, center, colors, m_shader);
+        if (m_shader.empty()) {
+            g_drawQueue->addOutfit(outfitParams->dest, outfitParams->texture, outfitParams->src, outfitParams->offset, colors, outfitParams->color);
+            continue;
         }
-        g_drawQueue->add(outfit);
+
+        if (yPattern == 0)
+            center = outfitParams->dest.center();
+        g_drawQueue->add(new DrawQueueItemOutfitWithShader(outfitParams->dest, outfitParams->texture, outfitParams->src, outfitParams->offset, center, colors, m_shader));
     }
 
     if (m_wings && (direction == Otc::North || direction == Otc::West)) {
@@ -400,63 +399,6 @@ void Outfit::resetClothes()
 
 // drawing
 
-bool DrawQueueItemOutfit::cache()
-{
-    m_texture->update();
-    uint64_t hash = (((uint64_t)m_texture->getUniqueId()) << 48) +
-        (((uint64_t)m_src.x()) << 36) +
-        (((uint64_t)m_src.y()) << 24) +
-        (((uint64_t)m_src.width()) << 12) +
-        (((uint64_t)m_src.height())) +
-        (((uint64_t)m_colors) * 1125899906842597ULL);
-    bool drawNow = false;
-    Point atlasPos = g_atlas.cache(hash, m_src.size(), drawNow);
-    if (atlasPos.x < 0) { return false; } // can't be cached
-    if (drawNow) { g_drawCache.bind(); draw(atlasPos); }
-
-    if (!g_drawCache.hasSpace(6))
-        return false;
-
-    g_drawCache.addTexturedRect(m_dest, Rect(atlasPos, m_src.size()), m_color);
-    return true;
-}
-
-void DrawQueueItemOutfit::draw()
-{
-    if (!m_texture) return;
-    Matrix4 mat4;
-    for (int x = 0; x < 4; ++x) {
-        Color color = Color::getOutfitColor((m_colors >> (x * 8)) & 0xFF);
-        mat4(x + 1, 1) = color.rF();
-        mat4(x + 1, 2) = color.gF();
-        mat4(x + 1, 3) = color.bF();
-        mat4(x + 1, 4) = color.aF();
-    }
-    g_painter->setDrawOutfitLayersProgram();
-    g_painter->setMatrixColor(mat4);
-    g_painter->setOffset(m_offset);
-    g_painter->drawTexturedRect(m_dest, m_texture, m_src);
-    g_painter->resetShaderProgram();
-}
-
-void DrawQueueItemOutfit::draw(const Point& pos)
-{
-    if (!m_texture) return;
-    Matrix4 mat4;
-    for (int x = 0; x < 4; ++x) {
-        Color color = Color::getOutfitColor((m_colors >> (x * 8)) & 0xFF);
-        mat4(x + 1, 1) = color.rF();
-        mat4(x + 1, 2) = color.gF();
-        mat4(x + 1, 3) = color.bF();
-        mat4(x + 1, 4) = color.aF();
-    }
-    g_painter->setDrawOutfitLayersProgram();
-    g_painter->setMatrixColor(mat4);
-    g_painter->setOffset(m_offset);
-    g_painter->drawTexturedRect(Rect(pos, m_src.size()), m_texture, m_src);
-    g_painter->resetShaderProgram();
-}
-
 void DrawQueueItemOutfitWithShader::draw()
 {
     if (!m_texture) return;
@@ -82,19 +82,6 @@ private:
     bool m_center = false;
 };
 
-struct DrawQueueItemOutfit : public DrawQueueItemTexturedRect {
-    DrawQueueItemOutfit(const Rect& rect, const TexturePtr& texture, const Rect& src, const Point& offset, int32_t colors, const Color& color) :
-        DrawQueueItemTexturedRect(rect, texture, src, color), m_offset(offset), m_colors(colors)
-    {};
-
-    void draw() override;
-    void draw(const Point& pos) override;
-    bool cache() override;
-
-    Point m_offset;
-    int32_t m_colors;
-};
-
 struct DrawQueueItemOutfitWithShader : public DrawQueueItemTexturedRect {
     DrawQueueItemOutfitWithShader(const Rect& rect, const TexturePtr& texture, const Rect& src, const Point& offset, const Point& center, int32_t colors, const std::string& shader) :
         DrawQueueItemTexturedRect(rect, texture, src, Color::white), m_offset(offset), m_center(center), m_colors(colors), m_shader(shader)
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "pathfinding.h"
+
+PathFinder& PathFinder::get()
+{
+    static thread_local PathFinder pathFinder;
+    return pathFinder;
+}
+
+void PathFinder::reset()
+{
+    m_nodes.clear();
+    m_heap.clear();
+    if(++m_generation == 0) { // stamps wrapped around, old ones could be valid again
+        std::fill(m_slotStamps.begin(), m_slotStamps.end(), 0);
+        m_generation = 1;
+    }
+}
+
+uint32 PathFinder::find(const Position& pos) const
+{
+    if(m_slotNodes.empty())
+        return InvalidNode;
+
+    const uint32 mask = m_slotNodes.size() - 1;
+    for(uint32 slot = getSlot(getKey(pos)); m_slotStamps[slot] == m_generation; slot = (slot + 1) & mask) {
+        uint32 id = m_slotNodes[slot];
+        if(m_nodes[id].pos == pos)
+            return id;
+    }
+    return InvalidNode;
+}
+
+uint32 PathFinder::add(const Position& pos)
+{
+    if((m_nodes.size() + 1) * 2 > m_slotNodes.size())
+        rehash(std::max<size_t>(4096, m_slotNodes.size() * 2));
+
+    uint32 id = m_nodes.size();
+    m_nodes.push_back(PathNode{ pos, 0, 0, 0, InvalidNode, -1, 0, 0, Otc::InvalidDirection, false, false });
+
+    const uint32 mask = m_slotNodes.size() - 1;
+    uint32 slot = getSlot(getKey(pos));
+    while(m_slotStamps[slot] == m_generation)
+        slot = (slot + 1) & mask;
+    m_slotStamps[slot] = m_generation;
+    m_slotNodes[slot] = id;
+    return id;
+}
+
+void PathFinder::rehash(size_t capacity)
+{
+    m_shift = 64;
+    for(size_t size = capacity; size > 1; size >>= 1)
+        --m_shift;
+
+    m_slotNodes.assign(capacity, 0);
+    m_slotStamps.assign(capacity, 0);
+    m_generation = 1;
+
+    const uint32 mask = capacity - 1;
+    for(uint32 id = 0; id < m_nodes.size(); ++id) {
+        uint32 slot = getSlot(getKey(m_nodes[id].pos));
+        while(m_slotStamps[slot] == m_generation)
+            slot = (slot + 1) & mask;
+        m_slotStamps[slot] = m_generation;
+        m_slotNodes[slot] = id;
+    }
+}
+
+void PathFinder::push(uint32 id)
+{
+    PathNode& node = m_nodes[id];
+    if(node.heapIndex < 0) {
+        node.heapIndex = m_heap.size();
+        m_heap.push_back(id);
+    }
+    siftUp(node.heapIndex);
+}
+
+uint32 PathFinder::pop()
+{
+    uint32 id = m_heap.front();
+    m_nodes[id].heapIndex = -1;
+    uint32 last = m_heap.back();
+    m_heap.pop_back();
+    if(!m_heap.empty()) {
+        m_heap[0] = last;
+        m_nodes[last].heapIndex = 0;
+        siftDown(0);
+    }
+    return id;
+}
+
+void PathFinder::siftUp(size_t pos)
+{
+    uint32 id = m_heap[pos];
+    while(pos > 0) {
+        size_t parent = (pos - 1) / 2;
+        if(!isLess(id, m_heap[parent]))
+            break;
+        m_heap[pos] = m_heap[parent];
+        m_nodes[m_heap[pos]].heapIndex = pos;
+        pos = parent;
+    }
+    m_heap[pos] = id;
+    m_nodes[id].heapIndex = pos;
+}
+
+void PathFinder::siftDown(size_t pos)
+{
+    uint32 id = m_heap[pos];
+    const size_t size = m_heap.size();
+    while(true) {
+        size_t child = pos * 2 + 1;
+        if(child >= size)
+            break;
+        if(child + 1 < size && isLess(m_heap[child + 1], m_heap[child]))
+            ++child;
+        if(!isLess(m_heap[child], id))
+            break;
+        m_heap[pos] = m_heap[child];
+        m_nodes[m_heap[pos]].heapIndex = pos;
+        pos = child;
+    }
+    m_heap[pos] = id;
+    m_nodes[id].heapIndex = pos;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef PATHFINDING_H
+#define PATHFINDING_H
+
+#include "declarations.h"
+#include "position.h"
+
+struct PathNode {
+    Position pos;
+    float speed;
+    float cost;
+    float totalCost;
+    uint32 prev;
+    int32 heapIndex;
+    int distance;
+    int unseen;
+    Otc::Direction dir;
+    bool blocked;
+    bool endpoint; // a blocked goal, it can be reached but no path goes through it
+};
+
+// walkability of a tile copied from the map, so searches can run outside of the dispatcher thread
+struct PathTile {
+    Position pos;
+    float speed;
+    bool blocked;
+};
+using PathTileList = std::vector<PathTile>;
+using PathTileListPtr = std::shared_ptr<PathTileList>;
+
+// Reusable search state, one per thread. Nodes live in a flat array and are found through
+// a generation stamped hash table, so starting a new search doesn't free or clear anything.
+// The open list is a binary heap of node indexes with decrease-key support.
+class PathFinder {
+public:
+    enum : uint32 { InvalidNode = 0xFFFFFFFF };
+
+    static PathFinder& get();
+
+    void reset();
+
+    uint32 find(const Position& pos) const;
+    uint32 add(const Position& pos);
+    PathNode& node(uint32 id) { return m_nodes[id]; }
+    size_t size() const { return m_nodes.size(); }
+
+    // inserts the node into the open list or moves it up after its totalCost was lowered
+    void push(uint32 id);
+    uint32 pop();
+    bool empty() const { return m_heap.empty(); }
+
+private:
+    static uint64 getKey(const Position& pos) { return (uint64)pos.x | ((uint64)pos.y << 16) | ((uint64)pos.z << 32); }
+    uint32 getSlot(uint64 key) const { return (uint32)((key * 0x9E3779B97F4A7C15ull) >> m_shift); }
+    void rehash(size_t capacity);
+
+    bool isLess(uint32 a, uint32 b) const { return m_nodes[a].totalCost < m_nodes[b].totalCost; }
+    void siftUp(size_t pos);
+    void siftDown(size_t pos);
+
+    std::vector<PathNode> m_nodes;
+    std::vector<uint32> m_heap;
+    std::vector<uint32> m_slotNodes;
+    std::vector<uint32> m_slotStamps;
+    uint32 m_generation = 1;
+    uint m_shift = 64;
+};
+
+#endif
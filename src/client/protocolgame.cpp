@@ -27,6 +27,8 @@
 #include "item.h"
 #include "localplayer.h"
 
+std::bitset<256> ProtocolGame::m_opcodeInterest;
+
 void ProtocolGame::login(const std::string& accountName, const std::string& accountPassword, const std::string& host, uint16 port, const std::string& characterName, const std::string& authenticatorToken, const std::string& sessionKey, const std::string& worldName)
 {
     m_accountName = accountName;
@@ -26,6 +26,7 @@
 #include "declarations.h"
 #include "protocolcodes.h"
 #include <framework/net/protocol.h>
+#include <bitset>
 #include "creature.h"
 
 class ProtocolGame : public Protocol
@@ -313,10 +314,16 @@ public:
     Position getPosition(const InputMessagePtr& msg);
     Imbuement getImbuementInfo(const InputMessagePtr& msg);
 
+    // lua onOpcode is only called for opcodes somebody registered, the rest go straight to the native parser
+    static void setOpcodeInterest(uint8 opcode, bool interested) { m_opcodeInterest[opcode] = interested; }
+    static bool hasOpcodeInterest(uint8 opcode) { return m_opcodeInterest[opcode]; }
+
     int getRecivedPacketsCount() { return m_recivedPackeds; }
     int getRecivedPacketsSize() { return m_recivedPackedsSize; }
 
 private:
+    static std::bitset<256> m_opcodeInterest;
+
     stdext::boolean<false> m_enableSendExtendedOpcode;
     stdext::boolean<false> m_gameInitialized;
     stdext::boolean<false> m_mapKnown;
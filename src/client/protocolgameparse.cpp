@@ -48,7 +48,13 @@ void ProtocolGame::parseMessage(const InputMessagePtr& msg)
             opcodePos = msg->getReadPos();
             opcode = msg->getU8();
 
-            AutoStat s(STATS_PACKETS, std::to_string((int)opcode));
+            static const std::array<uint32_t, 256> opcodeZones = [] {
+                std::array<uint32_t, 256> zones;
+                for (int i = 0; i < 256; ++i)
+                    zones[i] = g_stats.registerZone(STATS_PACKETS, std::to_string(i));
+                return zones;
+            }();
+            AutoStat s(opcodeZones[opcode]);
 
             if (opcode == 0x00) {
                 std::string buffer = msg->getString();
@@ -70,13 +76,15 @@ void ProtocolGame::parseMessage(const InputMessagePtr& msg)
             }
 
             // try to parse in lua first
-            int readPos = msg->getReadPos();
-            if (callLuaField<bool>("onOpcode", opcode, msg)) {
-                prevOpcode = opcode;
-                prevOpcodePos = opcodePos;
-                continue;
-            } else
-                msg->setReadPos(readPos); // restore read pos
+            if (hasOpcodeInterest(opcode)) {
+                int readPos = msg->getReadPos();
+                if (callLuaField<bool>("onOpcode", opcode, msg)) {
+                    prevOpcode = opcode;
+                    prevOpcodePos = opcodePos;
+                    continue;
+                } else
+                    msg->setReadPos(readPos); // restore read pos
+            }
 
             switch (opcode) {
             case Proto::GameServerLoginOrPendingState:
@@ -3277,6 +3285,7 @@ int ProtocolGame::setTileDescription(const InputMessagePtr& msg, Position positi
 
         ThingPtr thing = getThing(msg);
         g_map.addThing(thing, position, stackPos);
+        g_things.prefetch(thing);
     }
 
     return 0;
@@ -44,6 +44,7 @@ void SpriteManager::terminate()
 
 bool SpriteManager::loadSpr(std::string file)
 {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
     m_spritesCount = 0;
     m_signature = 0;
     m_loaded = false;
@@ -296,6 +297,7 @@ void SpriteManager::dumpSprites(std::string dir)
 
 void SpriteManager::unload()
 {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
     m_spritesCount = 0;
     m_signature = 0;
     m_spritesFile = nullptr;
@@ -304,6 +306,7 @@ void SpriteManager::unload()
 
 ImagePtr SpriteManager::getSpriteImage(int id)
 {
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
     if (m_isHdMod) {
         return getSpriteImageHd(id);
     }
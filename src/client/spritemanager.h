@@ -66,10 +66,12 @@ private:
     uint32 m_signature;
     int m_spritesCount;
     int m_spritesOffset;
-    int m_spriteSize;
+    int m_spriteSize = 32;
     FileStreamPtr m_spritesFile;
     std::vector<std::vector<uint8_t>> m_sprites;
     std::unordered_map<uint32, std::string> m_cachedData;
+    // sprites are also decoded by thing texture baking on worker threads
+    std::recursive_mutex m_mutex;
 };
 
 extern SpriteManager g_sprites;
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "thingtexturecache.h"
+#include "thingtype.h"
+
+ThingTextureCache g_thingTextureCache;
+
+thread_local ThingTextureUses* ThingTextureCache::t_uses = nullptr;
+
+void ThingTextureCache::insert(ThingTextureEntry& entry)
+{
+    if(entry.linked)
+        remove(entry);
+
+    entry.lastUsage = g_clock.millis();
+    pushFront(entry);
+    entry.linked = true;
+    m_usage += entry.bytes;
+    m_count++;
+    evict();
+}
+
+void ThingTextureCache::remove(ThingTextureEntry& entry)
+{
+    if(!entry.linked)
+        return;
+
+    unlink(entry);
+    entry.linked = false;
+    m_usage -= entry.bytes;
+    m_count--;
+}
+
+void ThingTextureCache::clear()
+{
+    while(m_tail)
+        m_tail->thingType->unloadTexture(m_tail->animationPhase);
+}
+
+void ThingTextureCache::evict()
+{
+    ticks_t now = g_clock.millis();
+    while(m_usage > m_budget && m_tail) {
+        if(m_tail->lastUsage + 1000 > now) // everything left is on screen
+            break;
+
+        m_evictions++;
+        m_evictedBytes += m_tail->bytes;
+        m_tail->thingType->unloadTexture(m_tail->animationPhase);
+    }
+}
+
+void ThingTextureCache::replay(ThingTextureUses& uses)
+{
+    // touches the used textures and bakes the missing ones, as if they were drawn by this thread
+    for(auto& use : uses)
+        use.first->getTexture(use.second);
+    uses.clear();
+}
+
+std::string ThingTextureCache::getStats(bool pretty)
+{
+    std::stringstream ret;
+    if(pretty) {
+        ret << "Textures: " << m_count << " (" << m_usage / 1024 / 1024 << "/" << m_budget / 1024 / 1024 << " MB)\n";
+        ret << "Hits: " << m_hits << " Misses: " << m_misses << " Prefetches: " << m_prefetches << "\n";
+        ret << "Evictions: " << m_evictions << " (" << m_evictedBytes / 1024 / 1024 << " MB)";
+    } else {
+        ret << m_count << "|" << m_usage << "|" << m_budget << "|" << m_hits << "|" << m_misses << "|"
+            << m_prefetches << "|" << m_evictions << "|" << m_evictedBytes;
+    }
+    return ret.str();
+}
+
+void ThingTextureCache::resetStats()
+{
+    m_hits = 0;
+    m_misses = 0;
+    m_prefetches = 0;
+    m_evictions = 0;
+    m_evictedBytes = 0;
+}
+
+void ThingTextureCache::pushFront(ThingTextureEntry& entry)
+{
+    entry.prev = nullptr;
+    entry.next = m_head;
+    if(m_head)
+        m_head->prev = &entry;
+    m_head = &entry;
+    if(!m_tail)
+        m_tail = &entry;
+}
+
+void ThingTextureCache::unlink(ThingTextureEntry& entry)
+{
+    if(entry.prev)
+        entry.prev->next = entry.next;
+    else
+        m_head = entry.next;
+    if(entry.next)
+        entry.next->prev = entry.prev;
+    else
+        m_tail = entry.prev;
+    entry.prev = entry.next = nullptr;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef THINGTEXTURECACHE_H
+#define THINGTEXTURECACHE_H
+
+#include "declarations.h"
+#include <framework/core/clock.h>
+
+// one baked animation phase of a thing type, linked into the cache while its texture is resident
+struct ThingTextureEntry {
+    ThingType* thingType = nullptr;
+    int animationPhase = 0;
+    uint64 bytes = 0;
+    ticks_t lastUsage = 0;
+    ThingTextureEntry* prev = nullptr;
+    ThingTextureEntry* next = nullptr;
+    bool linked = false;
+};
+
+// Textures used by a thread that draws the map outside of the dispatcher thread. The cache
+// isn't touched from there, the uses are replayed by the dispatcher once the thread is done.
+using ThingTextureUses = std::vector<std::pair<ThingType*, int>>;
+
+// Keeps thing textures under a memory budget. Entries are kept in least recently used order
+// and the oldest ones are unloaded when the budget is exceeded, except the ones drawn in the
+// last second. It is the only place texture usage is tracked, ThingTypeManager::check just
+// retries the eviction. Only used by the dispatcher thread.
+class ThingTextureCache
+{
+public:
+    void insert(ThingTextureEntry& entry);
+    void remove(ThingTextureEntry& entry);
+    void touch(ThingTextureEntry& entry) {
+        entry.lastUsage = g_clock.millis();
+        m_hits++;
+        if(m_head != &entry) {
+            unlink(entry);
+            pushFront(entry);
+        }
+    }
+    void clear();
+    void evict();
+
+    // while set, getTexture records into uses instead of touching the cache or baking
+    static void setThreadUses(ThingTextureUses* uses) { t_uses = uses; }
+    static ThingTextureUses* getThreadUses() { return t_uses; }
+    void replay(ThingTextureUses& uses);
+
+    void addMiss() { m_misses++; }
+    void addPrefetch() { m_prefetches++; }
+
+    void setBudget(uint64 bytes) { m_budget = bytes; evict(); }
+    uint64 getBudget() { return m_budget; }
+    uint64 getUsage() { return m_usage; }
+    bool isFull() { return m_usage >= m_budget; }
+
+    std::string getStats(bool pretty);
+    void resetStats();
+
+private:
+    static thread_local ThingTextureUses* t_uses;
+
+    void pushFront(ThingTextureEntry& entry);
+    void unlink(ThingTextureEntry& entry);
+
+    ThingTextureEntry* m_head = nullptr;
+    ThingTextureEntry* m_tail = nullptr;
+#ifdef ANDROID
+    uint64 m_budget = 96 * 1024 * 1024;
+#else
+    uint64 m_budget = 256 * 1024 * 1024;
+#endif
+    uint64 m_usage = 0;
+    uint32 m_count = 0;
+
+    uint64 m_hits = 0;
+    uint64 m_misses = 0;
+    uint64 m_prefetches = 0;
+    uint64 m_evictions = 0;
+    uint64 m_evictedBytes = 0;
+};
+
+extern ThingTextureCache g_thingTextureCache;
+
+#endif
@@ -32,6 +32,8 @@
 #include <framework/graphics/framebuffermanager.h>
 #include <framework/graphics/shadermanager.h>
 #include <framework/core/filestream.h>
+#include <framework/core/asyncdispatcher.h>
+#include <framework/core/eventdispatcher.h>
 #include <framework/otml/otml.h>
 
 ThingType::ThingType()
@@ -49,6 +51,12 @@ ThingType::ThingType()
     m_opacity = 1.0f;
 }
 
+ThingType::~ThingType()
+{
+    for(ThingTextureEntry& entry : m_texturesEntries)
+        g_thingTextureCache.remove(entry);
+}
+
 void ThingType::serialize(const FileStreamPtr& fin)
 {
     for(int i = 0; i < ThingLastAttr; ++i) {
@@ -393,8 +401,13 @@ void ThingType::unserialize(uint16 clientId, ThingCategory category, const FileS
     m_texturesFramesRects.resize(m_animationPhases);
     m_texturesFramesOriginRects.resize(m_animationPhases);
     m_texturesFramesOffsets.resize(m_animationPhases);
-
-    m_lastUsage = g_clock.seconds();
+    // entries dropped by a smaller resize must not stay linked
+    for(size_t animationPhase = m_animationPhases; animationPhase < m_texturesEntries.size(); ++animationPhase)
+        g_thingTextureCache.remove(m_texturesEntries[animationPhase]);
+    m_texturesEntries.resize(m_animationPhases);
+    m_texturesBaking.resize(m_animationPhases);
+    m_texturesFailures.resize(m_animationPhases);
+    m_texturesRetry.resize(m_animationPhases);
 }
 
 void ThingType::exportImage(std::string fileName)
@@ -492,34 +505,50 @@ void ThingType::unserializeOtml(const OTMLNodePtr& node)
 
 void ThingType::unload()
 {
+    for(ThingTextureEntry& entry : m_texturesEntries)
+        g_thingTextureCache.remove(entry);
+
     m_textures.clear();
     m_texturesFramesRects.clear();
     m_texturesFramesOriginRects.clear();
     m_texturesFramesOffsets.clear();
+    m_texturesBaking.clear();
 
     m_textures.resize(m_animationPhases);
     m_texturesFramesRects.resize(m_animationPhases);
     m_texturesFramesOriginRects.resize(m_animationPhases);
     m_texturesFramesOffsets.resize(m_animationPhases);
+    m_texturesBaking.resize(m_animationPhases);
+    m_texturesGeneration++; // bakes still running were requested before the unload
 
     m_loaded = false;
 }
 
-DrawQueueItem* ThingType::draw(const Point& dest, int layer, int xPattern, int yPattern, int zPattern, int animationPhase, Color color, LightView* lightView)
+void ThingType::unloadTexture(int animationPhase)
+{
+    g_thingTextureCache.remove(m_texturesEntries[animationPhase]);
+    m_textures[animationPhase] = nullptr;
+    m_texturesFramesRects[animationPhase].clear();
+    m_texturesFramesOriginRects[animationPhase].clear();
+    m_texturesFramesOffsets[animationPhase].clear();
+    m_loaded = std::any_of(m_textures.begin(), m_textures.end(), [](const TexturePtr& texture) { return texture != nullptr; });
+}
+
+void ThingType::draw(const Point& dest, int layer, int xPattern, int yPattern, int zPattern, int animationPhase, Color color, LightView* lightView)
 {
     if (m_null)
-        return nullptr;
+        return;
 
     if (animationPhase < 0 || animationPhase >= m_animationPhases)
-        return nullptr;
+        return;
 
     const TexturePtr& texture = getTexture(animationPhase); // texture might not exists, neither its rects.
     if (!texture)
-        return nullptr;
+        return;
 
     uint frameIndex = getTextureIndex(layer, xPattern, yPattern, zPattern);
     if (frameIndex >= m_texturesFramesRects[animationPhase].size())
-        return nullptr;
+        return;
 
     Point textureOffset = m_texturesFramesOffsets[animationPhase][frameIndex];
     Rect textureRect = m_texturesFramesRects[animationPhase][frameIndex];
@@ -533,24 +562,24 @@ DrawQueueItem* ThingType::draw(const Point& dest, int layer, int xPattern, int y
     if (lightView && hasLight())
         lightView->addLight(screenRect.center(), getLight());
 
-    return g_drawQueue->addTexturedRect(screenRect, texture, textureRect, color);
+    g_drawQueue->addTexturedRect(screenRect, texture, textureRect, color);
 }
 
-DrawQueueItem* ThingType::draw(const Rect& dest, int layer, int xPattern, int yPattern, int zPattern, int animationPhase, Color color)
+void ThingType::draw(const Rect& dest, int layer, int xPattern, int yPattern, int zPattern, int animationPhase, Color color)
 {
     if (m_null)
-        return nullptr;
+        return;
 
     if (animationPhase < 0 || animationPhase >= m_animationPhases)
-        return nullptr;
+        return;
 
     const TexturePtr& texture = getTexture(animationPhase); // texture might not exists, neither its rects.
     if (!texture)
-        return nullptr;
+        return;
 
     uint frameIndex = getTextureIndex(layer, xPattern, yPattern, zPattern);
     if (frameIndex >= m_texturesFramesRects[animationPhase].size())
-        return nullptr;
+        return;
 
     Point textureOffset = m_texturesFramesOffsets[animationPhase][frameIndex];
     Rect textureRect = m_texturesFramesRects[animationPhase][frameIndex];
@@ -561,7 +590,7 @@ DrawQueueItem* ThingType::draw(const Rect& dest, int layer, int xPattern, int yP
 
     Size size = m_size * g_sprites.spriteSize();
     if (!size.isValid())
-        return nullptr;
+        return;
 
     // size correction for some too big items
     if ((m_size.width() > 1 || m_size.height() > 1) &&
@@ -572,7 +601,7 @@ DrawQueueItem* ThingType::draw(const Rect& dest, int layer, int xPattern, int yP
     }
 
     float scale = std::min<float>((float)dest.width() / size.width(), (float)dest.height() / size.height());
-    return g_drawQueue->addTexturedRect(Rect(dest.topLeft() + (textureOffset * scale), textureRect.size() * scale), texture, textureRect, color);
+    g_drawQueue->addTexturedRect(Rect(dest.topLeft() + (textureOffset * scale), textureRect.size() * scale), texture, textureRect, color);
 }
 
 std::shared_ptr<DrawOutfitParams> ThingType::drawOutfit(const Point& dest, int maskLayer, int xPattern, int yPattern, int zPattern, int animationPhase, Color color, LightView* lightView)
@@ -742,87 +771,194 @@ bool ThingType::drawToImage(const Point& dest, int xPattern, int yPattern, int z
     return anythingDrawn;
 }
 
-const TexturePtr& ThingType::getTexture(int animationPhase)
+const TexturePtr& ThingType::getTexture(int animationPhase, bool allowAsync)
 {
-    m_lastUsage = g_clock.seconds();
+    if(ThingTextureUses* uses = ThingTextureCache::getThreadUses()) {
+        // drawn outside of the dispatcher thread, a missing texture is baked when the use is replayed
+        uses->emplace_back(this, animationPhase);
+        return m_textures[animationPhase];
+    }
 
-    int spriteSize = g_sprites.spriteSize();
     TexturePtr& animationPhaseTexture = m_textures[animationPhase];
-    if(!animationPhaseTexture) {
-        bool useCustomImage = false; 
+    if(animationPhaseTexture) {
+        g_thingTextureCache.touch(m_texturesEntries[animationPhase]);
+        return animationPhaseTexture;
+    }
+
+    g_thingTextureCache.addMiss();
+
+    // custom images are loaded through the resource manager, which is not used outside of the main thread
+    if(animationPhase == 0 && !m_customImage.empty())
+        allowAsync = false;
+
+    if(allowAsync && g_asyncDispatcher.getThreadCount() > 0) {
+        g_stats.addThingTextureMiss();
+        bakeTextureAsync(animationPhase);
+        return animationPhaseTexture;
+    }
+
+    bakeTextureSync(animationPhase);
+    return animationPhaseTexture;
+}
+
+void ThingType::prefetch()
+{
+    if(m_null || g_asyncDispatcher.getThreadCount() == 0)
+        return;
+
+    // baked textures enter the cache as just used, so they aren't evicted before they come into view
+    for(int animationPhase = 0; animationPhase < m_animationPhases; ++animationPhase) {
         if(animationPhase == 0 && !m_customImage.empty())
-            useCustomImage = true;
-
-        // we don't need layers in common items, they will be pre-drawn
-        int textureLayers = 1;
-        int numLayers = m_layers;
-        if(m_category == ThingCategoryCreature && numLayers >= 2) {
-            // otcv8 optimization from 5 to 2 layers
-            textureLayers = 2;
-            numLayers = 2;
+            continue;
+        if(!m_textures[animationPhase] && !m_texturesBaking[animationPhase]) {
+            g_thingTextureCache.addPrefetch();
+            bakeTextureAsync(animationPhase);
         }
+    }
+}
 
-        int indexSize = textureLayers * m_numPatternX * m_numPatternY * m_numPatternZ;
-        Size textureSize = getBestTextureDimension(m_size.width(), m_size.height(), indexSize);
-        ImagePtr fullImage;
+void ThingType::bakeTextureAsync(int animationPhase)
+{
+    if(m_texturesBaking[animationPhase] || m_texturesRetry[animationPhase] > g_clock.millis())
+        return;
 
-        if(useCustomImage)
-            fullImage = Image::load(m_customImage);
-        else
-            fullImage = std::make_shared<Image>(textureSize * spriteSize);
-
-        m_texturesFramesRects[animationPhase].resize(indexSize);
-        m_texturesFramesOriginRects[animationPhase].resize(indexSize);
-        m_texturesFramesOffsets[animationPhase].resize(indexSize);
-
-        for(int z = 0; z < m_numPatternZ; ++z) {
-            for(int y = 0; y < m_numPatternY; ++y) {
-                for(int x = 0; x < m_numPatternX; ++x) {
-                    for(int l = 0; l < numLayers; ++l) {
-                        bool spriteMask = (m_category == ThingCategoryCreature && l > 0);
-                        int frameIndex = getTextureIndex(l % textureLayers, x, y, z);
-                        Point framePos = Point(frameIndex % (textureSize.width() / m_size.width()) * m_size.width(),
-                                               frameIndex / (textureSize.width() / m_size.width()) * m_size.height()) * spriteSize;
-
-                        if (!useCustomImage) {
-                            for (int h = 0; h < m_size.height(); ++h) {
-                                for (int w = 0; w < m_size.width(); ++w) {
-                                    uint spriteIndex = getSpriteIndex(w, h, spriteMask ? 1 : l, x, y, z, animationPhase);
-                                    ImagePtr spriteImage = g_sprites.getSpriteImage(m_spritesIndex[spriteIndex]);
-                                    if (!spriteImage) {
-                                        continue;
-                                    }
-                                    Point spritePos = Point(m_size.width() - w - 1,
-                                                            m_size.height() - h - 1) * spriteSize;
-                                    fullImage->blit(framePos + spritePos, spriteImage);
+    m_texturesBaking[animationPhase] = true;
+    auto self = static_self_cast<ThingType>();
+    uint32 generation = m_texturesGeneration;
+    g_asyncDispatcher.dispatch([self, animationPhase, generation] {
+        ThingTextureDataPtr data;
+        try {
+            auto start = std::chrono::high_resolution_clock::now();
+            data = self->bakeTexture(animationPhase);
+            g_stats.addThingTextureBake(true, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count());
+        } catch(std::exception& e) {
+            g_logger.error(stdext::format("failed to bake texture of thing %d in background, baking it on the main thread: %s", self->m_id, e.what()));
+        }
+
+        g_dispatcher.addEvent([self, animationPhase, generation, data] {
+            if(generation != self->m_texturesGeneration)
+                return;
+            self->m_texturesBaking[animationPhase] = false;
+            if(self->m_textures[animationPhase])
+                return;
+            if(data)
+                self->applyTexture(animationPhase, *data);
+            else
+                self->bakeTextureSync(animationPhase);
+        });
+    });
+}
+
+void ThingType::bakeTextureSync(int animationPhase)
+{
+    // a thing that fails here too isn't retried before the backoff, so it doesn't fail every frame
+    ticks_t now = g_clock.millis();
+    if(m_texturesRetry[animationPhase] > now)
+        return;
+
+    try {
+        auto start = std::chrono::high_resolution_clock::now();
+        applyTexture(animationPhase, *bakeTexture(animationPhase));
+        g_stats.addThingTextureBake(false, std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count());
+        m_texturesFailures[animationPhase] = 0;
+    } catch(std::exception& e) {
+        int failures = std::min<int>(++m_texturesFailures[animationPhase], 6);
+        m_texturesRetry[animationPhase] = now + (1000 << failures);
+        g_logger.error(stdext::format("failed to bake texture of thing %d, retrying in %d s: %s", m_id, (1000 << failures) / 1000, e.what()));
+    }
+}
+
+ThingTextureDataPtr ThingType::bakeTexture(int animationPhase)
+{
+    int spriteSize = g_sprites.spriteSize();
+    bool useCustomImage = false;
+    if(animationPhase == 0 && !m_customImage.empty())
+        useCustomImage = true;
+
+    // we don't need layers in common items, they will be pre-drawn
+    int textureLayers = 1;
+    int numLayers = m_layers;
+    if(m_category == ThingCategoryCreature && numLayers >= 2) {
+        // otcv8 optimization from 5 to 2 layers
+        textureLayers = 2;
+        numLayers = 2;
+    }
+
+    int indexSize = textureLayers * m_numPatternX * m_numPatternY * m_numPatternZ;
+    Size textureSize = getBestTextureDimension(m_size.width(), m_size.height(), indexSize);
+
+    auto data = std::make_shared<ThingTextureData>();
+    ImagePtr& fullImage = data->image;
+    if(useCustomImage)
+        fullImage = Image::load(m_customImage);
+    else
+        fullImage = std::make_shared<Image>(textureSize * spriteSize);
+
+    data->framesRects.resize(indexSize);
+    data->framesOriginRects.resize(indexSize);
+    data->framesOffsets.resize(indexSize);
+
+    for(int z = 0; z < m_numPatternZ; ++z) {
+        for(int y = 0; y < m_numPatternY; ++y) {
+            for(int x = 0; x < m_numPatternX; ++x) {
+                for(int l = 0; l < numLayers; ++l) {
+                    bool spriteMask = (m_category == ThingCategoryCreature && l > 0);
+                    int frameIndex = getTextureIndex(l % textureLayers, x, y, z);
+                    Point framePos = Point(frameIndex % (textureSize.width() / m_size.width()) * m_size.width(),
+                                           frameIndex / (textureSize.width() / m_size.width()) * m_size.height()) * spriteSize;
+
+                    if (!useCustomImage) {
+                        for (int h = 0; h < m_size.height(); ++h) {
+                            for (int w = 0; w < m_size.width(); ++w) {
+                                uint spriteIndex = getSpriteIndex(w, h, spriteMask ? 1 : l, x, y, z, animationPhase);
+                                ImagePtr spriteImage = g_sprites.getSpriteImage(m_spritesIndex[spriteIndex]);
+                                if (!spriteImage) {
+                                    continue;
                                 }
+                                Point spritePos = Point(m_size.width() - w - 1,
+                                                        m_size.height() - h - 1) * spriteSize;
+                                fullImage->blit(framePos + spritePos, spriteImage);
                             }
                         }
+                    }
 
-                        Rect drawRect(framePos + Point(m_size.width(), m_size.height()) * spriteSize - Point(1,1), framePos);
-                        for(int x = framePos.x; x < framePos.x + m_size.width() * spriteSize; ++x) {
-                            for(int y = framePos.y; y < framePos.y + m_size.height() * spriteSize; ++y) {
-                                uint8 *p = fullImage->getPixel(x,y);
-                                if(p[3] != 0x00) {
-                                    drawRect.setTop   (std::min<int>(y, (int)drawRect.top()));
-                                    drawRect.setLeft  (std::min<int>(x, (int)drawRect.left()));
-                                    drawRect.setBottom(std::max<int>(y, (int)drawRect.bottom()));
-                                    drawRect.setRight (std::max<int>(x, (int)drawRect.right()));
-                                }
+                    Rect drawRect(framePos + Point(m_size.width(), m_size.height()) * spriteSize - Point(1,1), framePos);
+                    for(int x = framePos.x; x < framePos.x + m_size.width() * spriteSize; ++x) {
+                        for(int y = framePos.y; y < framePos.y + m_size.height() * spriteSize; ++y) {
+                            uint8 *p = fullImage->getPixel(x,y);
+                            if(p[3] != 0x00) {
+                                drawRect.setTop   (std::min<int>(y, (int)drawRect.top()));
+                                drawRect.setLeft  (std::min<int>(x, (int)drawRect.left()));
+                                drawRect.setBottom(std::max<int>(y, (int)drawRect.bottom()));
+                                drawRect.setRight (std::max<int>(x, (int)drawRect.right()));
                             }
                         }
-
-                        m_texturesFramesRects[animationPhase][frameIndex] = drawRect;
-                        m_texturesFramesOriginRects[animationPhase][frameIndex] = Rect(framePos, Size(m_size.width(), m_size.height()) * spriteSize);// *0.5;
-                        m_texturesFramesOffsets[animationPhase][frameIndex] = (drawRect.topLeft() - framePos);
                     }
+
+                    data->framesRects[frameIndex] = drawRect;
+                    data->framesOriginRects[frameIndex] = Rect(framePos, Size(m_size.width(), m_size.height()) * spriteSize);// *0.5;
+                    data->framesOffsets[frameIndex] = (drawRect.topLeft() - framePos);
                 }
             }
         }
-        animationPhaseTexture = std::make_shared<Texture>(fullImage, true, false, false);
-        m_loaded = true;
     }
-    return animationPhaseTexture;
+    return data;
+}
+
+void ThingType::applyTexture(int animationPhase, const ThingTextureData& data)
+{
+    m_texturesFramesRects[animationPhase] = data.framesRects;
+    m_texturesFramesOriginRects[animationPhase] = data.framesOriginRects;
+    m_texturesFramesOffsets[animationPhase] = data.framesOffsets;
+    // the image is uploaded by the render thread the first time the texture is drawn
+    m_textures[animationPhase] = std::make_shared<Texture>(data.image, true, false, false);
+    m_loaded = true;
+
+    ThingTextureEntry& entry = m_texturesEntries[animationPhase];
+    entry.thingType = this;
+    entry.animationPhase = animationPhase;
+    entry.bytes = data.image->getPixelCount() * data.image->getBpp();
+    g_thingTextureCache.insert(entry);
 }
 
 Size ThingType::getBestTextureDimension(int w, int h, int count)
@@ -883,7 +1019,7 @@ int ThingType::getExactSize(int layer, int xPattern, int yPattern, int zPattern,
     if(m_null)
         return 0;
 
-    getTexture(animationPhase); // we must calculate it anyway.
+    getTexture(animationPhase, false); // we must calculate it anyway.
     int frameIndex = getTextureIndex(layer, xPattern, yPattern, zPattern);
     Size size = m_texturesFramesOriginRects[animationPhase][frameIndex].size() - m_texturesFramesOffsets[animationPhase][frameIndex].toSize();
     return std::max<int>(size.width(), size.height());
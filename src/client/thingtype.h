@@ -25,6 +25,7 @@
 
 #include "declarations.h"
 #include "animator.h"
+#include "thingtexturecache.h"
 
 #include <framework/core/declarations.h>
 #include <framework/otml/declarations.h>
@@ -34,6 +35,8 @@
 #include <framework/luaengine/luaobject.h>
 #include <framework/net/server.h>
 
+#include <deque>
+
 enum NewDrawType : uint8 {
     NewDrawNormal = 0,
     NewDrawMount = 5,
@@ -166,21 +169,32 @@ struct DrawOutfitParams {
     Color color;
 };
 
+// sprite sheet of one animation phase, composed off the main thread
+struct ThingTextureData {
+    ImagePtr image;
+    std::vector<Rect> framesRects;
+    std::vector<Rect> framesOriginRects;
+    std::vector<Point> framesOffsets;
+};
+using ThingTextureDataPtr = std::shared_ptr<ThingTextureData>;
+
 class ThingType : public LuaObject
 {
 public:
     ThingType();
+    ~ThingType();
 
     void unserialize(uint16 clientId, ThingCategory category, const FileStreamPtr& fin);
     void unserializeOtml(const OTMLNodePtr& node);
     void unload();
+    void unloadTexture(int animationPhase);
 
     void serialize(const FileStreamPtr& fin);
     void exportImage(std::string fileName);
     void replaceSprites(std::map<uint32_t, ImagePtr>& replacements, std::string fileName);
 
-    DrawQueueItem* draw(const Point& dest, int layer, int xPattern, int yPattern, int zPattern, int animationPhase, Color color = Color::white, LightView* lightView = nullptr);
-    DrawQueueItem* draw(const Rect& dest, int layer, int xPattern, int yPattern, int zPattern, int animationPhase, Color color = Color::white);
+    void draw(const Point& dest, int layer, int xPattern, int yPattern, int zPattern, int animationPhase, Color color = Color::white, LightView* lightView = nullptr);
+    void draw(const Rect& dest, int layer, int xPattern, int yPattern, int zPattern, int animationPhase, Color color = Color::white);
     std::shared_ptr<DrawOutfitParams> drawOutfit(const Point& dest, int maskLayer, int xPattern, int yPattern, int zPattern, int animationPhase, Color color = Color::white, LightView* lightView = nullptr);
     Rect getDrawSize(const Point& dest, int layer, int xPattern, int yPattern, int zPattern, int animationPhase);
     void drawWithShader(const Point& dest, int layer, int xPattern, int yPattern, int zPattern, int animationPhase, const std::string& shader, Color color = Color::white, LightView* lightView = nullptr);
@@ -192,7 +206,7 @@ public:
     bool isNull() { return m_null; }
     bool hasAttr(ThingAttr attr) { return m_attribs.has(attr); }
     bool isLoaded() { return m_loaded; }
-    ticks_t getLastUsage() { return m_lastUsage; }
+    void prefetch();
 
     Size getSize() { return m_size; }
     int getWidth() { return m_size.width(); }
@@ -268,7 +282,14 @@ public:
     void setPathable(bool var);
 
 private:
-    const TexturePtr& getTexture(int animationPhase);
+    friend class ThingTextureCache;
+
+    // while an asynchronous bake is in progress the returned texture is null
+    const TexturePtr& getTexture(int animationPhase, bool allowAsync = true);
+    void bakeTextureAsync(int animationPhase);
+    void bakeTextureSync(int animationPhase);
+    ThingTextureDataPtr bakeTexture(int animationPhase);
+    void applyTexture(int animationPhase, const ThingTextureData& data);
     Size getBestTextureDimension(int w, int h, int count);
     uint getSpriteIndex(int w, int h, int l, int x, int y, int z, int a);
     uint getTextureIndex(int l, int x, int y, int z);
@@ -297,9 +318,13 @@ private:
     std::vector<std::vector<Rect>> m_texturesFramesRects;
     std::vector<std::vector<Rect>> m_texturesFramesOriginRects;
     std::vector<std::vector<Point>> m_texturesFramesOffsets;
+    std::deque<ThingTextureEntry> m_texturesEntries; // linked into the cache, growing a deque keeps them in place
+    std::vector<bool> m_texturesBaking;
+    std::vector<int> m_texturesFailures; // bakes failed in a row, they back off the next try
+    std::vector<ticks_t> m_texturesRetry;
+    uint32 m_texturesGeneration = 0;
 
     bool m_loaded = false;
-    time_t m_lastUsage;
 };
 
 struct DrawQueueItemThingWithShader : public DrawQueueItemTexturedRect {
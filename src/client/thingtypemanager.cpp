@@ -51,7 +51,6 @@ void ThingTypeManager::init()
     m_otbLoaded = false;
     for (int i = 0; i < ThingLastCategory; ++i) {
         m_thingTypes[i].resize(1, m_nullThingType);
-        m_checkIndex[i] = 0;
     }
     m_itemTypes.resize(1, m_nullItemType);
 
@@ -60,6 +59,7 @@ void ThingTypeManager::init()
 
 void ThingTypeManager::terminate()
 {
+    g_thingTextureCache.clear();
     for(int i = 0; i < ThingLastCategory; ++i)
         m_thingTypes[i].clear();
     m_itemTypes.clear();
@@ -75,21 +75,23 @@ void ThingTypeManager::terminate()
 }
 
 void ThingTypeManager::check()
-{    
-    // removes unused textures from memory after 60s, 500 checks / s
+{
+    // textures drawn in the last second are never evicted, retry when they weren't allowed to, 1 check / s
     m_checkEvent = g_dispatcher.scheduleEvent(std::bind(&ThingTypeManager::check, &g_things), 1000);
+    g_thingTextureCache.evict();
+}
 
-    for (size_t i = 0; i < ThingLastCategory; ++i) {
-        size_t limit = std::min<size_t>(m_checkIndex[i] + 100, m_thingTypes[i].size());
-        for (size_t j = m_checkIndex[i]; j < limit; ++j) {
-            if (m_thingTypes[i][j]->isLoaded() && m_thingTypes[i][j]->getLastUsage() + 60 < g_clock.seconds()) {
-                m_thingTypes[i][j]->unload();
-            }
-        }
-        m_checkIndex[i] = limit;
-        if (m_checkIndex[i] >= m_thingTypes[i].size()) {
-            m_checkIndex[i] = 0;
-        }
+void ThingTypeManager::prefetch(const ThingPtr& thing)
+{
+    // prefetching into a full budget would only evict textures that are still useful
+    if (!thing || g_thingTextureCache.isFull())
+        return;
+
+    thing->rawGetThingType()->prefetch();
+    if (thing->isCreature()) {
+        const Outfit outfit = thing->static_self_cast<Creature>()->getOutfit();
+        if (outfit.getMount() > 0 && isValidDatId(outfit.getMount(), ThingCategoryCreature))
+            rawGetThingType(outfit.getMount(), ThingCategoryCreature)->prefetch();
     }
 }
 
@@ -180,6 +182,7 @@ bool ThingTypeManager::loadDat(std::string file)
         m_datSignature = fin->getU32();
         m_contentRevision = static_cast<uint16_t>(m_datSignature);
 
+        g_thingTextureCache.clear();
         for(int category = 0; category < ThingLastCategory; ++category) {
             int count = fin->getU16() + 1;
             m_thingTypes[category].clear();
@@ -37,6 +37,13 @@ public:
     void terminate();
     void check();
 
+    void setTexturesMemoryBudget(uint64 bytes) { g_thingTextureCache.setBudget(bytes); }
+    uint64 getTexturesMemoryBudget() { return g_thingTextureCache.getBudget(); }
+    uint64 getTexturesMemoryUsage() { return g_thingTextureCache.getUsage(); }
+    std::string getTexturesStats(bool pretty) { return g_thingTextureCache.getStats(pretty); }
+    void resetTexturesStats() { g_thingTextureCache.resetStats(); }
+    void prefetch(const ThingPtr& thing);
+
     bool loadDat(std::string file);
     bool loadOtml(std::string file);
     void loadOtb(const std::string& file);
@@ -111,7 +118,6 @@ private:
     uint16 m_contentRevision;
 
     ScheduledEventPtr m_checkEvent;
-    size_t m_checkIndex[ThingLastCategory];
 };
 
 extern ThingTypeManager g_things;
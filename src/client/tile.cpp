@@ -851,6 +851,17 @@ bool Tile::hasCreature()
     return false;
 }
 
+bool Tile::hasCreatureWithWidgets()
+{
+    for(const CreaturePtr& creature : m_walkingCreatures)
+        if(creature->hasWidgets())
+            return true;
+    for(const ThingPtr& thing : m_things)
+        if(thing->isCreature() && thing->static_self_cast<Creature>()->hasWidgets())
+            return true;
+    return false;
+}
+
 bool Tile::hasBlockingCreature()
 {
     for (const ThingPtr& thing : m_things)
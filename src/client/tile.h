@@ -122,6 +122,7 @@ public:
     bool mustHookSouth();
     bool mustHookEast();
     bool hasCreature();
+    bool hasCreatureWithWidgets();
     bool hasBlockingCreature();
     bool limitsFloorsView(bool isFreeView = false);
     bool canErase();
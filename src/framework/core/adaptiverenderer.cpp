@@ -7,85 +7,182 @@
 
 AdaptiveRenderer g_adaptiveRenderer;
 
-void AdaptiveRenderer::newFrame() {
-    auto now = stdext::millis();
-    m_frames.push_back(now);
-    while (m_frames.front() + 5000 < now) {
-        m_frames.pop_front();
-    }
+static const char* stageNames[ADAPTIVE_STAGE_LAST] = { "Map", "Texts", "UI", "Light", "GPU" };
 
+static bool isDispatcherStage(int stage) {
+    return stage <= ADAPTIVE_STAGE_UI;
+}
+
+void AdaptiveRenderer::newFrame() {
     if (m_forcedSpeed >= 0 && m_forcedSpeed <= 4) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& level : m_levels)
+            level = m_forcedSpeed;
         m_speed = m_forcedSpeed;
+        m_degraded.clear();
+        m_forced = true;
         return;
     }
 
-    if (m_update + 5000 > now)
+    auto now = stdext::millis();
+    if (m_update + 1000 > now)
         return;
 
-    m_update = stdext::millis();
-
-    if (m_speed < 1)
-        m_speed = 1;
+    m_update = now;
 
-    int maxFps = std::min<int>(100, std::max<int>(10, g_app.getMaxFps() < 10 ? 100 : g_app.getMaxFps()));
-    if (m_speed >= 2 && maxFps > 60) { // fix for forced vsync
-        maxFps = 60;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_forced) {
+        m_forced = false;
+        for (auto& level : m_levels)
+            level = 1;
     }
 
-    if (m_frames.size() < maxFps * (4.0f - m_speed * 0.3f) && m_speed != RenderSpeeds - 1) {
-        m_speed += 1;
+    // in the automatic mode the lowest level is 1, as it always was
+    for (auto& level : m_levels) {
+        if (level < 1)
+            level = 1;
     }
-    if (m_frames.size() > maxFps * (4.5f - m_speed * 0.1f) && m_speed > 1) {
-        m_speed -= 1;
+
+    int maxFps = std::min<int>(60, std::max<int>(10, g_app.getMaxFps() < 10 ? 60 : g_app.getMaxFps()));
+    float budget = 1000000.f / maxFps;
+    float dispatcherCost = m_costs[ADAPTIVE_STAGE_MAP] + m_costs[ADAPTIVE_STAGE_TEXTS] + m_costs[ADAPTIVE_STAGE_UI];
+    float renderCost = m_costs[ADAPTIVE_STAGE_LIGHT] + m_costs[ADAPTIVE_STAGE_GPU];
+    float cost = std::max(dispatcherCost, renderCost);
+
+    if (cost > budget) {
+        // the most expensive stage of the slower thread which can still be degraded
+        bool dispatcher = dispatcherCost >= renderCost;
+        int worst = ADAPTIVE_STAGE_LAST;
+        for (int stage = 0; stage < ADAPTIVE_STAGE_LAST; ++stage) {
+            if (isDispatcherStage(stage) != dispatcher || m_levels[stage] >= RenderSpeeds - 1)
+                continue;
+            if (worst == ADAPTIVE_STAGE_LAST || m_costs[stage] > m_costs[worst])
+                worst = stage;
+        }
+        if (worst != ADAPTIVE_STAGE_LAST) {
+            m_degraded.push_back(DegradedStage{ (AdaptiveStage)worst, m_costs[worst] });
+            setLevel((AdaptiveStage)worst, m_levels[worst] + 1,
+                     stdext::format("%s %.1f ms over %.1f ms budget", dispatcher ? "main" : "render", cost / 1000.f, budget / 1000.f));
+            m_update = now + 1000; // let the costs settle
+        }
+    } else if (!m_degraded.empty()) {
+        // restored only if the frame still fits with the cost the stage had before it was degraded
+        DegradedStage& degraded = m_degraded.back();
+        float threadCost = isDispatcherStage(degraded.stage) ? dispatcherCost : renderCost;
+        float restoredCost = threadCost - m_costs[degraded.stage] + degraded.cost;
+        if (cost < budget * 0.5f && restoredCost < budget * 0.8f) {
+            AdaptiveStage stage = degraded.stage;
+            m_degraded.pop_back();
+            setLevel(stage, m_levels[stage] - 1,
+                     stdext::format("%.1f ms expected within %.1f ms budget", restoredCost / 1000.f, budget / 1000.f));
+            m_update = now + 4000; // slower than degrading, so it doesn't swing
+        }
     }
+
+    int speed = 0;
+    for (auto& level : m_levels)
+        speed = std::max<int>(speed, level);
+    m_speed = speed;
 }
 
 void AdaptiveRenderer::refresh() {
     m_update = stdext::millis();
 }
 
+void AdaptiveRenderer::addStageTime(AdaptiveStage stage, ticks_t micros) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (stage == ADAPTIVE_STAGE_LIGHT) {
+        m_lightTime += micros;
+    } else if (stage == ADAPTIVE_STAGE_GPU) {
+        // the whole render frame is reported, the light map was updated during it
+        micros = std::max<ticks_t>(0, micros - m_lightTime);
+        m_costs[ADAPTIVE_STAGE_LIGHT] = m_costs[ADAPTIVE_STAGE_LIGHT] * 0.9f + m_lightTime * 0.1f;
+        m_lightTime = 0;
+    }
+    if (stage != ADAPTIVE_STAGE_LIGHT)
+        m_costs[stage] = m_costs[stage] * 0.9f + micros * 0.1f;
+}
+
+void AdaptiveRenderer::setLevel(AdaptiveStage stage, int level, const std::string& reason) {
+    m_decisions.push_back(stdext::format("%s %d -> %d: %s", stageNames[stage], m_levels[stage].load(), level, reason));
+    if (m_decisions.size() > 10)
+        m_decisions.pop_front();
+    m_levels[stage] = level;
+}
+
 int AdaptiveRenderer::effetsLimit() {
     static int limits[RenderSpeeds] = { 20, 10, 7, 4, 2 };
-    return limits[m_speed];
+    return limits[std::max<int>(m_levels[ADAPTIVE_STAGE_MAP], m_levels[ADAPTIVE_STAGE_GPU])];
 }
 
 int AdaptiveRenderer::creaturesLimit() {
     static int limits[RenderSpeeds] = { 20, 10, 7, 5, 3 };
-    return limits[m_speed];
+    return limits[std::max<int>(m_levels[ADAPTIVE_STAGE_MAP], m_levels[ADAPTIVE_STAGE_GPU])];
 }
 
 int AdaptiveRenderer::itemsLimit() {
     static int limits[RenderSpeeds] = { 20, 10, 7, 5, 3 };
-    return limits[m_speed];
+    return limits[std::max<int>(m_levels[ADAPTIVE_STAGE_MAP], m_levels[ADAPTIVE_STAGE_GPU])];
 }
 
 int AdaptiveRenderer::mapRenderInterval() {
     static int limits[RenderSpeeds] = { 0, 10, 20, 50, 100 };
-    return limits[m_speed];
+    return limits[m_levels[ADAPTIVE_STAGE_MAP]];
 }
 
 int AdaptiveRenderer::textsLimit() {
     static int limits[RenderSpeeds] = { 1000, 50, 30, 15, 5 };
-    return limits[m_speed];
+    return limits[m_levels[ADAPTIVE_STAGE_TEXTS]];
 }
 
 int AdaptiveRenderer::creaturesRenderInterval() {
     // not working yet
     static int limits[RenderSpeeds] = { 0, 0, 10, 15, 20 };
-    return limits[m_speed];
+    return limits[m_levels[ADAPTIVE_STAGE_MAP]];
+}
+
+int AdaptiveRenderer::lightUpdateInterval() {
+    static int limits[RenderSpeeds] = { 0, 0, 50, 100, 200 };
+    return limits[m_levels[ADAPTIVE_STAGE_LIGHT]];
 }
 
 bool AdaptiveRenderer::allowFading() {
-    return m_speed <= 2;
+    return std::max<int>(m_levels[ADAPTIVE_STAGE_MAP], m_levels[ADAPTIVE_STAGE_GPU]) <= 2;
 }
 
 int AdaptiveRenderer::foregroundUpdateInterval() {
-    static int limits[RenderSpeeds] = { 0, 20, 40, 50, 60 };
-    return limits[m_speed];
+    // level 1 is the lowest of the automatic mode, the ui is only throttled once it was degraded
+    static int limits[RenderSpeeds] = { 0, 0, 20, 40, 60 };
+    return limits[m_levels[ADAPTIVE_STAGE_UI]];
+}
+
+int AdaptiveRenderer::getStageLevel(int stage) {
+    if (stage < 0 || stage >= ADAPTIVE_STAGE_LAST)
+        return 0;
+    return m_levels[stage];
+}
+
+int AdaptiveRenderer::getStageCost(int stage) {
+    if (stage < 0 || stage >= ADAPTIVE_STAGE_LAST)
+        return 0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (int)m_costs[stage];
+}
+
+std::vector<std::string> AdaptiveRenderer::getDecisions() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::vector<std::string>(m_decisions.begin(), m_decisions.end());
 }
 
 std::string AdaptiveRenderer::getDebugInfo() {
+    std::lock_guard<std::mutex> lock(m_mutex);
     std::stringstream ss;
-    ss << "Frames: " << m_frames.size() << "|" << m_speed << "|" << m_forcedSpeed;
+    ss << std::fixed << std::setprecision(1);
+    for (int stage = 0; stage < ADAPTIVE_STAGE_LAST; ++stage)
+        ss << (stage > 0 ? " " : "") << stageNames[stage] << ": " << m_costs[stage] / 1000.f << "ms (" << m_levels[stage] << ")";
+    if (m_forcedSpeed >= 0)
+        ss << "\nForced: " << m_forcedSpeed;
+    if (!m_decisions.empty())
+        ss << "\n" << m_decisions.back();
     return ss.str();
-}
\ No newline at end of file
+}
@@ -1,16 +1,37 @@
 #ifndef ADAPTIVERENDERER_H
 #define ADAPTIVERENDERER_H
 
-#include <list>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <framework/global.h>
 
 constexpr int RenderSpeeds = 5;
 
+// parts of a frame with their own cost and their own level, each level only degrades its own stage
+enum AdaptiveStage : uint8 {
+    ADAPTIVE_STAGE_MAP = 0, // map background built by the dispatcher, tiles, creatures and effects
+    ADAPTIVE_STAGE_TEXTS, // map foreground built by the dispatcher, names, bars and texts
+    ADAPTIVE_STAGE_UI, // foreground pane built by the dispatcher
+    ADAPTIVE_STAGE_LIGHT, // light map updated by the render thread
+    ADAPTIVE_STAGE_GPU, // the rest of the render thread frame, draw calls submitted to the driver
+    ADAPTIVE_STAGE_LAST
+};
+
+// Degrades the most expensive stage of the thread that misses the frame budget first and restores
+// the stages in the reverse order once both threads are well below the budget.
 class AdaptiveRenderer {
 public:
     void newFrame();
 
     void refresh();
 
+    // thread safe, time spent by a stage in one frame
+    void addStageTime(AdaptiveStage stage, ticks_t micros);
+
     int effetsLimit();
 
     int creaturesLimit();
@@ -23,6 +44,7 @@ public:
 
     int creaturesRenderInterval();
 
+    int lightUpdateInterval();
 
     bool allowFading();
 
@@ -30,6 +52,11 @@ public:
         return m_speed;
     }
 
+    int getStageLevel(int stage);
+    // average time of the stage in a frame, in microseconds
+    int getStageCost(int stage);
+    std::vector<std::string> getDecisions();
+
     int foregroundUpdateInterval();
 
     std::string getDebugInfo();
@@ -39,12 +66,26 @@ public:
     }
 
 private:
+    void setLevel(AdaptiveStage stage, int level, const std::string& reason);
+
+    struct DegradedStage {
+        AdaptiveStage stage;
+        float cost; // before it was degraded
+    };
+
     int m_forcedSpeed = -1;
-    int m_speed = 0;
-    time_t m_update = 0;
-    std::list<time_t> m_frames;
+    bool m_forced = false;
+    std::atomic<int> m_speed{0};
+    std::array<std::atomic<int>, ADAPTIVE_STAGE_LAST> m_levels = {};
+    ticks_t m_update = 0;
+
+    std::mutex m_mutex;
+    std::array<float, ADAPTIVE_STAGE_LAST> m_costs = {};
+    ticks_t m_lightTime = 0; // light time of the render frame in progress, it isn't counted as gpu time
+    std::vector<DegradedStage> m_degraded; // in the order they were degraded
+    std::deque<std::string> m_decisions;
 };
 
 extern AdaptiveRenderer g_adaptiveRenderer;
 
-#endif
\ No newline at end of file
+#endif
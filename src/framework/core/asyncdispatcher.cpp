@@ -26,7 +26,12 @@ AsyncDispatcher g_asyncDispatcher;
 
 void AsyncDispatcher::init()
 {
-    spawn_thread();
+    // one pool for every background job: path searches, thing texture bakes, floor draw queues,
+    // sound streams and screenshots. It leaves one core for the dispatcher and one for the render thread,
+    // a single thread was enough only while its jobs were rare file reads and writes
+    int threads = std::max<int>(1, std::min<int>(4, (int)std::thread::hardware_concurrency() - 2));
+    for(int i = 0; i < threads; ++i)
+        spawn_thread();
 }
 
 void AsyncDispatcher::terminate()
@@ -34,6 +34,8 @@ public:
     void spawn_thread();
     void stop();
 
+    size_t getThreadCount() { return m_threads.size(); }
+
     template<class F>
     std::shared_future<typename std::invoke_result<F>::type> schedule(const F& task) {
         std::lock_guard<std::mutex> lock(m_mutex);
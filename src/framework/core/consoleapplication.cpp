@@ -24,6 +24,7 @@
 #include "consoleapplication.h"
 #include <framework/core/clock.h>
 #include <framework/luaengine/luainterface.h>
+#include <framework/util/stats.h>
 
 #ifdef FW_NET
 #include <framework/net/connection.h>
@@ -45,6 +46,7 @@ void ConsoleApplication::run()
 
     while(!m_stopping) {
         poll();
+        g_stats.collect();
         stdext::millisleep(1);
         g_clock.update();
         m_frameCounter.update();
@@ -33,7 +33,7 @@ public:
     virtual ~Event();
 
     virtual void execute();
-    void cancel();
+    virtual void cancel();
 
     bool isCanceled() { return m_canceled; }
     bool isExecuted() { return m_executed; }
@@ -42,6 +42,11 @@ public:
     const std::string& getFunction() { return m_function; }
 
 protected:
+    // link of the posted events list of a dispatcher, the list owns the event through m_postedSelf
+    friend class EventDispatcher;
+    Event* m_postedNext = nullptr;
+    std::shared_ptr<Event> m_postedSelf;
+
     std::string m_function;
     std::function<void()> m_callback;
     bool m_canceled;
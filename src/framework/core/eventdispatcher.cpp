@@ -36,31 +36,33 @@ std::thread::id g_dispatcherThreadId = std::this_thread::get_id();
 
 void EventDispatcher::shutdown()
 {
-    while(!m_eventList.empty())
+    while(hasEvents())
         poll();
 
-    while(!m_scheduledEventList.empty()) {
-        ScheduledEventPtr scheduledEvent = m_scheduledEventList.top();
-        scheduledEvent->cancel();
-        m_scheduledEventList.pop();
+    std::vector<ScheduledEventPtr> scheduledEvents;
+    {
+        std::lock_guard<std::recursive_mutex> lock(m_mutex);
+        m_scheduledEvents.clear(scheduledEvents);
     }
+    for(auto& scheduledEvent : scheduledEvents)
+        scheduledEvent->cancel();
     m_disabled = true;
 }
 
 void EventDispatcher::poll()
 {
-    AutoStat s(this == &g_dispatcher ? STATS_MAIN : STATS_RENDER, "PollDispatcher");
+    AutoStat s(this == &g_dispatcher ? STATS_ZONE(STATS_MAIN, "PollDispatcher") : STATS_ZONE(STATS_RENDER, "PollDispatcher"));
     std::unique_lock<std::recursive_mutex> lock(m_mutex);
 
     int events = 0;
     int loops = 0;
-    for(int count = 0, max = m_scheduledEventList.size(); count < max && !m_scheduledEventList.empty(); ++count) {
-        ScheduledEventPtr scheduledEvent = m_scheduledEventList.top();
-        if(scheduledEvent->remainingTicks() > 0)
-            break;
-        m_scheduledEventList.pop();
+    // events polled inside of an event get their own list
+    std::vector<ScheduledEventPtr> dueEvents;
+    dueEvents.swap(m_dueEvents);
+    m_scheduledEvents.poll(g_clock.millis(), dueEvents);
+    for(auto& scheduledEvent : dueEvents) {
         {
-            AutoStat s2(STATS_DISPATCHER, scheduledEvent->getFunction());
+            AutoStat s2(g_stats.getZone(STATS_DISPATCHER, scheduledEvent->getFunction()));
             m_botSafe = scheduledEvent->isBotSafe();
             lock.unlock();
             scheduledEvent->execute();
@@ -69,11 +71,19 @@ void EventDispatcher::poll()
         }
 
         if(scheduledEvent->nextCycle())
-            m_scheduledEventList.push(scheduledEvent);
+            m_scheduledEvents.add(scheduledEvent);
     }
+    dueEvents.clear();
+    if(m_dueEvents.capacity() < dueEvents.capacity())
+        m_dueEvents.swap(dueEvents);
+
+    // the event list is only used by this thread, events from other threads are posted without locking
+    lock.unlock();
 
     // execute events list until all events are out, this is needed because some events can schedule new events that would
     // change the UIWidgets layout, in this case we must execute these new events before we continue rendering,
+    takePosted(m_postedFront, true);
+    takePosted(m_posted, false);
     m_pollEventsSize = m_eventList.size();
     loops = 0;
     while(m_pollEventsSize > 0) {
@@ -93,17 +103,19 @@ void EventDispatcher::poll()
         }
 
         for(int i=0;i<m_pollEventsSize;++i) {
-            EventPtr event = m_eventList.front();
+            EventPtr event = std::move(m_eventList.front());
             m_eventList.pop_front();
             {
-                AutoStat s2(STATS_DISPATCHER, event->getFunction());
+                AutoStat s2(g_stats.getZone(STATS_DISPATCHER, event->getFunction()));
                 m_botSafe = event->isBotSafe();
-                lock.unlock();
                 event->execute();
                 events += 1;
-                lock.lock();
             }
+            // front pushing is a way to execute an event before others, the poll event list only grows with them
+            if(m_postedFront.load(std::memory_order_relaxed))
+                m_pollEventsSize += takePosted(m_postedFront, true);
         }
+        takePosted(m_posted, false);
         m_pollEventsSize = m_eventList.size();
         
         loops++;
@@ -117,45 +129,87 @@ void EventDispatcher::poll()
 ScheduledEventPtr EventDispatcher::scheduleEventEx(const std::string& function, const std::function<void()>& callback, int delay)
 {
     if(m_disabled)
-        return std::make_shared<ScheduledEvent>("", nullptr, delay, 1);
+        return ScheduledEvent::create("", nullptr, delay, 1);
 
     std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     VALIDATE(delay >= 0);
-    auto scheduledEvent = std::make_shared<ScheduledEvent>(function, callback, delay, 1, g_app.isOnInputEvent());
-    m_scheduledEventList.push(scheduledEvent);
+    auto scheduledEvent = ScheduledEvent::create(function, callback, delay, 1, g_app.isOnInputEvent());
+    scheduledEvent->setDispatcher(this);
+    m_scheduledEvents.add(scheduledEvent);
     return scheduledEvent;
 }
 
 ScheduledEventPtr EventDispatcher::cycleEventEx(const std::string& function, const std::function<void()>& callback, int delay)
 {
     if(m_disabled)
-        return std::make_shared<ScheduledEvent>("", nullptr, delay, 0);
+        return ScheduledEvent::create("", nullptr, delay, 0);
 
     std::lock_guard<std::recursive_mutex> lock(m_mutex);
 
     VALIDATE(delay > 0);
-    auto scheduledEvent = std::make_shared<ScheduledEvent>(function, callback, delay, 0, g_app.isOnInputEvent());
-    m_scheduledEventList.push(scheduledEvent);
+    auto scheduledEvent = ScheduledEvent::create(function, callback, delay, 0, g_app.isOnInputEvent());
+    scheduledEvent->setDispatcher(this);
+    m_scheduledEvents.add(scheduledEvent);
     return scheduledEvent;
 }
 
+void EventDispatcher::unschedule(ScheduledEvent* event)
+{
+    std::lock_guard<std::recursive_mutex> lock(m_mutex);
+    m_scheduledEvents.remove(event);
+}
+
 EventPtr EventDispatcher::addEventEx(const std::string& function, const std::function<void()>& callback, bool pushFront)
 {
     if(m_disabled)
         return std::make_shared<Event>("", nullptr);
 
     auto event = std::make_shared<Event>(function, callback, g_app.isOnInputEvent());
-
-    std::lock_guard<std::recursive_mutex> lock(m_mutex);
-
-    // front pushing is a way to execute an event before others
-    if(pushFront) {
-        m_eventList.push_front(event);
-        // the poll event list only grows when pushing into front
-        m_pollEventsSize++;
-    } else
-        m_eventList.push_back(event);
+    post(event, pushFront);
     return event;
 }
 
+void EventDispatcher::post(const EventPtr& event, bool pushFront)
+{
+    std::atomic<Event*>& posted = pushFront ? m_postedFront : m_posted;
+    Event* ptr = event.get();
+    ptr->m_postedSelf = event;
+
+    uint32_t retries = 0;
+    ptr->m_postedNext = posted.load(std::memory_order_relaxed);
+    while(!posted.compare_exchange_weak(ptr->m_postedNext, ptr, std::memory_order_release, std::memory_order_relaxed))
+        retries++;
+    g_stats.addEventPost(retries);
+}
+
+int EventDispatcher::takePosted(std::atomic<Event*>& posted, bool pushFront)
+{
+    // the whole list is taken at once, so there is no ABA problem with many producers and one consumer
+    Event* event = posted.exchange(nullptr, std::memory_order_acquire);
+    if(!event)
+        return 0;
+
+    // posted lists are newest first
+    Event* oldest = nullptr;
+    while(event) {
+        Event* next = event->m_postedNext;
+        event->m_postedNext = oldest;
+        oldest = event;
+        event = next;
+    }
+
+    // events pushed into front run before the ones pushed into front before them
+    int count = 0;
+    for(event = oldest; event; count++) {
+        Event* next = event->m_postedNext;
+        event->m_postedNext = nullptr;
+        if(pushFront)
+            m_eventList.push_front(std::move(event->m_postedSelf));
+        else
+            m_eventList.push_back(std::move(event->m_postedSelf));
+        event = next;
+    }
+    g_stats.addEventBatch(count);
+    return count;
+}
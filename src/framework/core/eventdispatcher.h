@@ -25,8 +25,7 @@
 
 #include "clock.h"
 #include "scheduledevent.h"
-
-#include <queue>
+#include "timerwheel.h"
 
 // @bindsingleton g_dispatcher
 class EventDispatcher
@@ -41,13 +40,25 @@ public:
 
     bool isBotSafe() { return m_botSafe; }
 
+    // called when a scheduled event is canceled, it's released right away instead of when it was due
+    void unschedule(ScheduledEvent* event);
+
 private:
-    std::list<EventPtr> m_eventList;
+    // lock-free, events are posted from any thread and taken by the thread polling the dispatcher
+    void post(const EventPtr& event, bool pushFront);
+    // moves the posted events into the event list, returns how many
+    int takePosted(std::atomic<Event*>& posted, bool pushFront);
+    bool hasEvents() { return !m_eventList.empty() || m_posted.load() || m_postedFront.load(); }
+
+    std::atomic<Event*> m_posted{nullptr}; // newest first
+    std::atomic<Event*> m_postedFront{nullptr};
+    std::deque<EventPtr> m_eventList; // only used by the polling thread
     int m_pollEventsSize;
     bool m_disabled = false;
     bool m_botSafe = false;
     std::recursive_mutex m_mutex;
-    std::priority_queue<ScheduledEventPtr, std::vector<ScheduledEventPtr>, lessScheduledEvent> m_scheduledEventList;
+    TimerWheel m_scheduledEvents;
+    std::vector<ScheduledEventPtr> m_dueEvents; // kept to reuse the memory
 };
 
 extern EventDispatcher g_dispatcher;
@@ -149,7 +149,9 @@ void GraphicalApplication::run()
     std::mutex mutex;
     std::thread worker([&] {
         g_dispatcherThreadId = std::this_thread::get_id();
+        ticks_t lastForegroundUpdate = 0;
         while (!m_stopping) {
+            ticks_t frameStart = stdext::micros();
             m_processingFrames.addFrame();
             {
                 g_clock.update();
@@ -158,47 +160,58 @@ void GraphicalApplication::run()
             }
 
             mutex.lock();
-            if (drawQueue && drawMapQueue && m_maxFps > 0) { // old drawQueue not processed yet
+            if (drawMapQueue && m_maxFps > 0) { // old drawQueue not processed yet
                 mutex.unlock();
-                AutoStat s(STATS_MAIN, "Sleep");
+                AutoStat s(STATS_ZONE(STATS_MAIN, "Sleep"));
                 stdext::millisleep(1);
                 continue;
             }
             mutex.unlock();
 
             ticks_t renderStart = stdext::millis();
+            ticks_t stageStart = stdext::micros();
             {
-                AutoStat s(STATS_MAIN, "DrawMapBackground");
-                g_drawQueue = std::make_shared<DrawQueue>();
+                AutoStat s(STATS_ZONE(STATS_MAIN, "DrawMapBackground"));
+                g_drawQueue = DrawQueue::create();
                 g_ui.render(Fw::MapBackgroundPane);
             }
             std::shared_ptr<DrawQueue> mapBackgroundQueue = g_drawQueue;
+            g_adaptiveRenderer.addStageTime(ADAPTIVE_STAGE_MAP, stdext::micros() - stageStart);
+            stageStart = stdext::micros();
             {
-                AutoStat s(STATS_MAIN, "DrawMapForeground");
-                g_drawQueue = std::make_shared<DrawQueue>();
+                AutoStat s(STATS_ZONE(STATS_MAIN, "DrawMapForeground"));
+                g_drawQueue = DrawQueue::create();
                 g_ui.render(Fw::MapForegroundPane);
             }
+            g_adaptiveRenderer.addStageTime(ADAPTIVE_STAGE_TEXTS, stdext::micros() - stageStart);
 
             mutex.lock();
             drawMapQueue = mapBackgroundQueue;
             drawMapForegroundQueue = g_drawQueue;
             mutex.unlock();
 
-            {
-                AutoStat s(STATS_MAIN, "DrawForeground");
-                g_drawQueue = std::make_shared<DrawQueue>();
-                g_ui.render(Fw::ForegroundPane);
-            }
+            // the render thread keeps drawing the last foreground until a new one is ready
+            if (stdext::millis() >= lastForegroundUpdate + g_adaptiveRenderer.foregroundUpdateInterval() || m_mustRepaint) {
+                lastForegroundUpdate = stdext::millis();
+                stageStart = stdext::micros();
+                {
+                    AutoStat s(STATS_ZONE(STATS_MAIN, "DrawForeground"));
+                    g_drawQueue = DrawQueue::create();
+                    g_ui.render(Fw::ForegroundPane);
+                }
+                g_adaptiveRenderer.addStageTime(ADAPTIVE_STAGE_UI, stdext::micros() - stageStart);
 
-            mutex.lock();
-            drawQueue = g_drawQueue;
+                mutex.lock();
+                drawQueue = g_drawQueue;
+                mutex.unlock();
+            }
             g_drawQueue = nullptr;
-            mutex.unlock();
 
             g_graphs[GRAPH_CPU_FRAME_TIME].addValue(stdext::millis() - renderStart);
+            g_stats.addFrameTime(STATS_MAIN, stdext::micros() - frameStart);
 
             if (m_maxFps > 0 || g_window.hasVerticalSync()) {
-                AutoStat s(STATS_MAIN, "Sleep");
+                AutoStat s(STATS_ZONE(STATS_MAIN, "Sleep"));
                 stdext::millisleep(1);
             }
         }
@@ -215,7 +228,7 @@ void GraphicalApplication::run()
         pollGraphics();
 
         if (!g_window.isVisible()) {
-            AutoStat s(STATS_RENDER, "Sleep");
+            AutoStat s(STATS_ZONE(STATS_RENDER, "Sleep"));
             stdext::millisleep(1);
             g_adaptiveRenderer.refresh();
             continue;
@@ -223,7 +236,7 @@ void GraphicalApplication::run()
 
         int frameDelay = m_maxFps <= 0 ? 0 : (1000000 / m_maxFps);
         if (lastRender + frameDelay > stdext::micros() && !m_mustRepaint) {
-            AutoStat s(STATS_RENDER, "Sleep");
+            AutoStat s(STATS_ZONE(STATS_RENDER, "Sleep"));
             stdext::millisleep(1);
             continue;
         }
@@ -233,7 +246,7 @@ void GraphicalApplication::run()
             ((!drawMapQueue || !drawMapForegroundQueue) && isOnline) || 
             (m_mustRepaint && !drawQueue)) {
             mutex.unlock();
-            AutoStat s(STATS_RENDER, "Wait");
+            AutoStat s(STATS_ZONE(STATS_RENDER, "Wait"));
             stdext::millisleep(1);
             continue;
         }
@@ -243,21 +256,23 @@ void GraphicalApplication::run()
         drawQueue = drawMapQueue = drawMapForegroundQueue = nullptr;
         mutex.unlock();
 
+        ticks_t frameStart = stdext::micros();
         g_adaptiveRenderer.newFrame();
         m_graphicsFrames.addFrame();
         m_mustRepaint = false;
         lastRender = stdext::micros() > lastRender + frameDelay * 2 ? stdext::micros() : lastRender + frameDelay;
 
         g_painter->resetDraws();
+        g_atlas.newFrame();
         if (m_scaling > 1.0f) {
-            AutoStat s(STATS_RENDER, "SetupScaling");
+            AutoStat s(STATS_ZONE(STATS_RENDER, "SetupScaling"));
             g_painter->setResolution(g_graphics.getViewportSize() / m_scaling);
             m_framebuffer->resize(g_painter->getResolution());
             m_framebuffer->bind();
         }
 
         if (toDrawMapQueue && toDrawMapQueue->hasFrameBuffer()) {
-            AutoStat s(STATS_RENDER, "UpdateMap");
+            AutoStat s(STATS_ZONE(STATS_RENDER, "UpdateMap"));
             m_mapFramebuffer->resize(toDrawMapQueue->getFrameBufferSize());
             m_mapFramebuffer->bind();
             g_painter->clear(Color::black);
@@ -266,12 +281,12 @@ void GraphicalApplication::run()
         }
 
         {
-            AutoStat s(STATS_RENDER, "Clear");
+            AutoStat s(STATS_ZONE(STATS_RENDER, "Clear"));
             g_painter->clear(Color::alpha);
         }
 
         {
-            AutoStat s(STATS_RENDER, "DrawFirstForeground");
+            AutoStat s(STATS_ZONE(STATS_RENDER, "DrawFirstForeground"));
             if (toDrawQueue)
                 toDrawQueue->draw(DRAW_BEFORE_MAP);
         }
@@ -279,7 +294,7 @@ void GraphicalApplication::run()
         if(toDrawMapQueue) {
             isOnline = toDrawMapQueue->hasFrameBuffer();
             if(isOnline) {
-                AutoStat s(STATS_RENDER, "DrawMapBackground");
+                AutoStat s(STATS_ZONE(STATS_RENDER, "DrawMapBackground"));
                 PainterShaderProgramPtr shader = nullptr;
                 if (!toDrawMapQueue->getShader().empty()) {
                     shader = g_shaders.getShader(toDrawMapQueue->getShader());
@@ -301,19 +316,19 @@ void GraphicalApplication::run()
                 }
             }
             if(toDrawMapForegroundQueue) {
-                AutoStat s(STATS_RENDER, "DrawMapForeground");
+                AutoStat s(STATS_ZONE(STATS_RENDER, "DrawMapForeground"));
                 toDrawMapForegroundQueue->draw();
             }
         }
 
         {
-            AutoStat s(STATS_RENDER, "DrawSecondForeground");
+            AutoStat s(STATS_ZONE(STATS_RENDER, "DrawSecondForeground"));
             toDrawQueue->draw(DRAW_AFTER_MAP);
         }
 
         {
             if (g_extras.debugRender) {
-                AutoStat s(STATS_RENDER, "DrawGraphs");
+                AutoStat s(STATS_ZONE(STATS_RENDER, "DrawGraphs"));
                 for (int i = 0, x = 60, y = 30; i <= GRAPH_LAST; ++i) {
                     g_graphs[i].draw(Rect(x, y, Size(200, 60)));
                     y += 70;
@@ -326,7 +341,7 @@ void GraphicalApplication::run()
         }
 
         if (m_scaling > 1.0f) {
-            AutoStat s(STATS_RENDER, "DrawScaled");
+            AutoStat s(STATS_ZONE(STATS_RENDER, "DrawScaled"));
             m_framebuffer->release();
             g_painter->setResolution(g_graphics.getViewportSize());
             g_painter->clear(Color::alpha);
@@ -335,10 +350,15 @@ void GraphicalApplication::run()
 
         g_graphs[GRAPH_GPU_CALLS].addValue(g_painter->calls());
         g_graphs[GRAPH_GPU_DRAWS].addValue(g_painter->draws());
+        g_stats.addFrameDraws(g_painter->calls(), g_painter->binds(), g_painter->cacheFlushes());
+        g_stats.collect();
+
+        g_adaptiveRenderer.addStageTime(ADAPTIVE_STAGE_GPU, stdext::micros() - frameStart);
 
-        AutoStat s(STATS_RENDER, "SwapBuffers");
+        AutoStat s(STATS_ZONE(STATS_RENDER, "SwapBuffers"));
         g_window.swapBuffers();
         g_graphics.checkForError(__FUNCTION__, __FILE__, __LINE__);
+        g_stats.addFrameTime(STATS_RENDER, stdext::micros() - frameStart);
         g_graphs[GRAPH_TOTAL_FRAME_TIME].addValue(stdext::millis() - lastFrame);
         lastFrame = stdext::millis();
         totalFrames += 1;
@@ -347,6 +367,10 @@ void GraphicalApplication::run()
     worker.join();
     g_graphicsDispatcher.poll();
 
+#ifdef HEADLESS
+    g_logger.info("Frame times:\n" + g_stats.getFrameTimesInfo(true));
+#endif
+
     m_framebuffer = nullptr;
     m_mapFramebuffer = nullptr;
     g_drawQueue = nullptr;
@@ -45,7 +45,11 @@ public:
     bool willRepaint() { return m_mustRepaint; }
     void repaint() { m_mustRepaint = true; }
 
+#ifdef HEADLESS
+    void setMaxFps(int maxFps) {} // headless frames are drawn as fast as possible
+#else
     void setMaxFps(int maxFps) { m_maxFps = maxFps; }
+#endif
     int getMaxFps() { return m_maxFps; }
     int getFps() { return m_graphicsFrames.getFps(); }
     int getGraphicsFps() { return m_graphicsFrames.getFps(); }
@@ -73,7 +77,11 @@ private:
     int m_iteration = 0;
     std::atomic<float> m_scaling = 1.0;
     std::atomic<float> m_lastScaling = 1.0;
+#ifdef HEADLESS
+    std::atomic_int m_maxFps = 0;
+#else
     std::atomic_int m_maxFps = 100;
+#endif
     stdext::boolean<false> m_onInputEvent;
     stdext::boolean<false> m_mustRepaint;
     FrameBufferPtr m_framebuffer, m_mapFramebuffer;
@@ -21,6 +21,8 @@
  */
 
 #include "scheduledevent.h"
+#include "eventdispatcher.h"
+#include <framework/stdext/pool_allocator.h>
 
 ScheduledEvent::ScheduledEvent(const std::string& function, const std::function<void()>& callback, int delay, int maxCycles, bool botSafe) : Event(function, callback, botSafe)
 {
@@ -30,6 +32,11 @@ ScheduledEvent::ScheduledEvent(const std::string& function, const std::function<
     m_cyclesExecuted = 0;
 }
 
+std::shared_ptr<ScheduledEvent> ScheduledEvent::create(const std::string& function, const std::function<void()>& callback, int delay, int maxCycles, bool botSafe)
+{
+    return std::allocate_shared<ScheduledEvent>(stdext::pool_allocator<ScheduledEvent>(), function, callback, delay, maxCycles, botSafe);
+}
+
 void ScheduledEvent::execute()
 {
     if(!m_canceled && m_callback && (m_maxCycles == 0 || m_cyclesExecuted < m_maxCycles)) {
@@ -44,6 +51,15 @@ void ScheduledEvent::execute()
     m_cyclesExecuted++;
 }
 
+void ScheduledEvent::cancel()
+{
+    // the dispatcher may hold the last reference
+    ScheduledEventPtr self = static_self_cast<ScheduledEvent>();
+    Event::cancel();
+    if(m_dispatcher)
+        m_dispatcher->unschedule(this);
+}
+
 bool ScheduledEvent::nextCycle()
 {
     if(m_callback && !m_canceled && (m_maxCycles == 0 || m_cyclesExecuted < m_maxCycles)) {
@@ -27,12 +27,20 @@
 #include "event.h"
 #include "clock.h"
 
+class EventDispatcher;
+struct TimerList;
+
 // @bindclass
 class ScheduledEvent : public Event
 {
 public:
     ScheduledEvent(const std::string& function, const std::function<void()>& callback, int delay, int maxCycles, bool botSafe = false);
+    // events come from a pool, timers are created and dropped all the time
+    static std::shared_ptr<ScheduledEvent> create(const std::string& function, const std::function<void()>& callback, int delay, int maxCycles, bool botSafe = false);
+
     void execute();
+    // also removes the event from the dispatcher which scheduled it
+    void cancel() override;
     bool nextCycle();
 
     int ticks() { return m_ticks; }
@@ -41,11 +49,21 @@ public:
     int cyclesExecuted() { return m_cyclesExecuted; }
     int maxCycles() { return m_maxCycles; }
 
+    void setDispatcher(EventDispatcher* dispatcher) { m_dispatcher = dispatcher; }
+
 private:
     ticks_t m_ticks;
     int m_delay;
     int m_maxCycles;
     int m_cyclesExecuted;
+    EventDispatcher* m_dispatcher = nullptr;
+
+    // slot of the timer wheel the event is linked into, the wheel owns the event through m_timerSelf
+    friend class TimerWheel;
+    TimerList* m_timerList = nullptr;
+    ScheduledEvent* m_timerPrev = nullptr;
+    ScheduledEvent* m_timerNext = nullptr;
+    std::shared_ptr<ScheduledEvent> m_timerSelf;
 };
 
 struct lessScheduledEvent {
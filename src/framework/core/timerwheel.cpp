@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "timerwheel.h"
+#include "clock.h"
+
+static int getLevelShift(int level)
+{
+    return 8 + level * 6;
+}
+
+TimerList& TimerWheel::getList(ticks_t ticks)
+{
+    if(ticks <= m_time)
+        return m_expired;
+
+    // the first time each slot is reached after now is the time of the events placed in it
+    ticks_t delta = ticks - m_time;
+    if(delta < FirstSlots)
+        return m_first[ticks & (FirstSlots - 1)];
+
+    for(int level = 0; level < Levels; ++level) {
+        int shift = getLevelShift(level);
+        if(delta < ((ticks_t)1 << (shift + LevelBits)))
+            return m_levels[level][(ticks >> shift) & (LevelSlots - 1)];
+    }
+
+    // further than the wheel reaches, placed in the last slot reached and placed again when it's cascaded
+    int shift = getLevelShift(Levels - 1);
+    return m_levels[Levels - 1][((m_time >> shift) + LevelSlots - 1) & (LevelSlots - 1)];
+}
+
+void TimerWheel::add(const ScheduledEventPtr& event)
+{
+    if(event->m_timerList)
+        remove(event.get());
+    // nothing to poll until now, so the wheel doesn't step through the time it was empty
+    if(m_size == 0 && m_time < g_clock.millis())
+        m_time = g_clock.millis();
+    link(getList(event->m_ticks), event);
+    m_size++;
+}
+
+void TimerWheel::link(TimerList& list, ScheduledEventPtr event)
+{
+    ScheduledEvent* ptr = event.get();
+    ptr->m_timerList = &list;
+    ptr->m_timerPrev = list.last;
+    ptr->m_timerNext = nullptr;
+    if(list.last)
+        list.last->m_timerNext = ptr;
+    else
+        list.first = ptr;
+    list.last = ptr;
+    ptr->m_timerSelf = std::move(event);
+}
+
+void TimerWheel::remove(ScheduledEvent* event)
+{
+    TimerList* list = event->m_timerList;
+    if(!list)
+        return;
+
+    if(event->m_timerPrev)
+        event->m_timerPrev->m_timerNext = event->m_timerNext;
+    else
+        list->first = event->m_timerNext;
+    if(event->m_timerNext)
+        event->m_timerNext->m_timerPrev = event->m_timerPrev;
+    else
+        list->last = event->m_timerPrev;
+    event->m_timerList = nullptr;
+    event->m_timerPrev = event->m_timerNext = nullptr;
+    m_size--;
+
+    // may release the event
+    ScheduledEventPtr self = std::move(event->m_timerSelf);
+}
+
+void TimerWheel::take(TimerList& list, std::vector<ScheduledEventPtr>& events)
+{
+    ScheduledEvent* event = list.first;
+    list.first = list.last = nullptr;
+    while(event) {
+        ScheduledEvent* next = event->m_timerNext;
+        event->m_timerList = nullptr;
+        event->m_timerPrev = event->m_timerNext = nullptr;
+        events.push_back(std::move(event->m_timerSelf));
+        m_size--;
+        event = next;
+    }
+}
+
+void TimerWheel::cascade(int level)
+{
+    TimerList& list = m_levels[level][(m_time >> getLevelShift(level)) & (LevelSlots - 1)];
+    ScheduledEvent* event = list.first;
+    list.first = list.last = nullptr;
+    while(event) {
+        ScheduledEvent* next = event->m_timerNext;
+        link(getList(event->m_ticks), std::move(event->m_timerSelf));
+        event = next;
+    }
+}
+
+void TimerWheel::poll(ticks_t now, std::vector<ScheduledEventPtr>& due)
+{
+    take(m_expired, due);
+
+    while(m_time < now) {
+        if(m_size == 0) {
+            m_time = now;
+            break;
+        }
+
+        m_time++;
+        if((m_time & (FirstSlots - 1)) == 0) {
+            // from the coarsest level, its events may go to the finer levels cascaded after it
+            for(int level = Levels - 1; level >= 0; --level) {
+                if((m_time & (((ticks_t)1 << getLevelShift(level)) - 1)) == 0)
+                    cascade(level);
+            }
+            take(m_expired, due);
+        }
+        take(m_first[m_time & (FirstSlots - 1)], due);
+    }
+}
+
+void TimerWheel::clear(std::vector<ScheduledEventPtr>& events)
+{
+    take(m_expired, events);
+    for(TimerList& list : m_first)
+        take(list, events);
+    for(auto& level : m_levels) {
+        for(TimerList& list : level)
+            take(list, events);
+    }
+}
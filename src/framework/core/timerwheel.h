@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include "scheduledevent.h"
+
+struct TimerList {
+    ScheduledEvent* first = nullptr;
+    ScheduledEvent* last = nullptr;
+};
+
+// Hierarchical timing wheel of scheduled events, with a slot for every millisecond of the next
+// 256 ms and coarser slots for later ones, moved to finer slots as their time comes closer.
+// Adding and removing an event is O(1), polling is O(1) for each millisecond passed.
+// Events are linked into the slots, the wheel holds a reference to them while they are linked.
+// Not thread safe.
+class TimerWheel
+{
+public:
+    // the event is due at its ticks, events already due are returned by the next poll
+    void add(const ScheduledEventPtr& event);
+    void remove(ScheduledEvent* event);
+    // moves the events due at now to due, in the order of their ticks
+    void poll(ticks_t now, std::vector<ScheduledEventPtr>& due);
+    // moves every event to events
+    void clear(std::vector<ScheduledEventPtr>& events);
+
+    size_t size() { return m_size; }
+    bool empty() { return m_size == 0; }
+
+private:
+    enum {
+        Levels = 3, // coarser levels
+        FirstBits = 8,
+        LevelBits = 6,
+        FirstSlots = 1 << FirstBits,
+        LevelSlots = 1 << LevelBits
+    };
+
+    TimerList& getList(ticks_t ticks);
+    void link(TimerList& list, ScheduledEventPtr event);
+    void take(TimerList& list, std::vector<ScheduledEventPtr>& events);
+    void cascade(int level);
+
+    TimerList m_first[FirstSlots];
+    TimerList m_levels[Levels][LevelSlots];
+    TimerList m_expired; // events added when they were already due
+    ticks_t m_time = 0; // every millisecond up to this one was polled
+    size_t m_size = 0;
+};
+
+#endif
@@ -34,34 +34,58 @@ void Atlas::init()
     resetAtlas(1);
 }
 
+void Atlas::initBlocks(size_t size)
+{
+    m_size = size;
+    reset();
+}
+
 void Atlas::reset()
 {
-    m_doReset = false;
     resetAtlas(0);
     m_cache.clear();
+    m_lru.clear();
+    m_usedArea = 0;
+    m_evicted = false;
+    m_evictedRect = Rect();
 }
 
 void Atlas::reload()
 {
+    m_resets += 1;
     reset();
     resetAtlas(1);
 }
 
 void Atlas::resetAtlas(int location) {
-    if (!m_atlas[location])
+    if (!m_atlas[location] && location != 0)
         return;
-    for (auto& location : m_locations[location])
-        location.clear();
 
-    size_t size = m_atlas[location]->getSize().width();
+    if (location == 0) {
+        for (auto& blocks : m_freeBlocks)
+            blocks.clear();
+    } else {
+        for (auto& locations : m_fontLocations)
+            locations.clear();
+    }
+
+    size_t size = location == 0 ? m_size : m_atlas[location]->getSize().width();
     for (size_t i = 0; i < size; i += 2048) {
-        m_locations[location][6].push_back(Point(i, i));
+        std::vector<Point> blocks = { Point(i, i) };
         for (size_t x = 0; x < i; x += 2048) {
-            m_locations[location][6].push_back(Point(i, x));
-            m_locations[location][6].push_back(Point(x, i));
+            blocks.push_back(Point(i, x));
+            blocks.push_back(Point(x, i));
+        }
+        for (auto& block : blocks) {
+            if (location == 0)
+                m_freeBlocks[6].insert(getBlockKey(block));
+            else
+                m_fontLocations[6].push_back(block);
         }
     }
 
+    if (!m_atlas[location]) // headless, there are no pixels to clear
+        return;
     m_atlas[location]->bind();
     g_painter->clear(Color::alpha);
     m_atlas[location]->release();
@@ -75,12 +99,15 @@ void Atlas::terminate() {
 
 Point Atlas::cache(uint64_t hash, const Size& size, bool& draw)
 {
-    if (m_doReset) {
-        reset();
-    }
     auto it = m_cache.find(hash);
     if (it != m_cache.end()) {
-        return it->second;
+        AtlasSlot& slot = it->second;
+        if (slot.lastFrame != m_frame) {
+            slot.lastFrame = m_frame;
+            m_lru.splice(m_lru.begin(), m_lru, slot.lru);
+        }
+        m_hits += 1;
+        return slot.pos;
     }
 
     int index = calculateIndex(size);
@@ -89,19 +116,107 @@ Point Atlas::cache(uint64_t hash, const Size& size, bool& draw)
         return Point(-1, -1);
     }
 
-    if (m_locations[0][index].empty() && !findSpace(0, index)) {
+    m_misses += 1;
+    Point location;
+    if (!allocate(index, location) && !evict(index, location)) {
         draw = false;
-        m_doReset = true;
+        m_failures += 1;
         return Point(-1, -1);
     }
 
-    Point location = m_locations[0][index].front();
-    m_locations[0][index].pop_front();
-    m_cache.emplace(hash, location);
+    int blockSize = 32 << index;
+    m_usedArea += blockSize * blockSize;
+    m_lru.push_front(hash);
+    m_cache.emplace(hash, AtlasSlot{ location, index, m_frame, m_lru.begin() });
+    if (m_evicted) // the block may still hold pixels of an evicted image
+        m_evictedRect = Rect(location, Size(blockSize, blockSize));
     draw = true;
     return location;
 }
 
+bool Atlas::allocate(int index, Point& pos)
+{
+    if (m_freeBlocks[index].empty() && !splitBlock(index + 1))
+        return false;
+    auto it = m_freeBlocks[index].begin();
+    pos = getBlockPos(*it);
+    m_freeBlocks[index].erase(it);
+    return true;
+}
+
+bool Atlas::splitBlock(int index)
+{
+    if (index > 6)
+        return false;
+    if (m_freeBlocks[index].empty() && !splitBlock(index + 1))
+        return false;
+
+    auto it = m_freeBlocks[index].begin();
+    Point pos = getBlockPos(*it);
+    m_freeBlocks[index].erase(it);
+
+    int size = 32 << (index - 1);
+    m_freeBlocks[index - 1].insert(getBlockKey(pos));
+    m_freeBlocks[index - 1].insert(getBlockKey(Point(pos.x + size, pos.y)));
+    m_freeBlocks[index - 1].insert(getBlockKey(Point(pos.x, pos.y + size)));
+    m_freeBlocks[index - 1].insert(getBlockKey(Point(pos.x + size, pos.y + size)));
+    return true;
+}
+
+void Atlas::freeBlock(int index, Point pos)
+{
+    // merge with the 3 buddies while they are free too
+    while (index < 6) {
+        int size = 32 << index;
+        Point parent(pos.x / (size * 2) * (size * 2), pos.y / (size * 2) * (size * 2));
+        uint32_t buddies[4] = {
+            getBlockKey(parent), getBlockKey(Point(parent.x + size, parent.y)),
+            getBlockKey(Point(parent.x, parent.y + size)), getBlockKey(Point(parent.x + size, parent.y + size))
+        };
+        uint32_t key = getBlockKey(pos);
+        bool merge = true;
+        for (uint32_t buddy : buddies) {
+            if (buddy != key && m_freeBlocks[index].count(buddy) == 0) {
+                merge = false;
+                break;
+            }
+        }
+        if (!merge)
+            break;
+
+        for (uint32_t buddy : buddies) {
+            if (buddy != key)
+                m_freeBlocks[index].erase(buddy);
+        }
+        pos = parent;
+        index += 1;
+    }
+    m_freeBlocks[index].insert(getBlockKey(pos));
+}
+
+bool Atlas::evict(int index, Point& pos)
+{
+    // bounded, so a big image can't stall the frame, it's drawn without the atlas until there's space
+    for (int evicted = 0; evicted < 64 && !m_lru.empty(); ++evicted) {
+        auto it = m_cache.find(m_lru.back());
+        AtlasSlot& slot = it->second;
+        if (slot.lastFrame == m_frame) // everything left was drawn in this frame
+            return false;
+
+        int blockSize = 32 << slot.index;
+        m_usedArea -= blockSize * blockSize;
+        freeBlock(slot.index, slot.pos);
+        m_lru.pop_back();
+        m_cache.erase(it);
+        m_evictions += 1;
+        m_evicted = true;
+
+        if (allocate(index, pos))
+            return true;
+    }
+    return false;
+}
+
 void Atlas::bind()
 {
     m_atlas[0]->bind();
@@ -113,6 +228,14 @@ void Atlas::release()
     m_atlas[0]->release();
 }
 
+void Atlas::clearEvicted()
+{
+    if (!m_evictedRect.isValid())
+        return;
+    g_painter->clearRect(Color::alpha, m_evictedRect);
+    m_evictedRect = Rect();
+}
+
 Point Atlas::cacheFont(const TexturePtr& fontTexture)
 {
     fontTexture->update();
@@ -120,11 +243,11 @@ Point Atlas::cacheFont(const TexturePtr& fontTexture)
     if (index < 0) {
         g_logger.fatal("[Atlas] Too big font texture. Max is 2048x2048");
     }
-    if (m_locations[1][index].empty() && !findSpace(1, index)) {
+    if (m_fontLocations[index].empty() && !findSpace(index)) {
         g_logger.fatal("[Atlas] Out of space for new fonts, compile with BIG_FONTS or DONT_CACHE_FONTS definition");
     }
-    Point location = m_locations[1][index].front();
-    m_locations[1][index].pop_front();
+    Point location = m_fontLocations[index].front();
+    m_fontLocations[index].pop_front();
     m_atlas[1]->bind();
     g_painter->setCompositionMode(Painter::CompositionMode_Replace);
     g_painter->drawTexturedRect(Rect(location, fontTexture->getSize()), fontTexture);
@@ -144,31 +267,46 @@ int Atlas::calculateIndex(const Size& size)
     return s <= 2048 ? 6 : -1;
 }
 
-bool Atlas::findSpace(int location, int index) {
+bool Atlas::findSpace(int index) {
     static const size_t sizes[7] = { 32, 64, 128, 256, 512, 1024, 2048 };
-    if (location >= 2 || index >= 6) {
+    if (index >= 6) {
         return false;
     }
-    if (m_locations[location][index + 1].size() == 0 && !findSpace(location, index + 1)) {
+    if (m_fontLocations[index + 1].size() == 0 && !findSpace(index + 1)) {
         return false;
     }
-    auto pos = m_locations[location][index + 1].front();
-    m_locations[location][index + 1].pop_front();
-    m_locations[location][index].push_back(pos);
-    m_locations[location][index].push_back(Point(pos.x, pos.y + sizes[index]));
-    m_locations[location][index].push_back(Point(pos.x + sizes[index], pos.y));
-    m_locations[location][index].push_back(Point(pos.x + sizes[index], pos.y + sizes[index]));
+    auto pos = m_fontLocations[index + 1].front();
+    m_fontLocations[index + 1].pop_front();
+    m_fontLocations[index].push_back(pos);
+    m_fontLocations[index].push_back(Point(pos.x, pos.y + sizes[index]));
+    m_fontLocations[index].push_back(Point(pos.x + sizes[index], pos.y));
+    m_fontLocations[index].push_back(Point(pos.x + sizes[index], pos.y + sizes[index]));
     return true;
 }
 
 std::string Atlas::getStats() {
     std::stringstream ss;
-    for (int l = 0; l < 2; ++l) {
-        for (auto& it : m_locations[l]) {
-            ss << it.size() << " ";
-        }
-        ss << "| ";
+    // free blocks per size, fragmentation is the part of the free space outside of the largest free block
+    uint64_t freeArea = 0, largestFree = 0;
+    for (int i = 0; i < 7; ++i) {
+        ss << m_freeBlocks[i].size() << " ";
+        uint64_t blockArea = (uint64_t)(32 << i) * (32 << i);
+        freeArea += m_freeBlocks[i].size() * blockArea;
+        if (!m_freeBlocks[i].empty())
+            largestFree = blockArea;
     }
+    ss << "| ";
+    for (auto& it : m_fontLocations) {
+        ss << it.size() << " ";
+    }
+    ss << "| ";
+
+    uint64_t totalArea = m_usedArea + freeArea;
+    uint64_t lookups = m_hits + m_misses;
+    ss << "used " << (totalArea ? m_usedArea * 100 / totalArea : 0) << "% (" << m_cache.size() << " images), ";
+    ss << "fragmentation " << (freeArea ? 100 - largestFree * 100 / freeArea : 0) << "%, ";
+    ss << "hits " << (lookups ? m_hits * 100 / lookups : 0) << "%, ";
+    ss << "failed " << m_failures << ", evicted " << m_evictions << ", resets " << m_resets << " ";
     ss << "(" << m_size << "|" << g_graphics.getMaxTextureSize() << ")";
     return ss.str();
 }
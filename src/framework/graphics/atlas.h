@@ -3,35 +3,72 @@
 
 #include "drawqueue.h"
 #include "framebuffer.h"
-#include <map>
+#include <set>
+#include <unordered_map>
 #include <vector>
 
+// A cached image, placed at the top left corner of a power of two block (32 to 2048 pixels)
+struct AtlasSlot {
+    Point pos;
+    int index;
+    uint32_t lastFrame;
+    std::list<uint64_t>::iterator lru;
+};
+
 class Atlas {
 public:
     void init();
+    // only the block allocator of the main atlas, without textures, for the headless benchmarks
+    void initBlocks(size_t size);
     void terminate();
     void reload();
 
+    // images used in the current frame are never evicted, call it before drawing a new frame
+    void newFrame() { m_frame += 1; }
     Point cache(uint64_t hash, const Size& size, bool& draw);
     Point cacheFont(const TexturePtr& fontTexture);
 
     TexturePtr get(int location) { return m_atlas[location]->getTexture(); }
     void bind();
     void release();
+    // clears what an evicted image left in the block of the last cached one, the atlas must be bound
+    void clearEvicted();
 
     std::string getStats(); // not thread safe!
+    uint64_t getHits() { return m_hits; }
+    uint64_t getMisses() { return m_misses; }
+    uint64_t getFailures() { return m_failures; }
+    uint64_t getEvictions() { return m_evictions; }
+    uint32_t getResets() { return m_resets; }
 
 private:
     void reset();
     void resetAtlas(int location);
-    bool findSpace(int location, int index);
+    bool allocate(int index, Point& pos);
+    bool splitBlock(int index);
+    void freeBlock(int index, Point pos);
+    bool evict(int index, Point& pos);
+    bool findSpace(int index);
     inline int calculateIndex(const Size& size);
+    static uint32_t getBlockKey(const Point& pos) { return ((uint32_t)pos.y << 16) | (uint32_t)pos.x; }
+    static Point getBlockPos(uint32_t key) { return Point(key & 0xFFFF, key >> 16); }
 
     FrameBufferPtr m_atlas[2];
-    std::map<uint64_t, Point> m_cache;
-    std::list<Point> m_locations[2][7];
+    std::unordered_map<uint64_t, AtlasSlot> m_cache;
+    std::list<uint64_t> m_lru; // most recently used first
+    std::set<uint32_t> m_freeBlocks[7];
+    std::list<Point> m_fontLocations[7];
     size_t m_size;
-    bool m_doReset = false;
+    uint32_t m_frame = 1;
+    Rect m_evictedRect;
+    bool m_evicted = false;
+
+    uint64_t m_usedArea = 0;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    uint64_t m_failures = 0;
+    uint64_t m_evictions = 0;
+    uint32_t m_resets = 0;
 };
 
 extern Atlas g_atlas;
@@ -12,9 +12,11 @@ void DrawCache::draw()
 
 void DrawCache::bind()
 {
-    if (m_bound) return;
-    g_atlas.bind();
-    m_bound = true;
+    if (!m_bound) {
+        g_atlas.bind();
+        m_bound = true;
+    }
+    g_atlas.clearEvicted();
 }
 
 void DrawCache::release()
@@ -8,10 +8,15 @@
 #include <framework/graphics/textrender.h>
 #include <framework/graphics/drawcache.h>
 #include <framework/graphics/image.h>
+#include <framework/util/extras.h>
+#include <framework/util/stats.h>
 #include <client/spritemanager.h>
 #include <client/outfit.h>
 
-std::shared_ptr<DrawQueue> g_drawQueue;
+static std::mutex g_releasedQueuesMutex;
+static std::vector<std::unique_ptr<DrawQueue>> g_releasedQueues;
+
+thread_local std::shared_ptr<DrawQueue> g_drawQueue;
 
 void DrawQueueItemTextureCoords::draw()
 {
@@ -45,11 +50,6 @@ void DrawQueueItemTextureCoords::draw(const Point& pos)
     g_painter->drawTexturedRect(Rect(pos, m_texture->getSize()), m_texture);
 }
 
-void DrawQueueItemColoredTextureCoords::draw()
-{
-    g_painter->drawTextureCoords(m_coordsBuffer, m_texture, &m_colors);
-}
-
 void DrawQueueItemImageWithShader::draw()
 {
     if (!m_texture) return;
@@ -110,89 +110,389 @@ void DrawQueueItemTexturedRect::draw(const Point& pos)
 }
 
 
-bool DrawQueueItemFilledRect::cache()
+std::shared_ptr<DrawQueue> DrawQueue::create()
 {
-    if (!g_drawCache.hasSpace(6)) return false;
-    g_drawCache.addRect(m_dest, m_color);
-    return true; 
+    DrawQueue* queue = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(g_releasedQueuesMutex);
+        if (!g_releasedQueues.empty()) {
+            queue = g_releasedQueues.back().release();
+            g_releasedQueues.pop_back();
+        }
+    }
+    if (!queue)
+        queue = new DrawQueue;
+
+    // the queue is reset by whoever drops the last reference, usually the render thread after drawing it
+    return std::shared_ptr<DrawQueue>(queue, [](DrawQueue* queue) {
+        queue->reset();
+        std::lock_guard<std::mutex> lock(g_releasedQueuesMutex);
+        if (g_releasedQueues.size() < 16) // frame queues and map floor queues
+            g_releasedQueues.emplace_back(queue);
+        else
+            delete queue;
+    });
 }
 
-void DrawQueueItemClearRect::draw()
+void DrawQueue::reset()
 {
-    g_painter->clearRect(m_color, m_dest);
+    m_queue.clear();
+    m_conditions.clear();
+    m_textures.clear();
+    m_coords.clear();
+    m_colorsUsed = 0;
+    m_points.clear();
+    m_items.clear();
+    m_frameBufferSize = Size();
+    m_frameBufferDest = m_frameBufferSrc = Rect();
+    mapPosition = 0;
+    m_useFrameBuffer = false;
+    m_scaling = 1.f;
+    m_shader.clear();
+    m_walkOffset = PointF();
 }
 
-bool DrawQueueItemFillCoords::cache()
+void DrawQueue::append(DrawQueue& other)
 {
-    int size = m_coordsBuffer.getVertexCount();
-    if (!g_drawCache.hasSpace(size))
-        return false;
+    uint32_t queueOffset = m_queue.size();
+    uint32_t texturesOffset = m_textures.size();
+    uint32_t coordsOffset = m_coords.size();
+    uint32_t colorsOffset = m_colorsUsed;
+    uint32_t pointsOffset = m_points.size();
+    uint32_t itemsOffset = m_items.size();
+
+    m_queue.reserve(m_queue.size() + other.m_queue.size());
+    for (DrawCommand& command : other.m_queue) {
+        m_queue.push_back(command);
+        DrawCommand& appended = m_queue.back();
+        switch (appended.type) {
+        case DRAW_COMMAND_TEXTURED_RECT:
+        case DRAW_COMMAND_OUTFIT:
+        case DRAW_COMMAND_TEXT:
+            appended.texture += texturesOffset;
+            break;
+        case DRAW_COMMAND_TEXTURE_COORDS:
+            appended.texture += texturesOffset;
+            appended.data += coordsOffset;
+            break;
+        case DRAW_COMMAND_COLORED_TEXTURE_COORDS:
+            appended.texture += texturesOffset;
+            appended.data += coordsOffset;
+            appended.count += colorsOffset;
+            break;
+        case DRAW_COMMAND_COLORED_TEXT:
+            appended.texture += texturesOffset;
+            appended.data += colorsOffset;
+            break;
+        case DRAW_COMMAND_FILL_COORDS:
+            appended.data += coordsOffset;
+            break;
+        case DRAW_COMMAND_LINE:
+            appended.data += pointsOffset;
+            break;
+        case DRAW_COMMAND_ITEM:
+            appended.data += itemsOffset;
+            break;
+        default:
+            break;
+        }
+    }
 
-    g_drawCache.addCoords(m_coordsBuffer, m_color);
-    return true;
+    for (DrawQueueCondition& condition : other.m_conditions) {
+        m_conditions.push_back(condition);
+        m_conditions.back().m_start += queueOffset;
+        m_conditions.back().m_end += queueOffset;
+    }
+
+    std::move(other.m_textures.begin(), other.m_textures.end(), std::back_inserter(m_textures));
+    std::move(other.m_coords.begin(), other.m_coords.end(), std::back_inserter(m_coords));
+    for (size_t i = 0; i < other.m_colorsUsed; ++i) {
+        if (m_colorsUsed == m_colors.size())
+            m_colors.emplace_back();
+        m_colors[m_colorsUsed++].swap(other.m_colors[i]);
+    }
+    m_points.insert(m_points.end(), other.m_points.begin(), other.m_points.end());
+    std::move(other.m_items.begin(), other.m_items.end(), std::back_inserter(m_items));
 }
 
-void DrawQueueItemText::draw()
+Rect* DrawQueue::getTexturedRectDest(DrawCommand& command)
 {
-    g_text.drawText(m_point, m_hash, m_color, m_shadow);
+    if (command.type == DRAW_COMMAND_TEXTURED_RECT || command.type == DRAW_COMMAND_OUTFIT)
+        return &command.dest;
+    if (command.type == DRAW_COMMAND_ITEM) {
+        if (DrawQueueItemTexturedRect* item = dynamic_cast<DrawQueueItemTexturedRect*>(m_items[command.data].get()))
+            return &item->m_dest;
+    }
+    return nullptr;
 }
 
-void DrawQueueItemTextColored::draw()
+static uint64_t getOutfitHash(const TexturePtr& texture, const Rect& src, int32_t colors)
 {
-    g_text.drawColoredText(m_point, m_hash, m_colors, m_shadow);
+    return (((uint64_t)texture->getUniqueId()) << 48) +
+        (((uint64_t)src.x()) << 36) +
+        (((uint64_t)src.y()) << 24) +
+        (((uint64_t)src.width()) << 12) +
+        (((uint64_t)src.height())) +
+        (((uint64_t)colors) * 1125899906842597ULL);
 }
 
-void::DrawQueueItemLine::draw()
+static void setOutfitColors(int32_t colors, const Point& offset)
 {
-    g_painter->setColor(m_color);
-    static std::vector<float> vertices(1024, 0);
-    if (vertices.size() < m_points.size())
-        vertices.resize(m_points.size());
-    int i = 0;
-    for (Point& point : m_points) {
-        vertices[i++] = point.x;
-        vertices[i++] = point.y;
+    Matrix4 mat4;
+    for (int x = 0; x < 4; ++x) {
+        Color color = Color::getOutfitColor((colors >> (x * 8)) & 0xFF);
+        mat4(x + 1, 1) = color.rF();
+        mat4(x + 1, 2) = color.gF();
+        mat4(x + 1, 3) = color.bF();
+        mat4(x + 1, 4) = color.aF();
     }
-    g_painter->drawLine(vertices, i / 2, m_width);
+    g_painter->setDrawOutfitLayersProgram();
+    g_painter->setMatrixColor(mat4);
+    g_painter->setOffset(offset);
 }
 
-void DrawQueueConditionClip::start(DrawQueue*)
+bool DrawQueue::cacheCommand(DrawCommand& command)
 {
-    m_prevClip = g_painter->getClipRect();
-    g_painter->setClipRect(m_rect);
+    switch (command.type) {
+    case DRAW_COMMAND_TEXTURED_RECT:
+    case DRAW_COMMAND_TEXTURE_COORDS:
+    case DRAW_COMMAND_OUTFIT: {
+        const TexturePtr& texture = m_textures[command.texture];
+        if (command.type == DRAW_COMMAND_TEXTURED_RECT && command.dest.size() > command.src.size()) // upscaling may create artifacts
+            return false;
+        if (command.type != DRAW_COMMAND_OUTFIT && !texture->canCache())
+            return false;
+        texture->update();
+
+        bool outfit = command.type == DRAW_COMMAND_OUTFIT;
+        uint64_t hash = outfit ? getOutfitHash(texture, command.src, command.param) : 100 + texture->getUniqueId();
+        bool drawNow = false;
+        Point atlasPos = g_atlas.cache(hash, outfit ? command.src.size() : texture->getSize(), drawNow);
+        if (atlasPos.x < 0) { return false; } // can't be cached
+        if (drawNow) { g_drawCache.bind(); drawCommandAt(command, atlasPos); }
+
+        if (command.type == DRAW_COMMAND_TEXTURE_COORDS) {
+            CoordsBuffer& coords = m_coords[command.data];
+            if (!g_drawCache.hasSpace(coords.getVertexCount()))
+                return false;
+            g_drawCache.addTexturedCoords(coords, atlasPos, command.color);
+            return true;
+        }
+
+        if (!g_drawCache.hasSpace(6))
+            return false;
+        g_drawCache.addTexturedRect(command.dest, outfit ? Rect(atlasPos, command.src.size()) : command.src + atlasPos, command.color);
+        return true;
+    }
+    case DRAW_COMMAND_FILLED_RECT:
+        if (!g_drawCache.hasSpace(6))
+            return false;
+        g_drawCache.addRect(command.dest, command.color);
+        return true;
+    case DRAW_COMMAND_FILL_COORDS: {
+        CoordsBuffer& coords = m_coords[command.data];
+        if (!g_drawCache.hasSpace(coords.getVertexCount()))
+            return false;
+        g_drawCache.addCoords(coords, command.color);
+        return true;
+    }
+    case DRAW_COMMAND_ITEM:
+        return m_items[command.data]->cache();
+    default:
+        return false;
+    }
 }
 
-void DrawQueueConditionClip::end(DrawQueue*)
+void DrawQueue::drawCommand(DrawCommand& command)
 {
-    g_painter->setClipRect(m_prevClip);
+    switch (command.type) {
+    case DRAW_COMMAND_TEXTURED_RECT:
+        g_painter->setColor(command.color);
+        g_painter->drawTexturedRect(command.dest, m_textures[command.texture], command.src);
+        break;
+    case DRAW_COMMAND_TEXTURE_COORDS:
+        g_painter->setColor(command.color);
+        g_painter->drawTextureCoords(m_coords[command.data], m_textures[command.texture]);
+        break;
+    case DRAW_COMMAND_COLORED_TEXTURE_COORDS:
+        g_painter->drawTextureCoords(m_coords[command.data], m_textures[command.texture], &m_colors[command.count]);
+        break;
+    case DRAW_COMMAND_CLEAR_RECT:
+        g_painter->clearRect(command.color, command.dest);
+        break;
+    case DRAW_COMMAND_TEXT:
+        g_text.drawText(command.offset, command.hash, command.color, command.shadow);
+        break;
+    case DRAW_COMMAND_COLORED_TEXT:
+        g_text.drawColoredText(command.offset, command.hash, m_colors[command.data], command.shadow);
+        break;
+    case DRAW_COMMAND_LINE: {
+        g_painter->setColor(command.color);
+        static std::vector<float> vertices(1024, 0);
+        if (vertices.size() < command.count * 2)
+            vertices.resize(command.count * 2);
+        int i = 0;
+        for (uint32_t j = 0; j < command.count; ++j) {
+            const Point& point = m_points[command.data + j];
+            vertices[i++] = point.x;
+            vertices[i++] = point.y;
+        }
+        g_painter->drawLine(vertices, i / 2, command.param);
+        break;
+    }
+    case DRAW_COMMAND_OUTFIT:
+        if (!m_textures[command.texture]) break;
+        setOutfitColors(command.param, command.offset);
+        g_painter->drawTexturedRect(command.dest, m_textures[command.texture], command.src);
+        g_painter->resetShaderProgram();
+        break;
+    case DRAW_COMMAND_ITEM:
+        m_items[command.data]->draw();
+        break;
+    default: // filled rects and fill coords are always cached
+        break;
+    }
 }
 
-void DrawQueueConditionRotation::start(DrawQueue*)
+void DrawQueue::drawCommandAt(DrawCommand& command, const Point& pos)
 {
-    g_painter->pushTransformMatrix();
-    g_painter->rotate(m_center, m_angle);
+    const TexturePtr& texture = m_textures[command.texture];
+    if (command.type == DRAW_COMMAND_OUTFIT) {
+        if (!texture) return;
+        setOutfitColors(command.param, command.offset);
+        g_painter->drawTexturedRect(Rect(pos, command.src.size()), texture, command.src);
+        g_painter->resetShaderProgram();
+        return;
+    }
+    g_painter->resetColor();
+    g_painter->drawTexturedRect(Rect(pos, texture->getSize()), texture);
 }
 
-void DrawQueueConditionRotation::end(DrawQueue*)
+static const uint64_t NO_BATCH = (uint64_t)-1;
+
+uint64_t DrawQueue::getBatchKey(DrawCommand& command)
 {
-    g_painter->popTransformMatrix();
+    switch (command.type) {
+    case DRAW_COMMAND_FILLED_RECT:
+    case DRAW_COMMAND_OUTFIT:
+        return 0; // atlas
+    case DRAW_COMMAND_TEXTURED_RECT: {
+        const TexturePtr& texture = m_textures[command.texture];
+        if (!(command.dest.size() > command.src.size()) && texture->canCache())
+            return 0;
+        return (uint64_t)(uintptr_t)texture.get();
+    }
+    default:
+        return NO_BATCH;
+    }
 }
 
-void DrawQueueConditionMark::start(DrawQueue*)
+void DrawQueue::addToBatch(uint32_t index, uint64_t key)
 {
-    // nothing
+    // join the latest batch with the same key unless a batch drawn after it overlaps the command
+    const Rect& dest = m_queue[index].dest;
+    size_t batch = m_batches.size();
+    size_t limit = batch > 16 ? batch - 16 : 0;
+    while (batch > limit) {
+        DrawBatch& previous = m_batches[--batch];
+        if (previous.key == key) {
+            m_batchNext[previous.last] = index;
+            previous.last = index;
+            previous.bounds |= dest;
+            return;
+        }
+        if (previous.bounds.intersects(dest))
+            break;
+    }
+    m_batches.push_back(DrawBatch{ key, index, index, dest });
 }
 
-void DrawQueueConditionMark::end(DrawQueue* queue)
+const std::vector<uint32_t>& DrawQueue::sortBatches(size_t start, size_t end)
 {
-    g_painter->setDrawColorOnTextureShaderProgram();
-    g_painter->setColor(m_color);
-    for (size_t i = m_start; i < m_end; ++i) {
-        DrawQueueItemTexturedRect* texture = dynamic_cast<DrawQueueItemTexturedRect*>(queue->m_queue[i]);
-        if (texture)
-            g_painter->drawTexturedRect(texture->m_dest, texture->m_texture, texture->m_src);
+    // commands are only moved inside runs of rects within the same conditions
+    m_order.clear();
+    m_batchNext.resize(m_queue.size());
+    m_boundaries.clear();
+    for (auto& condition : m_conditions) {
+        m_boundaries.push_back(condition.m_start);
+        m_boundaries.push_back(condition.m_end);
+    }
+    m_boundaries.push_back(end);
+    std::sort(m_boundaries.begin(), m_boundaries.end());
+
+    auto boundary = m_boundaries.begin();
+    for (size_t i = start; i < end;) {
+        while (*boundary <= i)
+            ++boundary;
+        const size_t segmentEnd = *boundary;
+
+        m_batches.clear();
+        for (; i < segmentEnd; ++i) {
+            uint64_t key = getBatchKey(m_queue[i]);
+            if (key == NO_BATCH)
+                break;
+            addToBatch(i, key);
+        }
+        for (auto& batch : m_batches) {
+            for (uint32_t index = batch.first;; index = m_batchNext[index]) {
+                m_order.push_back(index);
+                if (index == batch.last)
+                    break;
+            }
+        }
+        if (i < segmentEnd)
+            m_order.push_back(i++);
+    }
+
+    uint32_t moved = 0;
+    for (size_t i = 0; i < m_order.size(); ++i) {
+        if (m_order[i] != start + i)
+            moved += 1;
+    }
+    g_stats.addBatchedDraws(moved);
+    return m_order;
+}
+
+void DrawQueue::startCondition(DrawQueueCondition& condition)
+{
+    switch (condition.type) {
+    case DRAW_CONDITION_CLIP:
+        condition.m_prevClip = g_painter->getClipRect();
+        g_painter->setClipRect(condition.m_rect);
+        break;
+    case DRAW_CONDITION_ROTATION:
+        g_painter->pushTransformMatrix();
+        g_painter->rotate(condition.m_center, condition.m_angle);
+        break;
+    case DRAW_CONDITION_MARK:
+        break;
+    }
+}
+
+void DrawQueue::endCondition(DrawQueueCondition& condition)
+{
+    switch (condition.type) {
+    case DRAW_CONDITION_CLIP:
+        g_painter->setClipRect(condition.m_prevClip);
+        break;
+    case DRAW_CONDITION_ROTATION:
+        g_painter->popTransformMatrix();
+        break;
+    case DRAW_CONDITION_MARK:
+        g_painter->setDrawColorOnTextureShaderProgram();
+        g_painter->setColor(condition.m_color);
+        for (size_t i = condition.m_start; i < condition.m_end; ++i) {
+            DrawCommand& command = m_queue[i];
+            if (command.type == DRAW_COMMAND_TEXTURED_RECT || command.type == DRAW_COMMAND_OUTFIT) {
+                g_painter->drawTexturedRect(command.dest, m_textures[command.texture], command.src);
+            } else if (command.type == DRAW_COMMAND_ITEM) {
+                if (DrawQueueItemTexturedRect* item = dynamic_cast<DrawQueueItemTexturedRect*>(m_items[command.data].get()))
+                    g_painter->drawTexturedRect(item->m_dest, item->m_texture, item->m_src);
+            }
+        }
+        g_painter->resetShaderProgram();
+        break;
     }
-    g_painter->resetShaderProgram();
 }
 
 void DrawQueue::setFrameBuffer(const Rect& dest, const Size& size, const Rect& src)
@@ -216,14 +516,23 @@ void DrawQueue::addText(BitmapFontPtr font, const std::string& text, const Rect&
 {
     if (!font || text.empty()) return;
     uint64_t hash = g_text.addText(font, text, screenCoords.size(), align);
-    m_queue.push_back(new DrawQueueItemText(screenCoords.topLeft(), font->getTexture(), hash, color, shadow));
+    DrawCommand& command = addCommand(DRAW_COMMAND_TEXT, color);
+    command.texture = addTexture(font->getTexture());
+    command.offset = screenCoords.topLeft();
+    command.hash = hash;
+    command.shadow = shadow;
 }
 
 void DrawQueue::addColoredText(BitmapFontPtr font, const std::string& text, const Rect& screenCoords, Fw::AlignmentFlag align, const std::vector<std::pair<int, Color>>& colors, bool shadow)
 {
     if (!font || text.empty()) return;
     uint64_t hash = g_text.addText(font, text, screenCoords.size(), align);
-    m_queue.push_back(new DrawQueueItemTextColored(screenCoords.topLeft(), font->getTexture(), hash, colors, shadow));
+    DrawCommand& command = addCommand(DRAW_COMMAND_COLORED_TEXT, Color::white);
+    command.texture = addTexture(font->getTexture());
+    command.data = addColors(colors);
+    command.offset = screenCoords.topLeft();
+    command.hash = hash;
+    command.shadow = shadow;
 }
 
 void DrawQueue::correctOutfit(const Rect& dest, int fromPos, bool oldScaling, bool center)
@@ -233,12 +542,12 @@ void DrawQueue::correctOutfit(const Rect& dest, int fromPos, bool oldScaling, bo
         int centerX = 0;
         int centerY = 0;
         for (size_t i = fromPos; i < m_queue.size(); ++i) {
-            if (DrawQueueItemTexturedRect* texture = dynamic_cast<DrawQueueItemTexturedRect*>(m_queue[i])) {
-                rects.push_back(&texture->m_dest);
+            if (Rect* rect = getTexturedRectDest(m_queue[i])) {
+                rects.push_back(rect);
 
                 if (center) {
-                    centerX = std::max<int>(centerX, texture->m_dest.center().x);
-                    centerY = std::max<int>(centerY, texture->m_dest.center().y);
+                    centerX = std::max<int>(centerX, rect->center().x);
+                    centerY = std::max<int>(centerY, rect->center().y);
                 }
             }
         }
@@ -252,8 +561,8 @@ void DrawQueue::correctOutfit(const Rect& dest, int fromPos, bool oldScaling, bo
     }
     else {
         for (size_t i = fromPos; i < m_queue.size(); ++i) {
-            if (DrawQueueItemTexturedRect* texture = dynamic_cast<DrawQueueItemTexturedRect*>(m_queue[i]))
-                rects.push_back(&texture->m_dest);
+            if (Rect* rect = getTexturedRectDest(m_queue[i]))
+                rects.push_back(rect);
         }
 
         int x1 = 0, y1 = 1, x2 = 0, y2 = 0;
@@ -283,8 +592,8 @@ void DrawQueue::draw(DrawType drawType)
         start = mapPosition;
     }
 
-    std::sort(m_conditions.begin(), m_conditions.end(), [](const DrawQueueCondition* a, const DrawQueueCondition* b) -> bool {
-        return a->m_start == b->m_start ? a->m_end < b->m_end : a->m_start < b->m_start;
+    std::sort(m_conditions.begin(), m_conditions.end(), [](const DrawQueueCondition& a, const DrawQueueCondition& b) -> bool {
+        return a.m_start == b.m_start ? a.m_end < b.m_end : a.m_start < b.m_start;
     });
 
     Size originalResolution = g_painter->getResolution();
@@ -298,29 +607,34 @@ void DrawQueue::draw(DrawType drawType)
         g_painter->setProjectionMatrix(projectionMatrix);
     }
 
+    bool batch = g_extras.batchDraws;
+    if (batch)
+        sortBatches(start, end);
+
     auto condition = m_conditions.begin();
     std::stack<DrawQueueCondition*> activeConditions;
     // skip conditions
-    while (condition != m_conditions.end() && (*condition)->m_end <= start)
+    while (condition != m_conditions.end() && condition->m_end <= start)
         ++condition;
     // execute conditions & draw
     for (size_t i = start; i < end; ++i) {
         while (!activeConditions.empty() && activeConditions.top()->m_end <= i) {
             g_drawCache.draw();
-            activeConditions.top()->end(this);
+            endCondition(*activeConditions.top());
             activeConditions.pop();
         }
-        while (condition != m_conditions.end() && (*condition)->m_start <= i) {
+        while (condition != m_conditions.end() && condition->m_start <= i) {
             g_drawCache.draw();
-            (*condition)->start(this);
-            activeConditions.push(*condition);
+            startCondition(*condition);
+            activeConditions.push(&*condition);
             ++condition;
         }
 
-        if (!m_queue[i]->cache()) {
+        DrawCommand& command = m_queue[batch ? m_order[i - start] : i];
+        if (!cacheCommand(command)) {
             g_drawCache.draw();
-            if (!m_queue[i]->cache()) { // try to cache again, now g_drawCache should be empty, maybe there's new space
-                m_queue[i]->draw();
+            if (!cacheCommand(command)) { // try to cache again, now g_drawCache should be empty, maybe there's new space
+                drawCommand(command);
             }
         }
         if (g_drawCache.getSize() >= g_drawCache.HALF_MAX_SIZE) {
@@ -330,7 +644,7 @@ void DrawQueue::draw(DrawType drawType)
     g_drawCache.draw();
     // end all actibe conditions
     while (!activeConditions.empty()) {
-        activeConditions.top()->end(this);
+        endCondition(*activeConditions.top());
         activeConditions.pop();
     }
 
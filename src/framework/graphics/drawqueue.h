@@ -57,17 +57,6 @@ struct DrawQueueItemTextureCoords : public DrawQueueItem {
     CoordsBuffer m_coordsBuffer;
 };
 
-struct DrawQueueItemColoredTextureCoords : public DrawQueueItem {
-    DrawQueueItemColoredTextureCoords(CoordsBuffer& coordsBuffer, const TexturePtr& texture, const std::vector<std::pair<int, Color>>& colors) :
-        DrawQueueItem(texture), m_coordsBuffer(std::move(coordsBuffer)), m_colors(colors)
-    {};
-
-    void draw();
-
-    CoordsBuffer m_coordsBuffer;
-    std::vector<std::pair<int, Color>> m_colors;
-};
-
 struct DrawQueueItemImageWithShader : public DrawQueueItemTextureCoords {
     DrawQueueItemImageWithShader(CoordsBuffer& coords, const TexturePtr& texture, const Color& color, const std::string& shader) :
         DrawQueueItemTextureCoords(coords, texture, color), m_shader(shader)
@@ -82,107 +71,58 @@ struct DrawQueueItemImageWithShader : public DrawQueueItemTextureCoords {
     std::string m_shader;
 };
 
-struct DrawQueueItemFilledRect : public DrawQueueItem {
-    DrawQueueItemFilledRect(const Rect& rect, const Color& color) :
-        DrawQueueItem(nullptr, color), m_dest(rect) {};
-    bool cache();
-
-    Rect m_dest;
-};
-
-struct DrawQueueItemClearRect : public DrawQueueItem {
-    DrawQueueItemClearRect(const Rect& rect, const Color& color) :
-        DrawQueueItem(nullptr, color), m_dest(rect)
-    {};
-    void draw();
-
-    Rect m_dest;
-};
-
-struct DrawQueueItemFillCoords : public DrawQueueItem {
-    DrawQueueItemFillCoords(CoordsBuffer& coordsBuffer, const Color& color) :
-        DrawQueueItem(nullptr, color), m_coordsBuffer(std::move(coordsBuffer))
-    {};
-    bool cache();
-
-    CoordsBuffer m_coordsBuffer;
+// Built in draw commands. They are plain data, the texture, coords, colors and points they use are kept
+// in arrays of the queue and referenced by index, so recording a frame doesn't allocate once the arrays
+// have grown. Anything else (shaders, light view) is a DrawQueueItem owned by the queue.
+enum DrawCommandType : uint8_t {
+    DRAW_COMMAND_TEXTURED_RECT,
+    DRAW_COMMAND_TEXTURE_COORDS,
+    DRAW_COMMAND_COLORED_TEXTURE_COORDS,
+    DRAW_COMMAND_FILLED_RECT,
+    DRAW_COMMAND_FILL_COORDS,
+    DRAW_COMMAND_CLEAR_RECT,
+    DRAW_COMMAND_TEXT,
+    DRAW_COMMAND_COLORED_TEXT,
+    DRAW_COMMAND_LINE,
+    DRAW_COMMAND_OUTFIT,
+    DRAW_COMMAND_ITEM
 };
 
-struct DrawQueueItemText : public DrawQueueItem {
-    DrawQueueItemText(const Point& point, const TexturePtr& texture, uint64_t hash, const Color& color, bool shadow = false) :
-        DrawQueueItem(texture, color), m_point(point), m_hash(hash), m_shadow(shadow)
-    {};
-    void draw();
-
-    Point m_point;
-    uint64_t m_hash;
-    bool m_shadow = false;
+struct DrawCommand {
+    DrawCommandType type;
+    bool shadow;
+    uint32_t texture; // index in m_textures
+    uint32_t data; // index in m_coords, m_colors, m_points or m_items
+    uint32_t count; // line points
+    int32_t param; // outfit colors, line width
+    Color color;
+    Rect dest;
+    Rect src;
+    Point offset; // outfit mask offset, text position
+    uint64_t hash; // text
 };
 
-struct DrawQueueItemTextColored : public DrawQueueItem {
-    DrawQueueItemTextColored(const Point& point, const TexturePtr& texture, uint64_t hash, const std::vector<std::pair<int, Color>>& colors, bool shadow = false) :
-        DrawQueueItem(texture), m_point(point), m_hash(hash), m_colors(colors), m_shadow(shadow)
-    {};
-    void draw();
-
-    Point m_point;
-    uint64_t m_hash;
-    std::vector<std::pair<int, Color>> m_colors;
-    bool m_shadow = false;
+enum DrawConditionType : uint8_t {
+    DRAW_CONDITION_CLIP,
+    DRAW_CONDITION_ROTATION,
+    DRAW_CONDITION_MARK
 };
 
-struct DrawQueueItemLine : public DrawQueueItem {
-    DrawQueueItemLine(const std::vector<Point>& points, int width, const Color& color) :
-        DrawQueueItem(nullptr, color), m_points(points), m_width(width)
-    {};
-    void draw();
-
-    std::vector<Point> m_points;
-    int m_width;
+struct DrawBatch {
+    uint64_t key;
+    uint32_t first;
+    uint32_t last;
+    Rect bounds;
 };
 
 struct DrawQueueCondition {
-    DrawQueueCondition(size_t start, size_t end) :
-        m_start(start), m_end(end) {}
-    virtual ~DrawQueueCondition() = default;
-
-    virtual void start(DrawQueue*) = 0;
-    virtual void end(DrawQueue*) = 0;
-
+    DrawConditionType type;
     size_t m_start;
     size_t m_end;
-};
-
-struct DrawQueueConditionClip : public DrawQueueCondition {
-    DrawQueueConditionClip(size_t start, size_t end, const Rect& rect) :
-        DrawQueueCondition(start, end), m_rect(rect) {}
-
-    void start(DrawQueue* queue) override;
-    void end(DrawQueue* queue) override;
-
     Rect m_rect;
     Rect m_prevClip;
-};
-
-struct DrawQueueConditionRotation : public DrawQueueCondition {
-    DrawQueueConditionRotation(size_t start, size_t end, const Point& center, float angle) :
-        DrawQueueCondition(start, end), m_center(center), m_angle(angle) {}
-
-    void start(DrawQueue* queue) override;
-    void end(DrawQueue* queue) override;
-
     Point m_center;
     float m_angle;
-};
-
-struct DrawQueueConditionMark : public DrawQueueCondition {
-    DrawQueueConditionMark(size_t start, size_t end, const Color& color) :
-        DrawQueueCondition(start, end), m_color(color)
-    {}
-
-    void start(DrawQueue* queue) override;
-    void end(DrawQueue* queue) override;
-
     Color m_color;
 };
 
@@ -191,47 +131,69 @@ public:
     DrawQueue() = default;
     DrawQueue(const DrawQueue&) = delete;
     DrawQueue& operator= (const DrawQueue&) = delete;
-    ~DrawQueue() {
-        for (auto& item : m_queue)
-            delete item;
-        m_queue.clear();
-        for (auto& condition : m_conditions)
-            delete condition;
-        m_conditions.clear();
-    }
+
+    // returns an empty queue, reusing the memory of a released one when possible
+    static std::shared_ptr<DrawQueue> create();
+    // clears the queue, keeps the memory
+    void reset();
+    // moves the commands of other to the end of this queue, other is left unusable until reset
+    void append(DrawQueue& other);
 
     void draw(DrawType drawType = DRAW_ALL);
+    // the order draw uses for the commands in [start, end) when batching, rects of the same texture are
+    // moved together when nothing drawn between them overlaps
+    const std::vector<uint32_t>& sortBatches(size_t start, size_t end);
 
     void add(DrawQueueItem* item)
     {
         if (!item) return;
-        m_queue.push_back(item);
+        DrawCommand& command = addCommand(DRAW_COMMAND_ITEM, Color::white);
+        command.data = m_items.size();
+        m_items.emplace_back(item);
+    }
+    void addTexturedRect(const Rect& dest, const TexturePtr& texture, const Rect& src, const Color& color = Color::white)
+    {
+        DrawCommand& command = addCommand(DRAW_COMMAND_TEXTURED_RECT, color);
+        command.texture = addTexture(texture);
+        command.dest = dest;
+        command.src = src;
     }
-    DrawQueueItemTexturedRect* addTexturedRect(const Rect& dest, const TexturePtr& texture, const Rect& src, const Color& color = Color::white)
+    void addOutfit(const Rect& dest, const TexturePtr& texture, const Rect& src, const Point& offset, int32_t colors, const Color& color = Color::white)
     {
-        DrawQueueItemTexturedRect* item(new DrawQueueItemTexturedRect(dest, texture, src, color));
-        m_queue.push_back(item);
-        return item;
+        DrawCommand& command = addCommand(DRAW_COMMAND_OUTFIT, color);
+        command.texture = addTexture(texture);
+        command.dest = dest;
+        command.src = src;
+        command.offset = offset;
+        command.param = colors;
     }
     void addTextureCoords(CoordsBuffer& coords, const TexturePtr& texture, const Color& color = Color::white)
     {
-        m_queue.push_back(new DrawQueueItemTextureCoords(coords, texture, color));
+        DrawCommand& command = addCommand(DRAW_COMMAND_TEXTURE_COORDS, color);
+        command.texture = addTexture(texture);
+        command.data = m_coords.size();
+        m_coords.emplace_back(std::move(coords));
     }
     void addColoredTextureCoords(CoordsBuffer& coords, const TexturePtr& texture, const std::vector<std::pair<int, Color>>& colors)
     {
-        m_queue.push_back(new DrawQueueItemColoredTextureCoords(coords, texture, colors));
+        DrawCommand& command = addCommand(DRAW_COMMAND_COLORED_TEXTURE_COORDS, Color::white);
+        command.texture = addTexture(texture);
+        command.data = m_coords.size();
+        command.count = addColors(colors);
+        m_coords.emplace_back(std::move(coords));
     }
     void addFilledRect(const Rect& dest, const Color& color = Color::white)
     {
-        m_queue.push_back(new DrawQueueItemFilledRect(dest, color));
+        addCommand(DRAW_COMMAND_FILLED_RECT, color).dest = dest;
     }
     void addFillCoords(CoordsBuffer& coords, const Color& color = Color::white)
     {
-        m_queue.push_back(new DrawQueueItemFillCoords(coords, color));
+        addCommand(DRAW_COMMAND_FILL_COORDS, color).data = m_coords.size();
+        m_coords.emplace_back(std::move(coords));
     }
     void addClearRect(const Rect& dest, const Color& color = Color::white)
     {
-        m_queue.push_back(new DrawQueueItemClearRect(dest, color));
+        addCommand(DRAW_COMMAND_CLEAR_RECT, color).dest = dest;
     }
     void addText(BitmapFontPtr font, const std::string& text, const Rect& screenCoords, Fw::AlignmentFlag align = Fw::AlignTopLeft, const Color& color = Color::white, bool shadow = false);
     void addColoredText(BitmapFontPtr font, const std::string& text, const Rect& screenCoords, Fw::AlignmentFlag align, const std::vector<std::pair<int, Color>>& colors, bool shadow = false);
@@ -260,7 +222,11 @@ public:
         if (points.empty() || width < 0)
             return;
 
-        m_queue.push_back(new DrawQueueItemLine(points, width, color));
+        DrawCommand& command = addCommand(DRAW_COMMAND_LINE, color);
+        command.data = m_points.size();
+        command.count = points.size();
+        command.param = width;
+        m_points.insert(m_points.end(), points.begin(), points.end());
     }
 
     void setFrameBuffer(const Rect& dest, const Size& size, const Rect& src);
@@ -289,26 +255,29 @@ public:
     void setOpacity(size_t start, float opacity)
     {
         for (size_t i = start; i < m_queue.size(); ++i) {
-            m_queue[i]->m_color = m_queue[i]->m_color.opacity(opacity);
+            Color& color = m_queue[i].type == DRAW_COMMAND_ITEM ? m_items[m_queue[i].data]->m_color : m_queue[i].color;
+            color = color.opacity(opacity);
         }
     }
 
     void setClip(size_t start, const Rect& clip)
     {
         if (start == m_queue.size()) return;
-        m_conditions.push_back(new DrawQueueConditionClip(start, m_queue.size(), clip));
+        addCondition(DRAW_CONDITION_CLIP, start).m_rect = clip;
     }
 
     void setRotation(size_t start, const Point& center, float angle)
     {
         if (start == m_queue.size() || angle == 0) return;
-        m_conditions.push_back(new DrawQueueConditionRotation(start, m_queue.size(), center, angle));
+        DrawQueueCondition& condition = addCondition(DRAW_CONDITION_ROTATION, start);
+        condition.m_center = center;
+        condition.m_angle = angle;
     }
 
     void setMark(size_t start, const Color& color)
     {
         if (start == m_queue.size()) return;
-        m_conditions.push_back(new DrawQueueConditionMark(start, m_queue.size(), color));
+        addCondition(DRAW_CONDITION_MARK, start).m_color = color;
     }
 
     void markMapPosition()
@@ -338,8 +307,62 @@ public:
     }
 
 private:
-    std::vector<DrawQueueItem*> m_queue;
-    std::vector<DrawQueueCondition*> m_conditions;
+    DrawCommand& addCommand(DrawCommandType type, const Color& color)
+    {
+        m_queue.emplace_back();
+        DrawCommand& command = m_queue.back();
+        command.type = type;
+        command.shadow = false;
+        command.color = color;
+        return command;
+    }
+    uint32_t addTexture(const TexturePtr& texture)
+    {
+        // consecutive commands mostly use the same texture
+        if (m_textures.empty() || m_textures.back() != texture)
+            m_textures.push_back(texture);
+        return m_textures.size() - 1;
+    }
+    uint32_t addColors(const std::vector<std::pair<int, Color>>& colors)
+    {
+        if (m_colorsUsed == m_colors.size())
+            m_colors.emplace_back();
+        m_colors[m_colorsUsed].assign(colors.begin(), colors.end());
+        return m_colorsUsed++;
+    }
+    DrawQueueCondition& addCondition(DrawConditionType type, size_t start)
+    {
+        m_conditions.emplace_back();
+        DrawQueueCondition& condition = m_conditions.back();
+        condition.type = type;
+        condition.m_start = start;
+        condition.m_end = m_queue.size();
+        return condition;
+    }
+    Rect* getTexturedRectDest(DrawCommand& command);
+
+    uint64_t getBatchKey(DrawCommand& command);
+    void addToBatch(uint32_t index, uint64_t key);
+
+    bool cacheCommand(DrawCommand& command);
+    void drawCommand(DrawCommand& command);
+    void drawCommandAt(DrawCommand& command, const Point& pos);
+    void startCondition(DrawQueueCondition& condition);
+    void endCondition(DrawQueueCondition& condition);
+
+    std::vector<DrawCommand> m_queue;
+    std::vector<DrawQueueCondition> m_conditions;
+    std::vector<TexturePtr> m_textures;
+    std::vector<CoordsBuffer> m_coords;
+    std::vector<std::vector<std::pair<int, Color>>> m_colors; // reused, only the first m_colorsUsed are valid
+    size_t m_colorsUsed = 0;
+    std::vector<Point> m_points;
+    std::vector<std::unique_ptr<DrawQueueItem>> m_items;
+    // draw order built by sortBatches
+    std::vector<uint32_t> m_order;
+    std::vector<uint32_t> m_batchNext;
+    std::vector<DrawBatch> m_batches;
+    std::vector<size_t> m_boundaries;
     Size m_frameBufferSize;
     Rect m_frameBufferDest, m_frameBufferSrc;
     size_t mapPosition = 0;
@@ -347,10 +370,9 @@ private:
     float m_scaling = 1.f;
     std::string m_shader;
     PointF m_walkOffset;
-
-    friend struct DrawQueueConditionMark;
 };
 
-extern std::shared_ptr<DrawQueue> g_drawQueue;
+// per thread, so parts of a frame can be recorded by other threads into their own queues
+extern thread_local std::shared_ptr<DrawQueue> g_drawQueue;
 
 #endif
\ No newline at end of file
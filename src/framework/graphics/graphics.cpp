@@ -64,7 +64,12 @@ void Graphics::init()
             m_renderer, m_version, glVersion, m_extensions));
     }
 
+#ifdef HEADLESS
+    // there is no glx display to initialize, only the entry points of the current egl context
+    GLenum err = glewContextInit();
+#else
     GLenum err = glewInit();
+#endif
     if(err != GLEW_OK)
         g_logger.fatal(stdext::format("Unable to init GLEW: %s", glewGetErrorString(err)));
 
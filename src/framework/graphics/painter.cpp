@@ -344,8 +344,10 @@ void Painter::popTransformMatrix()
 
 void Painter::updateGlTexture()
 {
-    if (m_glTextureId != 0)
+    if (m_glTextureId != 0) {
         glBindTexture(GL_TEXTURE_2D, m_glTextureId);
+        m_binds += 1;
+    }
 }
 
 void Painter::updateGlCompositionMode()
@@ -771,6 +773,7 @@ void Painter::drawCache(const std::vector<float>& vertex, const std::vector<floa
     glDrawArrays(GL_TRIANGLES, 0, size);
     m_draws += size;
     m_calls += 1;
+    m_cacheFlushes += 1;
 
     PainterShaderProgram::disableAttributeArray(PainterShaderProgram::COLOR_ATTR); 
 }
@@ -184,7 +184,9 @@ public:
 
     int draws() { return m_draws; }
     int calls() { return m_calls; }
-    void resetDraws() { m_draws = m_calls = 0; }
+    int binds() { return m_binds; }
+    int cacheFlushes() { return m_cacheFlushes; }
+    void resetDraws() { m_draws = m_calls = m_binds = m_cacheFlushes = 0; }
 
     void setDrawColorOnTextureShaderProgram()
     {
@@ -240,6 +242,8 @@ protected:
 #endif
     int m_draws = 0;
     int m_calls = 0;
+    int m_binds = 0;
+    int m_cacheFlushes = 0;
 
 private:
     PainterShaderProgram* m_drawProgram;
@@ -102,11 +102,16 @@ void LuaInterface::registerClass(const std::string& className, const std::string
     setGlobal(className);
     const int klass = getTop();
 
-    // creates the class fieldmethods table
+    // creates the class getters and setters tables, keyed by the field names
     newTable();
     pushValue();
-    setGlobal(className + "_fieldmethods");
-    int klass_fieldmethods = getTop();
+    setGlobal(className + "_getters");
+    int klass_getters = getTop();
+
+    newTable();
+    pushValue();
+    setGlobal(className + "_setters");
+    int klass_setters = getTop();
 
     // creates the class metatable
     newTable();
@@ -114,10 +119,13 @@ void LuaInterface::registerClass(const std::string& className, const std::string
     setGlobal(className + "_mt");
     int klass_mt = getTop();
 
-    // set metatable metamethods
-    pushCppFunction(&LuaInterface::luaObjectGetEvent);
+    // set metatable metamethods, the tables they look up are their upvalues
+    pushValue(klass_getters);
+    pushValue(klass);
+    pushCFunction(&LuaInterface::luaObjectGetEvent, 2);
     setField("__index", klass_mt);
-    pushCppFunction(&LuaInterface::luaObjectSetEvent);
+    pushValue(klass_setters);
+    pushCFunction(&LuaInterface::luaObjectSetEvent, 1);
     setField("__newindex", klass_mt);
     pushCppFunction(&LuaInterface::luaObjectEqualEvent);
     setField("__eq", klass_mt);
@@ -127,14 +135,17 @@ void LuaInterface::registerClass(const std::string& className, const std::string
     // set some fields that will be used later in metatable
     pushValue(klass);
     setField("methods", klass_mt);
-    pushValue(klass_fieldmethods);
-    setField("fieldmethods", klass_mt);
+    pushValue(klass_getters);
+    setField("getters", klass_mt);
+    pushValue(klass_setters);
+    setField("setters", klass_mt);
 
-    // redirect methods and fieldmethods to the base class ones
+    // redirect methods, getters and setters to the base class ones
     if(!className.empty() && className != "LuaObject") {
         // the following code is what create classes hierarchy for lua, by reproducing:
         // DerivedClass = { __index = BaseClass }
-        // DerivedClass_fieldmethods = { __index = BaseClass_methods }
+        // DerivedClass_getters = { __index = BaseClass_getters }
+        // DerivedClass_setters = { __index = BaseClass_setters }
 
         // redirect the class methods to the base methods
         pushValue(klass);
@@ -144,17 +155,24 @@ void LuaInterface::registerClass(const std::string& className, const std::string
         setMetatable();
         pop();
 
-        // redirect the class fieldmethods to the base fieldmethods
-        pushValue(klass_fieldmethods);
+        // redirect the class getters and setters to the base ones
+        pushValue(klass_getters);
+        newTable();
+        getGlobal(baseClass + "_getters");
+        setField("__index");
+        setMetatable();
+        pop();
+
+        pushValue(klass_setters);
         newTable();
-        getGlobal(baseClass + "_fieldmethods");
+        getGlobal(baseClass + "_setters");
         setField("__index");
         setMetatable();
         pop();
     }
 
-    // pops klass, klass_mt, klass_fieldmethods
-    pop(3);
+    // pops klass, klass_getters, klass_setters, klass_mt
+    pop(4);
 }
 
 void LuaInterface::registerClassStaticFunction(const std::string& className,
@@ -179,19 +197,19 @@ void LuaInterface::registerClassMemberField(const std::string& className,
                                             const LuaCppFunction& getFunction,
                                             const LuaCppFunction& setFunction)
 {
-    getGlobal(className + "_fieldmethods");
-
     if(getFunction) {
+        getGlobal(className + "_getters");
         pushCppFunction(getFunction);
-        setField(stdext::format("get_%s", field));
+        setField(field);
+        pop();
     }
 
     if(setFunction) {
+        getGlobal(className + "_setters");
         pushCppFunction(setFunction);
-        setField(stdext::format("set_%s", field));
+        setField(field);
+        pop();
     }
-
-    pop();
 }
 
 void LuaInterface::registerGlobalFunction(const std::string& functionName, const LuaCppFunction& function)
@@ -200,79 +218,109 @@ void LuaInterface::registerGlobalFunction(const std::string& functionName, const
     setGlobal(functionName);
 }
 
-int LuaInterface::luaObjectGetEvent(LuaInterface* lua)
+// the objects are full userdatas holding a LuaObjectPtr
+static LuaObjectPtr* checkObject(lua_State* L)
 {
-    // stack: obj, key
-    LuaObjectPtr obj = lua->toObject(-2);
-    std::string key = lua->toString(-1);
-    VALIDATE(obj);
+    auto objRef = static_cast<LuaObjectPtr*>(lua_type(L, 1) == LUA_TUSERDATA ? lua_touserdata(L, 1) : nullptr);
+    if(!objRef || !*objRef)
+        throw stdext::exception("attempt to index a value that is not a lua object");
+    return objRef;
+}
 
-    lua->remove(-1); // removes key
+static int objectGetEvent(lua_State* L)
+{
+    // stack: obj, key
+    // upvalues: class getters, class methods
+    // keys are looked up as they are, lua strings are interned so there is nothing to build or copy
+    LuaObjectPtr* objRef = checkObject(L);
 
-    // if a get method for this key exists, calls it
-    lua->getMetatable(); // pushes obj metatable
-    lua->getField("fieldmethods"); // push obj fieldmethods
-    lua->remove(-2); // removes obj metatable
-    lua->getField(std::string("get_") + key); // pushes get method
-    lua->remove(-2); // remove obj fieldmethods
-    if(!lua->isNil()) { // is the get method not nil?
-        lua->insert(-2); // moves obj to the top
-        lua->signalCall(1, 1); // calls get method, arguments: obj
+    if(lua_type(L, 2) == LUA_TNUMBER)
+        lua_tostring(L, 2); // number keys were always looked up as strings
+    else if(lua_type(L, 2) != LUA_TSTRING) {
+        lua_pushnil(L);
         return 1;
     }
-    lua->pop(); // pops the nil get method
 
-    // if the field for this key exists, returns it
-    obj->luaGetField(key);
-    if(!lua->isNil()) {
-        lua->remove(-2); // removes the obj
-        // field value is on the stack
+    // if a get method for this key exists, calls it
+    lua_pushvalue(L, 2);
+    lua_gettable(L, lua_upvalueindex(1)); // pushes get method
+    if(!lua_isnil(L, -1)) {
+        lua_pushvalue(L, 1);
+        g_lua.signalCall(1, 1); // calls get method, arguments: obj
         return 1;
     }
-    lua->pop(); // pops the nil field
+    lua_pop(L, 1); // pops the nil get method
+
+    // if the field for this key exists, returns it, most objects don't have any
+    LuaObject* obj = objRef->get();
+    if(obj->hasLuaFieldsTable()) {
+        obj->luaGetFieldsTable(); // pushes the obj's fields table
+        lua_pushvalue(L, 2);
+        lua_rawget(L, -2); // pushes the field value
+        if(!lua_isnil(L, -1))
+            return 1;
+        lua_pop(L, 2); // pops the nil field and the fields table
+    }
 
     // pushes the method assigned by this key
-    lua->getMetatable();  // pushes obj metatable
-    lua->getField("methods"); // push obj methods
-    lua->remove(-2); // removes obj metatable
-    lua->getField(key); // pushes obj method
-    lua->remove(-2); // remove obj methods
-    lua->remove(-2); // removes obj
-
-    // the result value is on the stack
+    lua_pushvalue(L, 2);
+    lua_gettable(L, lua_upvalueindex(2));
     return 1;
 }
 
-int LuaInterface::luaObjectSetEvent(LuaInterface* lua)
+static int objectSetEvent(lua_State* L)
 {
     // stack: obj, key, value
-    LuaObjectPtr obj = lua->toObject(-3);
-    std::string key = lua->toString(-2);
-    VALIDATE(obj);
-
-    lua->remove(-2); // removes key
-    lua->insert(-2); // moves obj to the top
+    // upvalues: class setters
+    LuaObjectPtr* objRef = checkObject(L);
 
     // check if a set method for this field exists and call it
-    lua->getMetatable(); // pushes obj metatable
-    lua->getField("fieldmethods"); // push obj fieldmethods
-    lua->remove(-2); // removes obj metatable
-    lua->getField(std::string("set_") + key); // pushes set method
-    lua->remove(-2); // remove obj fieldmethods
-    if(!lua->isNil()) { // is the set method not nil?
-        lua->insert(-3); // moves func to -3
-        lua->insert(-2); // moves obj to -2, and value to -1
-        lua->signalCall(2, 0); // calls set method, arguments: obj, value
-        return 0;
+    if(lua_type(L, 2) == LUA_TSTRING) {
+        lua_pushvalue(L, 2);
+        lua_gettable(L, lua_upvalueindex(1)); // pushes set method
+        if(!lua_isnil(L, -1)) {
+            lua_pushvalue(L, 1);
+            lua_pushvalue(L, 3);
+            g_lua.signalCall(2, 0); // calls set method, arguments: obj, value
+            return 0;
+        }
+        lua_pop(L, 1); // pops the nil set method
     }
-    lua->pop(); // pops the nil set method
 
     // no set method exists, then treats as an field and set it
-    lua->pop(); // pops the object
+    LuaObjectPtr obj = *objRef;
+    std::string key = g_lua.toString(2);
+    lua_pushvalue(L, 3);
     obj->luaSetField(key); // sets the obj field
     return 0;
 }
 
+// the index events are plain lua C functions, so C++ exceptions are turned into lua errors here
+// and the error is raised only after everything with a destructor went out of scope
+static int callObjectEvent(lua_State* L, int (*event)(lua_State*))
+{
+    {
+        std::string error;
+        try {
+            return event(L);
+        } catch(stdext::exception& e) {
+            error = stdext::format("C++ call failed: %s", g_lua.traceback(e.what()));
+        }
+        lua_pushlstring(L, error.c_str(), error.length());
+    }
+    return lua_error(L);
+}
+
+int LuaInterface::luaObjectGetEvent(lua_State* L)
+{
+    return callObjectEvent(L, &objectGetEvent);
+}
+
+int LuaInterface::luaObjectSetEvent(lua_State* L)
+{
+    return callObjectEvent(L, &objectSetEvent);
+}
+
 int LuaInterface::luaObjectEqualEvent(LuaInterface* lua)
 {
     // stack: obj1, obj2
@@ -387,6 +435,25 @@ void LuaInterface::evaluateExpression(const std::string& expression, const std::
         pushNil();
 }
 
+void LuaInterface::evaluateCompiledExpression(const std::string& expression, const std::string& source)
+{
+    if(expression.empty()) {
+        pushNil();
+        return;
+    }
+
+    std::string key = source + '\n' + expression;
+    auto it = m_expressionRefs.find(key);
+    if(it == m_expressionRefs.end()) {
+        loadBuffer(stdext::format("return (%s)", expression), source);
+        it = m_expressionRefs.emplace(key, ref()).first;
+    }
+
+    // evaluates the expression
+    getRef(it->second);
+    safeCall(0, 1);
+}
+
 std::string LuaInterface::traceback(const std::string& errorMessage, int level)
 {
     // gets debug.traceback
@@ -688,7 +755,7 @@ int LuaInterface::luaCppFunctionCallback(lua_State* L)
     int numRets = 0;
 
     // enable only for tests, it has high cpu usage
-    // AutoStat s(STATS_LUACALLBACK, g_lua.getSource(1));
+    // AutoStat s(g_stats.getZone(STATS_LUACALLBACK, g_lua.getSource(1)));
 
     // do the call
     try {
@@ -776,6 +843,8 @@ void LuaInterface::closeLuaState()
         lua_close(L);
         L = NULL;
     }
+    m_fieldNameRefs.clear();
+    m_expressionRefs.clear();
 }
 
 void LuaInterface::collectGarbage()
@@ -1253,6 +1322,22 @@ void LuaInterface::pushCppFunction(const LuaCppFunction& func)
     pushCFunction(&LuaInterface::luaCppFunctionCallback, 1);
 }
 
+void LuaInterface::pushFieldName(const char* field)
+{
+    auto it = m_fieldNameRefs.find(field);
+    if(it != m_fieldNameRefs.end() && it->second.first == field) {
+        getRef(it->second.second);
+        return;
+    }
+
+    // a char array that isn't a literal may hold another name at the same address now
+    if(it != m_fieldNameRefs.end())
+        unref(it->second.second);
+    pushCString(field);
+    pushValue();
+    m_fieldNameRefs[field] = std::make_pair(std::string(field), ref());
+}
+
 void LuaInterface::pushValue(int index)
 {
     VALIDATE(hasIndex(index));
@@ -125,9 +125,9 @@ public:
 
 private:
     /// Metamethod that will retrieve fields values (that include functions) from the object when using '.' or ':'
-    static int luaObjectGetEvent(LuaInterface* lua);
+    static int luaObjectGetEvent(lua_State* L);
     /// Metamethod that is called when setting a field of the object by using the keyword '='
-    static int luaObjectSetEvent(LuaInterface* lua);
+    static int luaObjectSetEvent(lua_State* L);
     /// Metamethod that will check equality of objects by using the keyword '=='
     static int luaObjectEqualEvent(LuaInterface* lua);
     /// Metamethod that is called every two lua garbage collections
@@ -159,6 +159,8 @@ public:
     /// Evaluates a lua expression and pushes the result value onto the stack
     /// @exception LuaException is thrown on any lua error
     void evaluateExpression(const std::string& expression, const std::string& source = "lua expression");
+    /// Same as evaluateExpression, but the expression is compiled only once for each source
+    void evaluateCompiledExpression(const std::string& expression, const std::string& source);
 
     /// Generates a traceback message for the current call stack
     /// @param errorMessage is an additional error message
@@ -309,6 +311,10 @@ public:
     void pushObject(const LuaObjectPtr& obj);
     void pushCFunction(LuaCFunction func, int n = 0);
     void pushCppFunction(const LuaCppFunction& func);
+    /// Pushes the lua string of a field name, names are usually string literals so their strings
+    /// are created once and found by the address of the literal afterwards, the name is compared
+    /// too in case the address is a buffer holding another name now
+    void pushFieldName(const char* field);
 
     bool isNil(int index = -1);
     bool isBoolean(int index = -1);
@@ -358,6 +364,8 @@ private:
     int m_totalObjRefs;
     int m_totalFuncRefs;
     int m_globalEnv;
+    std::unordered_map<const char*, std::pair<std::string, int>> m_fieldNameRefs;
+    std::unordered_map<std::string, int> m_expressionRefs;
 };
 
 extern LuaInterface g_lua;
@@ -451,7 +459,7 @@ T LuaInterface::castValue(int index) {
 
 template<typename... T>
 int LuaInterface::luaCallGlobalField(const std::string& global, const std::string& field, const T&... args) {
-    AutoStat s(STATS_LUA, std::string(global) + ":" + field);
+    AutoStat s(g_stats.isEnabled(STATS_LUA) ? g_stats.getZone(STATS_LUA, global, field) : INVALID_STATS_ZONE);
 
     g_lua.getGlobalField(global, field);
     int ret = 0;
@@ -107,12 +107,18 @@ void LuaObject::luaGetFieldsTable()
         g_lua.pushNil();
 }
 
-std::string LuaObject::getClassName()
+const std::string& LuaObject::getClassName()
 {
-    // TODO: this could be cached for more performance
+    // demangled once for each class, it's called for every lua field called from C++
+    static std::unordered_map<const std::type_info*, std::string> classNames;
+    const std::type_info& tinfo = typeid(*this);
+    auto it = classNames.find(&tinfo);
+    if(it == classNames.end()) {
 #ifdef _MSC_VER
-    return stdext::demangle_name(typeid(*this).name()) + 6;
+        it = classNames.emplace(&tinfo, stdext::demangle_name(tinfo.name()) + 6).first;
 #else
-    return stdext::demangle_name(typeid(*this).name());
+        it = classNames.emplace(&tinfo, stdext::demangle_name(tinfo.name())).first;
 #endif
+    }
+    return it->second;
 }
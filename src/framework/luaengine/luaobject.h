@@ -42,11 +42,19 @@ public:
     /// @return the number of results
     template<typename... T>
     int luaCallLuaField(const std::string& field, const T&... args);
+    /// Same for field names given as string literals, without building a std::string nor a lua string for them
+    /// (a char buffer works too, it's only slower when it holds another name than the last time)
+    template<size_t N, typename... T>
+    int luaCallLuaField(const char (&field)[N], const T&... args);
 
     template<typename R, typename... T>
     R callLuaField(const std::string& field, const T&... args);
+    template<typename R, size_t N, typename... T>
+    R callLuaField(const char (&field)[N], const T&... args);
     template<typename... T>
     void callLuaField(const std::string& field, const T&... args);
+    template<size_t N, typename... T>
+    void callLuaField(const char (&field)[N], const T&... args);
 
     /// Returns true if the lua field exists
     bool hasLuaField(const std::string& field);
@@ -73,9 +81,11 @@ public:
 
     /// Gets the table containing all stored fields of this lua object, the result is pushed onto the stack
     void luaGetFieldsTable();
+    bool hasLuaFieldsTable() { return m_fieldsTableRef != -1; }
 
     /// Returns the derived class name, its the same name used in Lua
-    std::string getClassName();
+    /// The names are cached without a lock, like everything touching lua it's only called from the dispatcher thread
+    const std::string& getClassName();
 
     LuaObjectPtr asLuaObject() { return shared_from_this(); }
 
@@ -87,6 +97,10 @@ public:
     void operator=(const LuaObject& other) { }
 
 private:
+    /// Calls the field pushed onto the stack after this object
+    template<typename... T>
+    int luaCallPushedField(const char* field, const T&... args);
+
     int m_fieldsTableRef;
 };
 
@@ -152,15 +166,26 @@ connect(const LuaObjectPtr& obj, const std::string& field, const Lambda& f, bool
 
 template<typename... T>
 int LuaObject::luaCallLuaField(const std::string& field, const T&... args) {
-    AutoStat s(STATS_LUA, getClassName() + ":" + field);
-
     // note that the field must be retrieved from this object lua value
     // to force using the __index metamethod of it's metatable
     // so cannot use LuaObject::getField here
     // push field
-    //AutoStat s(STATS_LUA, field);
     g_lua.pushObject(asLuaObject());
     g_lua.getField(field);
+    return luaCallPushedField(field.c_str(), args...);
+}
+
+template<size_t N, typename... T>
+int LuaObject::luaCallLuaField(const char (&field)[N], const T&... args) {
+    g_lua.pushObject(asLuaObject());
+    g_lua.pushFieldName(field);
+    g_lua.getTable();
+    return luaCallPushedField(field, args...);
+}
+
+template<typename... T>
+int LuaObject::luaCallPushedField(const char* field, const T&... args) {
+    AutoStat s(g_stats.isEnabled(STATS_LUA) ? g_stats.getZone(STATS_LUA, getClassName(), field) : INVALID_STATS_ZONE);
 
     int ret = 0;
     if(!g_lua.isNil()) {
@@ -187,6 +212,18 @@ R LuaObject::callLuaField(const std::string& field, const T&... args) {
     return result;
 }
 
+template<typename R, size_t N, typename... T>
+R LuaObject::callLuaField(const char (&field)[N], const T&... args) {
+    R result;
+    int rets = luaCallLuaField(field, args...);
+    if(rets > 0) {
+        VALIDATE(rets == 1);
+        result = g_lua.polymorphicPop<R>();
+    } else
+        result = R();
+    return result;
+}
+
 template<typename... T>
 void LuaObject::callLuaField(const std::string& field, const T&... args) {
     int rets = luaCallLuaField(field, args...);
@@ -194,6 +231,13 @@ void LuaObject::callLuaField(const std::string& field, const T&... args) {
         g_lua.pop(rets);
 }
 
+template<size_t N, typename... T>
+void LuaObject::callLuaField(const char (&field)[N], const T&... args) {
+    int rets = luaCallLuaField(field, args...);
+    if(rets > 0)
+        g_lua.pop(rets);
+}
+
 template<typename T>
 void LuaObject::setLuaField(const std::string& key, const T& value) {
     g_lua.polymorphicPush(value);
@@ -203,11 +203,24 @@ void Application::registerLuaFunctions()
     g_lua.bindSingletonFunction("g_stats", "get", &Stats::get, &g_stats);
     g_lua.bindSingletonFunction("g_stats", "clear", &Stats::clear, &g_stats);
     g_lua.bindSingletonFunction("g_stats", "clearAll", &Stats::clearAll, &g_stats);
+    g_lua.bindSingletonFunction("g_stats", "setEnabled", &Stats::setEnabled, &g_stats);
+    g_lua.bindSingletonFunction("g_stats", "isEnabled", &Stats::isEnabled, &g_stats);
     g_lua.bindSingletonFunction("g_stats", "getSlow", &Stats::getSlow, &g_stats);
     g_lua.bindSingletonFunction("g_stats", "clearSlow", &Stats::clearSlow, &g_stats);
     g_lua.bindSingletonFunction("g_stats", "getSleepTime", &Stats::getSleepTime, &g_stats);
     g_lua.bindSingletonFunction("g_stats", "resetSleepTime", &Stats::resetSleepTime, &g_stats);
     g_lua.bindSingletonFunction("g_stats", "getWidgetsInfo", &Stats::getWidgetsInfo, &g_stats);
+    g_lua.bindSingletonFunction("g_stats", "getThingTexturesInfo", &Stats::getThingTexturesInfo, &g_stats);
+    g_lua.bindSingletonFunction("g_stats", "getDrawsInfo", &Stats::getDrawsInfo, &g_stats);
+    g_lua.bindSingletonFunction("g_stats", "resetDraws", &Stats::resetDraws, &g_stats);
+    g_lua.bindSingletonFunction("g_stats", "getEventsInfo", &Stats::getEventsInfo, &g_stats);
+    g_lua.bindSingletonFunction("g_stats", "resetEvents", &Stats::resetEvents, &g_stats);
+    g_lua.bindSingletonFunction("g_stats", "getFrameTimesInfo", &Stats::getFrameTimesInfo, &g_stats);
+    g_lua.bindSingletonFunction("g_stats", "resetFrameTimes", &Stats::resetFrameTimes, &g_stats);
+    g_lua.bindSingletonFunction("g_stats", "startTrace", &Stats::startTrace, &g_stats);
+    g_lua.bindSingletonFunction("g_stats", "stopTrace", &Stats::stopTrace, &g_stats);
+    g_lua.bindSingletonFunction("g_stats", "isTracing", &Stats::isTracing, &g_stats);
+    g_lua.bindSingletonFunction("g_stats", "saveTrace", &Stats::saveTrace, &g_stats);
     
     g_lua.registerSingletonClass("g_extras");
     g_lua.bindSingletonFunction("g_extras", "set", &Extras::set, &g_extras);
@@ -337,6 +350,9 @@ void Application::registerLuaFunctions()
     g_lua.bindSingletonFunction("g_adaptiveRenderer", "getLevel", &AdaptiveRenderer::getLevel, &g_adaptiveRenderer);
     g_lua.bindSingletonFunction("g_adaptiveRenderer", "setLevel", &AdaptiveRenderer::setForcedLevel, &g_adaptiveRenderer);
     g_lua.bindSingletonFunction("g_adaptiveRenderer", "getDebugInfo", &AdaptiveRenderer::getDebugInfo, &g_adaptiveRenderer);
+    g_lua.bindSingletonFunction("g_adaptiveRenderer", "getStageLevel", &AdaptiveRenderer::getStageLevel, &g_adaptiveRenderer);
+    g_lua.bindSingletonFunction("g_adaptiveRenderer", "getStageCost", &AdaptiveRenderer::getStageCost, &g_adaptiveRenderer);
+    g_lua.bindSingletonFunction("g_adaptiveRenderer", "getDecisions", &AdaptiveRenderer::getDecisions, &g_adaptiveRenderer);
 
     // PlatformWindow
     g_lua.registerSingletonClass("g_window");
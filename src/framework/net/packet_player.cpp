@@ -1,7 +1,9 @@
 #include <framework/global.h>
 #include <framework/core/clock.h>
+#include <zlib.h>
 
 #include "packet_player.h"
+#include "packet_recorder.h"
 
 PacketPlayer::~PacketPlayer()
 {
@@ -11,25 +13,134 @@ PacketPlayer::~PacketPlayer()
 
 PacketPlayer::PacketPlayer(const std::string& file)
 {
-    static uint32_t sessionId = 1;
 #ifdef ANDROID
-    std::ifstream f(std::string("records/") + file);
+    m_file = std::ifstream(std::string("records/") + file, std::ios::binary);
 #else
-    std::ifstream f(std::filesystem::path("records") / file);
+    m_file = std::ifstream(std::filesystem::path("records") / file, std::ios::binary);
 #endif
-    if (!f.is_open())
+    if (!m_file.is_open())
         return;
+
+    uchar header[PACKET_RECORD_HEADER_SIZE];
+    if (!m_file.read((char*)header, sizeof(header)) || memcmp(header, "OTRB", 4) != 0) {
+        m_file.clear();
+        m_file.seekg(0);
+        loadText(m_file);
+        m_file.close();
+        return;
+    }
+
+    if (stdext::readULE16(header + 4) > PACKET_RECORD_VERSION) {
+        g_logger.error(stdext::format("unsupported packet record version in '%s'", file));
+        return;
+    }
+
+    m_binary = true;
+    loadIndex();
+    readBlock(PACKET_RECORD_HEADER_SIZE);
+}
+
+void PacketPlayer::loadText(std::ifstream& f)
+{
     std::string type, packetHex;
     ticks_t time;
     while (f >> type >> time >> packetHex) {
+        if (type != "<")
+            continue;
         std::string packetStr = boost::algorithm::unhex(packetHex);
         auto packet = std::make_shared<std::vector<uint8_t>>(packetStr.begin(), packetStr.end());
-        if (type == "<") {
-            m_input.push_back(std::make_pair(time, packet));
-        } else if (type == ">") {
-            m_output.push_back(std::make_pair(time, packet));
+        m_input.push_back(std::make_pair(time, packet));
+    }
+}
+
+void PacketPlayer::loadIndex()
+{
+    uchar trailer[PACKET_RECORD_TRAILER_SIZE];
+    m_file.seekg(0, std::ios::end);
+    const uint64 fileSize = m_file.tellg();
+    m_file.seekg(-(int)sizeof(trailer), std::ios::end);
+    if (m_file.read((char*)trailer, sizeof(trailer)) && memcmp(trailer + 8, "OTRI", 4) == 0) {
+        uchar header[5];
+        const uint64 indexOffset = stdext::readULE64(trailer);
+        if (fileSize >= sizeof(trailer) + sizeof(header) && indexOffset <= fileSize - sizeof(trailer) - sizeof(header) &&
+            m_file.seekg(indexOffset) && m_file.read((char*)header, sizeof(header)) && header[0] == PACKET_RECORD_INDEX) {
+            // the entries must fit between the index header and the trailer, whatever count a damaged record has
+            const uint64 entriesSize = (uint64)stdext::readULE32(header + 1) * 12;
+            if (entriesSize <= fileSize - sizeof(trailer) - indexOffset - sizeof(header)) {
+                std::vector<uchar> entries(entriesSize);
+                if (m_file.read((char*)entries.data(), entries.size())) {
+                    for (size_t i = 0; i < entries.size(); i += 12)
+                        m_index.emplace_back(stdext::readULE32(&entries[i]), stdext::readULE64(&entries[i + 4]));
+                    return;
+                }
+            }
         }
     }
+
+    // the recording didn't end properly, find the blocks from their headers
+    m_index.clear();
+    m_file.clear();
+    uint64 offset = PACKET_RECORD_HEADER_SIZE;
+    uchar header[PACKET_RECORD_BLOCK_HEADER_SIZE];
+    while (m_file.seekg(offset) && m_file.read((char*)header, sizeof(header)) && header[0] == PACKET_RECORD_PACKETS) {
+        m_index.emplace_back(stdext::readULE32(header + 1), offset);
+        offset += sizeof(header) + stdext::readULE32(header + 13);
+    }
+    m_file.clear();
+}
+
+bool PacketPlayer::readBlock(uint64 offset)
+{
+    m_input.clear();
+    m_inputPos = 0;
+    m_block = offset;
+    m_nextBlock = 0;
+
+    uchar header[PACKET_RECORD_BLOCK_HEADER_SIZE];
+    m_file.clear();
+    if (!m_file.seekg(offset) || !m_file.read((char*)header, sizeof(header)) || header[0] != PACKET_RECORD_PACKETS)
+        return false;
+
+    uint32 dataSize = stdext::readULE32(header + 9);
+    uint32 storedSize = stdext::readULE32(header + 13);
+    std::string stored(storedSize, '\0');
+    if (!m_file.read(&stored[0], storedSize))
+        return false;
+
+    std::string data;
+    if (storedSize == dataSize) {
+        data = std::move(stored);
+    } else {
+        data.resize(dataSize);
+        uLongf size = dataSize;
+        if (uncompress((Bytef*)&data[0], &size, (const Bytef*)stored.data(), storedSize) != Z_OK || size != dataSize)
+            return false;
+    }
+
+    const uchar* frames = (const uchar*)data.data();
+    for (size_t pos = 0; pos + 9 <= data.size();) {
+        uint8 direction = frames[pos];
+        ticks_t time = stdext::readULE32(frames + pos + 1);
+        uint32 size = stdext::readULE32(frames + pos + 5);
+        pos += 9;
+        if (pos + size > data.size())
+            break;
+        if (direction == PACKET_RECORD_INPUT)
+            m_input.push_back(std::make_pair(time, std::make_shared<std::vector<uint8_t>>(frames + pos, frames + pos + size)));
+        pos += size;
+    }
+
+    m_nextBlock = offset + sizeof(header) + storedSize;
+    return true;
+}
+
+bool PacketPlayer::hasPacket()
+{
+    while (m_inputPos >= m_input.size()) {
+        if (!m_binary || m_nextBlock == 0 || !readBlock(m_nextBlock))
+            return false;
+    }
+    return true;
 }
 
 void PacketPlayer::start(std::function<void(std::shared_ptr<std::vector<uint8_t>>)> recvCallback,
@@ -48,6 +159,46 @@ void PacketPlayer::stop()
     m_event = nullptr;
 }
 
+void PacketPlayer::seek(ticks_t time)
+{
+    if (time < m_playedTime)
+        stdext::throw_exception(stdext::format("unable to seek back to %d ms, records are only seeked forward", time));
+
+    if (m_binary) {
+        // the last block starting before the time, unless the current one is already past it
+        auto it = std::upper_bound(m_index.begin(), m_index.end(), time,
+                                   [](ticks_t t, const std::pair<uint32, uint64>& block) { return t < block.first; });
+        if (it != m_index.begin() && (--it)->second > m_block)
+            readBlock(it->second);
+    }
+
+    while (hasPacket() && m_input[m_inputPos].first < time)
+        m_inputPos++;
+    m_playedTime = time;
+
+    m_start = g_clock.millis() - time;
+    if (m_event) {
+        m_event->cancel();
+        m_event = g_dispatcher.scheduleEvent(std::bind(&PacketPlayer::process, this), 1);
+    }
+}
+
+size_t PacketPlayer::replay(const std::function<void(const std::shared_ptr<std::vector<uint8_t>>&)>& callback)
+{
+    stop();
+
+    size_t packets = 0;
+    while (hasPacket()) {
+        m_playedTime = m_input[m_inputPos].first;
+        callback(m_input[m_inputPos++].second);
+        packets += 1;
+    }
+
+    if (m_disconnectCallback)
+        m_disconnectCallback(boost::asio::error::eof);
+    return packets;
+}
+
 void PacketPlayer::onOutputPacket(const OutputMessagePtr& packet)
 {
     if (packet->getDataBuffer()[0] == 0x14) { // logout
@@ -60,20 +211,20 @@ void PacketPlayer::onOutputPacket(const OutputMessagePtr& packet)
 void PacketPlayer::process()
 {
     ticks_t nextPacket = 1;
-    while (!m_input.empty()) {
-        auto& packet = m_input.front();
+    while (hasPacket()) {
+        auto& packet = m_input[m_inputPos];
         nextPacket = (packet.first + m_start) - g_clock.millis();
         if (nextPacket > 1)
             break;
+        m_playedTime = packet.first;
         m_recvCallback(packet.second);
-        m_input.pop_front();
+        m_inputPos++;
     }
 
-    if (!m_input.empty() && nextPacket > 1) {
+    if (hasPacket() && nextPacket > 1) {
         m_event = g_dispatcher.scheduleEvent(std::bind(&PacketPlayer::process, this), nextPacket);
     } else {
         m_disconnectCallback(boost::asio::error::eof);
         stop();
     }
 }
-
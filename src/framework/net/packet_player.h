@@ -4,6 +4,8 @@
 #include <framework/core/eventdispatcher.h>
 #include <framework/net/outputmessage.h>
 
+// Plays binary records block by block from disk, see packet_recorder.h for the format.
+// Old text records are still read, they are loaded whole.
 class PacketPlayer : public LuaObject {
 public:
     PacketPlayer(const std::string& file);
@@ -11,16 +13,32 @@ public:
 
     void start(std::function<void(std::shared_ptr<std::vector<uint8_t>>)> recvCallback, std::function<void(boost::system::error_code)> disconnectCallback);
     void stop();
+    // continues with the first packet at or after time, the packets skipped are not parsed
+    // only seeks forward, the game state built by the packets already parsed can't be rewound
+    void seek(ticks_t time);
+    // hands every remaining packet to the callback right away instead of in real time, then disconnects
+    size_t replay(const std::function<void(const std::shared_ptr<std::vector<uint8_t>>&)>& callback);
 
     void onOutputPacket(const OutputMessagePtr& packet);
 
 private:
     void process();
+    void loadText(std::ifstream& f);
+    void loadIndex();
+    bool readBlock(uint64 offset);
+    bool hasPacket();
 
     ticks_t m_start;
     ScheduledEventPtr m_event;
     std::deque<std::pair<ticks_t, std::shared_ptr<std::vector<uint8_t>>>> m_input;
-    std::deque<std::pair<ticks_t, std::shared_ptr<std::vector<uint8_t>>>> m_output;
+    size_t m_inputPos = 0;
+    ticks_t m_playedTime = 0; // record time of the last packet played or skipped
     std::function<void(std::shared_ptr<std::vector<uint8_t>>)> m_recvCallback;
     std::function<void(boost::system::error_code)> m_disconnectCallback;
+
+    bool m_binary = false;
+    std::ifstream m_file;
+    uint64 m_block = 0;
+    uint64 m_nextBlock = 0;
+    std::vector<std::pair<uint32, uint64>> m_index;
 };
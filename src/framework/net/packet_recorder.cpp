@@ -1,34 +1,57 @@
 #include <framework/global.h>
 #include <framework/core/clock.h>
 #include <framework/core/resourcemanager.h>
+#include <zlib.h>
 
 #include "packet_recorder.h"
 
+namespace {
+
+void putU8(std::string& out, uint8 value) { out.push_back((char)value); }
+void putU16(std::string& out, uint16 value) { uchar b[2]; stdext::writeULE16(b, value); out.append((char*)b, 2); }
+void putU32(std::string& out, uint32 value) { uchar b[4]; stdext::writeULE32(b, value); out.append((char*)b, 4); }
+void putU64(std::string& out, uint64 value) { uchar b[8]; stdext::writeULE64(b, value); out.append((char*)b, 8); }
+
+}
+
 PacketRecorder::PacketRecorder(const std::string& file)
 {
     m_start = g_clock.millis();
 #ifdef ANDROID
     g_resources.makeDir("records");
-    m_stream = std::ofstream(std::string("records/") + file);
+    m_stream = std::ofstream(std::string("records/") + file, std::ios::binary);
 #else
     std::error_code ec;
     std::filesystem::create_directory("records", ec);
-    m_stream = std::ofstream(std::filesystem::path("records") / file);
+    m_stream = std::ofstream(std::filesystem::path("records") / file, std::ios::binary);
 #endif
+
+    std::string header = "OTRB";
+    putU16(header, PACKET_RECORD_VERSION);
+    putU16(header, PACKET_RECORD_COMPRESSED);
+    m_stream.write(header.data(), header.size());
 }
 
 PacketRecorder::~PacketRecorder()
 {
+    flushBlock();
 
+    uint64 indexOffset = m_stream.tellp();
+    std::string index;
+    putU8(index, PACKET_RECORD_INDEX);
+    putU32(index, m_index.size());
+    for (auto& it : m_index) {
+        putU32(index, it.first);
+        putU64(index, it.second);
+    }
+    putU64(index, indexOffset);
+    index += "OTRI";
+    m_stream.write(index.data(), index.size());
 }
 
 void PacketRecorder::addInputPacket(const InputMessagePtr& packet)
 {
-    m_stream << "< " << (g_clock.millis() - m_start) << " ";
-    for (auto& buffer : packet->getBodyBuffer()) {
-        m_stream << std::setfill('0') << std::setw(2) << std::hex << (uint16_t)(uint8_t)buffer;
-    }
-    m_stream << std::dec << "\n";
+    addPacket(PACKET_RECORD_INPUT, g_clock.millis() - m_start, packet->getBodyBuffer());
 }
 
 void PacketRecorder::addOutputPacket(const OutputMessagePtr& packet)
@@ -39,9 +62,48 @@ void PacketRecorder::addOutputPacket(const OutputMessagePtr& packet)
         return;
     }
 
-    m_stream << "> " << (g_clock.millis() - m_start) << " ";
-    for (auto& buffer : packet->getBuffer()) {
-        m_stream << std::setfill('0') << std::setw(2) << std::hex << (uint16_t)(uint8_t)buffer;
-    }
-    m_stream << std::dec << "\n";
+    addPacket(PACKET_RECORD_OUTPUT, g_clock.millis() - m_start, packet->getBuffer());
+}
+
+void PacketRecorder::addPacket(uint8 direction, uint32 time, const std::string& packet)
+{
+    if (m_blockPackets > 0 && (time >= m_blockTime + 1000 || m_block.size() >= 64 * 1024))
+        flushBlock();
+
+    if (m_blockPackets == 0)
+        m_blockTime = time;
+
+    putU8(m_block, direction);
+    putU32(m_block, time);
+    putU32(m_block, packet.size());
+    m_block += packet;
+    m_blockPackets += 1;
+}
+
+void PacketRecorder::flushBlock()
+{
+    if (m_blockPackets == 0)
+        return;
+
+    uLongf storedSize = compressBound(m_block.size());
+    std::string stored(storedSize, '\0');
+    if (compress2((Bytef*)&stored[0], &storedSize, (const Bytef*)m_block.data(), m_block.size(), Z_BEST_SPEED) != Z_OK || storedSize >= m_block.size())
+        stored = m_block; // kept uncompressed, the stored size is the same as the data size
+    else
+        stored.resize(storedSize);
+
+    m_index.emplace_back(m_blockTime, (uint64)m_stream.tellp());
+
+    std::string header;
+    putU8(header, PACKET_RECORD_PACKETS);
+    putU32(header, m_blockTime);
+    putU32(header, m_blockPackets);
+    putU32(header, m_block.size());
+    putU32(header, stored.size());
+    m_stream.write(header.data(), header.size());
+    m_stream.write(stored.data(), stored.size());
+    m_stream.flush();
+
+    m_block.clear();
+    m_blockPackets = 0;
 }
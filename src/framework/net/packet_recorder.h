@@ -3,6 +3,26 @@
 #include <framework/net/inputmessage.h>
 #include <framework/net/outputmessage.h>
 
+// Binary record format, little endian:
+//   header: "OTRB", u16 version, u16 flags
+//   blocks: u8 type, u32 time of the first packet, u32 packets, u32 data size, u32 stored size, stored data
+//   packet block data is zlib compressed unless the stored size is the same as the data size, it's a list of frames:
+//     u8 direction, u32 time, u32 size, packet
+//   index block, written when the recording ends: u32 blocks, then u32 time and u64 offset of every packet block
+//   trailer: u64 offset of the index block, "OTRI"
+// Packet blocks are closed at least every second, so they are the seek points.
+enum {
+    PACKET_RECORD_VERSION = 1,
+    PACKET_RECORD_COMPRESSED = 1,
+    PACKET_RECORD_HEADER_SIZE = 8,
+    PACKET_RECORD_BLOCK_HEADER_SIZE = 17,
+    PACKET_RECORD_TRAILER_SIZE = 12,
+    PACKET_RECORD_PACKETS = 1,
+    PACKET_RECORD_INDEX = 2,
+    PACKET_RECORD_INPUT = 0,
+    PACKET_RECORD_OUTPUT = 1
+};
+
 class PacketRecorder : public LuaObject {
 public:
     PacketRecorder(const std::string& file);
@@ -10,9 +30,17 @@ public:
 
     void addInputPacket(const InputMessagePtr& packet);
     void addOutputPacket(const OutputMessagePtr& packet);
+    // time in ms since the recording started, packets must be added in time order
+    void addPacket(uint8 direction, uint32 time, const std::string& packet);
 
 private:
+    void flushBlock();
+
     ticks_t m_start;
     std::ofstream m_stream;
     bool m_firstOutput = true;
+    std::string m_block;
+    uint32 m_blockPackets = 0;
+    uint32 m_blockTime = 0;
+    std::vector<std::pair<uint32, uint64>> m_index;
 };
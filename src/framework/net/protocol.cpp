@@ -379,18 +379,23 @@ void Protocol::onPlayerPacket(const std::shared_ptr<std::vector<uint8_t>>& packe
     if (m_disconnected)
         return;
     auto self(asProtocol());
-    boost::asio::post(g_ioService, [&, self, packet] {
-        if (m_disconnected)
-            return;
-        m_inputMessage->reset();
-
-        m_inputMessage->setHeaderSize(0);
-        m_inputMessage->fillBuffer(packet->data(), packet->size());
-        m_inputMessage->setMessageSize(packet->size());
-        onRecv(m_inputMessage);
+    boost::asio::post(g_ioService, [self, packet] {
+        self->parseRecordedPacket(packet);
     });
 }
 
+void Protocol::parseRecordedPacket(const std::shared_ptr<std::vector<uint8_t>>& packet)
+{
+    if (m_disconnected)
+        return;
+    m_inputMessage->reset();
+
+    m_inputMessage->setHeaderSize(0);
+    m_inputMessage->fillBuffer(packet->data(), packet->size());
+    m_inputMessage->setMessageSize(packet->size());
+    onRecv(m_inputMessage);
+}
+
 void Protocol::onProxyPacket(const std::shared_ptr<std::vector<uint8_t>>& packet)
 {
     if (m_disconnected)
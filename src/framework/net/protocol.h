@@ -46,6 +46,9 @@ public:
 
     void setRecorder(PacketRecorderPtr recorder);
     void playRecord(PacketPlayerPtr player);
+    PacketPlayerPtr getPlayer() { return m_player; }
+    // parses a packet of the played record right away, on the calling thread
+    void parseRecordedPacket(const std::shared_ptr<std::vector<uint8_t>>& packet);
 
     bool isConnected();
     bool isConnecting();
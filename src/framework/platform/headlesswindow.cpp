@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifdef HEADLESS
+
+#include <framework/global.h>
+#include "headlesswindow.h"
+#include <framework/core/eventdispatcher.h>
+#include <framework/util/stats.h>
+
+HeadlessWindow::HeadlessWindow()
+{
+    m_eglDisplay = EGL_NO_DISPLAY;
+    m_eglConfig = 0;
+    m_eglContext = EGL_NO_CONTEXT;
+    m_eglSurface = EGL_NO_SURFACE;
+    m_minimumSize = Size(600, 480);
+    m_size = Size(1280, 720);
+}
+
+void HeadlessWindow::init()
+{
+    // surfaceless mesa display first, it doesn't need any display server
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if(getPlatformDisplay)
+        m_eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if(m_eglDisplay == EGL_NO_DISPLAY)
+        m_eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if(m_eglDisplay == EGL_NO_DISPLAY)
+        g_logger.fatal("EGL not supported");
+
+    if(!eglInitialize(m_eglDisplay, NULL, NULL))
+        g_logger.fatal("Unable to initialize EGL");
+
+    internalCreateGLContext();
+    internalCreateSurface();
+    m_created = true;
+}
+
+void HeadlessWindow::terminate()
+{
+    if(m_eglDisplay == EGL_NO_DISPLAY)
+        return;
+
+    eglMakeCurrent(m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    internalDestroySurface();
+    if(m_eglContext != EGL_NO_CONTEXT) {
+        eglDestroyContext(m_eglDisplay, m_eglContext);
+        m_eglContext = EGL_NO_CONTEXT;
+    }
+    eglTerminate(m_eglDisplay);
+    m_eglDisplay = EGL_NO_DISPLAY;
+    m_visible = false;
+}
+
+void HeadlessWindow::internalCreateGLContext()
+{
+#if OPENGL_ES==2
+    EGLint renderableType = EGL_OPENGL_ES2_BIT;
+    eglBindAPI(EGL_OPENGL_ES_API);
+#elif defined(OPENGL_ES)
+    EGLint renderableType = EGL_OPENGL_ES_BIT;
+    eglBindAPI(EGL_OPENGL_ES_API);
+#else
+    EGLint renderableType = EGL_OPENGL_BIT;
+    eglBindAPI(EGL_OPENGL_API);
+#endif
+
+    EGLint attribList[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, renderableType,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+
+    EGLint numConfig;
+    if(!eglChooseConfig(m_eglDisplay, attribList, &m_eglConfig, 1, &numConfig) || numConfig == 0)
+        g_logger.fatal("No suitable EGL pbuffer config found");
+
+#ifdef OPENGL_ES
+    EGLint contextAtrrList[] = {
+        EGL_CONTEXT_CLIENT_VERSION, OPENGL_ES,
+        EGL_NONE
+    };
+#else
+    EGLint contextAtrrList[] = {
+        EGL_NONE
+    };
+#endif
+
+    m_eglContext = eglCreateContext(m_eglDisplay, m_eglConfig, EGL_NO_CONTEXT, contextAtrrList);
+    if(m_eglContext == EGL_NO_CONTEXT)
+        g_logger.fatal(stdext::format("Unable to create EGL context: 0x%x", eglGetError()));
+}
+
+void HeadlessWindow::internalCreateSurface()
+{
+    EGLint attribList[] = {
+        EGL_WIDTH, m_size.width(),
+        EGL_HEIGHT, m_size.height(),
+        EGL_NONE
+    };
+
+    m_eglSurface = eglCreatePbufferSurface(m_eglDisplay, m_eglConfig, attribList);
+    if(m_eglSurface == EGL_NO_SURFACE)
+        g_logger.fatal(stdext::format("Unable to create EGL pbuffer: 0x%x", eglGetError()));
+
+    if(!eglMakeCurrent(m_eglDisplay, m_eglSurface, m_eglSurface, m_eglContext))
+        g_logger.fatal(stdext::format("Unable to connect EGL context: 0x%x", eglGetError()));
+}
+
+void HeadlessWindow::internalDestroySurface()
+{
+    if(m_eglSurface == EGL_NO_SURFACE)
+        return;
+    eglDestroySurface(m_eglDisplay, m_eglSurface);
+    m_eglSurface = EGL_NO_SURFACE;
+}
+
+void HeadlessWindow::move(const Point& pos)
+{
+    m_position = pos;
+}
+
+void HeadlessWindow::resize(const Size& size)
+{
+    if (std::this_thread::get_id() != g_mainThreadId) {
+        g_graphicsDispatcher.addEvent(std::bind(&HeadlessWindow::resize, this, size));
+        return;
+    }
+
+    if(size.width() < m_minimumSize.width() || size.height() < m_minimumSize.height() || size == m_size)
+        return;
+
+    // a pbuffer can't be resized, it's replaced by a new one
+    m_size = size;
+    eglMakeCurrent(m_eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    internalDestroySurface();
+    internalCreateSurface();
+    if(m_onResize)
+        m_onResize(m_size);
+}
+
+void HeadlessWindow::show()
+{
+    m_visible = true;
+    m_focused = true;
+}
+
+void HeadlessWindow::hide()
+{
+    m_visible = false;
+}
+
+void HeadlessWindow::minimize()
+{
+}
+
+void HeadlessWindow::maximize()
+{
+    m_maximized = true;
+}
+
+void HeadlessWindow::poll()
+{
+    AutoStat s(STATS_ZONE(STATS_RENDER, "PollWindow"));
+    fireKeysPress();
+}
+
+void HeadlessWindow::swapBuffers()
+{
+    // wait for the software rasterizer, otherwise frame times would only measure command submission
+    glFinish();
+    eglSwapBuffers(m_eglDisplay, m_eglSurface);
+}
+
+#endif
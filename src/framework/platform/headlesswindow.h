@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef HEADLESSWINDOW_H
+#define HEADLESSWINDOW_H
+
+#include "platformwindow.h"
+#include <framework/graphics/glutil.h>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+// Window-less platform used by HEADLESS builds. Renders into an EGL pbuffer of a surfaceless display,
+// so the client runs on machines without a display or gpu (mesa llvmpipe), for frame time benchmarks.
+class HeadlessWindow : public PlatformWindow
+{
+    void internalCreateGLContext();
+    void internalCreateSurface();
+    void internalDestroySurface();
+
+public:
+    HeadlessWindow();
+
+    void init();
+    void terminate();
+
+    void move(const Point& pos);
+    void resize(const Size& size);
+    void show();
+    void hide();
+    void minimize();
+    void maximize();
+    void poll();
+    void swapBuffers();
+    void showMouse() {}
+    void hideMouse() {}
+
+    void setMouseCursor(int cursorId) {}
+    void restoreMouseCursor() {}
+
+    void setTitle(const std::string& title) {}
+    void setMinimumSize(const Size& minimumSize) { m_minimumSize = minimumSize; }
+    void setFullscreen(bool fullscreen) { m_fullscreen = fullscreen; }
+    void setVerticalSync(bool enable) {} // frames are never paced
+    void setIcon(const std::string& iconFile) {}
+    void setClipboardText(const std::string& text) { m_clipboardText = text; }
+
+    Size getDisplaySize() { return m_size; }
+    std::string getClipboardText() { return m_clipboardText; }
+    std::string getPlatformType() { return "HEADLESS-EGL"; }
+
+protected:
+    int internalLoadMouseCursor(const ImagePtr& image, const Point& hotSpot) { return -1; }
+
+private:
+    EGLDisplay m_eglDisplay;
+    EGLConfig m_eglConfig;
+    EGLContext m_eglContext;
+    EGLSurface m_eglSurface;
+    std::string m_clipboardText;
+};
+
+#endif
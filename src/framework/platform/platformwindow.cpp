@@ -30,6 +30,9 @@ WIN32Window window;
 #elif defined(__EMSCRIPTEN__)
 #include "sdlwindow.h"
 SDLWindow window;
+#elif defined(HEADLESS)
+#include "headlesswindow.h"
+HeadlessWindow window;
 #else
 #include "x11window.h"
 #include <framework/core/clock.h>
@@ -570,7 +570,7 @@ void WIN32Window::minimize()
 
 void WIN32Window::poll()
 {
-    AutoStat s(STATS_RENDER, "PollWindow");
+    AutoStat s(STATS_ZONE(STATS_RENDER, "PollWindow"));
 
     MSG msg;
     while(PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
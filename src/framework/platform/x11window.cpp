@@ -20,7 +20,7 @@
  * THE SOFTWARE.
  */
 
-#if !defined(WIN32) && !defined(__EMSCRIPTEN__)
+#if !defined(WIN32) && !defined(__EMSCRIPTEN__) && !defined(HEADLESS)
 
 #include <framework/global.h>
 #include "x11window.h"
@@ -606,7 +606,7 @@ void X11Window::maximize()
 
 void X11Window::poll()
 {
-    AutoStat s(STATS_RENDER, "PollWindow");
+    AutoStat s(STATS_ZONE(STATS_RENDER, "PollWindow"));
     bool needsResizeUpdate = false;
 
     XEvent event, peekEvent;
@@ -89,7 +89,7 @@ void SoundManager::terminate()
 
 void SoundManager::poll()
 {
-    AutoStat s(STATS_MAIN, "PollSounds");
+    AutoStat s(STATS_ZONE(STATS_MAIN, "PollSounds"));
 
     static ticks_t lastUpdate = 0;
     ticks_t now = g_clock.millis();
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2010-2017 OTClient <https://github.com/edubart/otclient>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef STDEXT_POOL_ALLOCATOR_H
+#define STDEXT_POOL_ALLOCATOR_H
+
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace stdext {
+
+// Allocator for objects that are created and released all the time. The memory of released
+// single objects is kept for the next allocations of the same type, up to max_free of them.
+// The pool is shared by every thread and never released.
+template<typename T, size_t max_free = 4096>
+class pool_allocator {
+public:
+    using value_type = T;
+    template<typename U>
+    struct rebind { using other = pool_allocator<U, max_free>; };
+
+    pool_allocator() = default;
+    template<typename U>
+    pool_allocator(const pool_allocator<U, max_free>&) { }
+
+    T* allocate(size_t n) {
+        if(n == 1) {
+            std::lock_guard<std::mutex> lock(get_mutex());
+            std::vector<void*>& blocks = get_free_blocks();
+            if(!blocks.empty()) {
+                void* block = blocks.back();
+                blocks.pop_back();
+                return static_cast<T*>(block);
+            }
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t n) {
+        if(n == 1) {
+            std::lock_guard<std::mutex> lock(get_mutex());
+            std::vector<void*>& blocks = get_free_blocks();
+            if(blocks.size() < max_free) {
+                blocks.push_back(ptr);
+                return;
+            }
+        }
+        ::operator delete(ptr);
+    }
+
+    template<typename U>
+    bool operator==(const pool_allocator<U, max_free>&) const { return true; }
+    template<typename U>
+    bool operator!=(const pool_allocator<U, max_free>&) const { return false; }
+
+private:
+    // leaked, objects may be released by destructors of globals
+    static std::mutex& get_mutex() { static std::mutex* mutex = new std::mutex; return *mutex; }
+    static std::vector<void*>& get_free_blocks() { static std::vector<void*>* blocks = new std::vector<void*>; return *blocks; }
+};
+
+}
+
+#endif
@@ -56,6 +56,7 @@ void UIManager::terminate()
     for(auto& widget : m_pressedWidget)
         widget = nullptr;
     m_styles.clear();
+    m_compiledStyles.clear();
     m_destroyedWidgets.clear();
     m_checkEvent = nullptr;
     m_vars.clear();
@@ -335,7 +336,7 @@ void UIManager::onWidgetDisappear(const UIWidgetPtr& widget)
 
 void UIManager::onWidgetDestroy(const UIWidgetPtr& widget)
 {
-    AutoStat s(STATS_MAIN, "UIManager::onWidgetDestroy", stdext::format("%s (%s)", widget->getId(), widget->getParent() ? widget->getParent()->getId() : ""));
+    AutoStat s(STATS_ZONE(STATS_MAIN, "UIManager::onWidgetDestroy"), stdext::format("%s (%s)", widget->getId(), widget->getParent() ? widget->getParent()->getId() : ""));
 
     // release input grabs
     if(m_keyboardReceiver == widget)
@@ -386,6 +387,7 @@ void UIManager::onWidgetDestroy(const UIWidgetPtr& widget)
 void UIManager::clearStyles()
 {
     m_styles.clear();
+    m_compiledStyles.clear();
 }
 
 bool UIManager::importStyle(std::string file)
@@ -466,6 +468,9 @@ void UIManager::importStyleFromOTML(const OTMLNodePtr& styleNode)
         style->merge(styleNode);
         style->setTag(name);
         m_styles[name] = style;
+
+        // the compiled styles may derive from it
+        m_compiledStyles.clear();
     }
 }
 
@@ -569,6 +574,14 @@ UIWidgetPtr UIManager::createWidget(const std::string& styleName, const UIWidget
 }
 
 UIWidgetPtr UIManager::createWidgetFromOTML(const OTMLNodePtr& widgetNode, const UIWidgetPtr& parent)
+{
+    // a node without properties and children only names its style, which is compiled only once
+    if(widgetNode->size() == 0)
+        return createWidgetFromStyle(getCompiledStyle(widgetNode->tag()), parent);
+    return createWidgetFromStyle(compileStyle(widgetNode), parent);
+}
+
+UIManager::CompiledStylePtr UIManager::compileStyle(const OTMLNodePtr& widgetNode)
 {
     OTMLNodePtr originalStyleNode = getStyle(widgetNode->tag());
     if(!originalStyleNode)
@@ -577,26 +590,50 @@ UIWidgetPtr UIManager::createWidgetFromOTML(const OTMLNodePtr& widgetNode, const
     OTMLNodePtr styleNode = originalStyleNode->clone();
     styleNode->merge(widgetNode);
 
-    std::string widgetType = styleNode->valueAt("__class");
+    CompiledStylePtr style = std::make_shared<CompiledStyle>();
+    style->widgetClass = styleNode->valueAt("__class");
+    for(const OTMLNodePtr& childNode : styleNode->children()) {
+        if(!childNode->isUnique()) {
+            style->children.push_back(compileStyle(childNode));
+            styleNode->removeChild(childNode);
+        } else if(childNode->tag()[0] == '!')
+            style->dynamic = true;
+    }
+    style->properties = styleNode;
+    return style;
+}
 
+UIManager::CompiledStylePtr UIManager::getCompiledStyle(const std::string& styleName)
+{
+    auto it = m_compiledStyles.find(styleName);
+    if(it != m_compiledStyles.end())
+        return it->second;
+
+    CompiledStylePtr style = compileStyle(OTMLNode::create(styleName));
+    m_compiledStyles[styleName] = style;
+    return style;
+}
+
+UIWidgetPtr UIManager::createWidgetFromStyle(const CompiledStylePtr& style, const UIWidgetPtr& parent)
+{
     // call widget creation from lua
-    UIWidgetPtr widget = g_lua.callGlobalField<UIWidgetPtr>(widgetType, "create");
+    UIWidgetPtr widget = g_lua.callGlobalField<UIWidgetPtr>(style->widgetClass, "create");
     if(parent)
         parent->addChild(widget);
 
     if(widget) {
         widget->callLuaField("onCreate");
 
-        widget->setStyleFromNode(styleNode);
+        // the ! tags are replaced by their values when applied
+        if(style->dynamic)
+            widget->setStyleFromNode(style->properties->clone());
+        else
+            widget->setSharedStyle(style->properties);
 
-        for(const OTMLNodePtr& childNode : styleNode->children()) {
-            if(!childNode->isUnique()) {
-                createWidgetFromOTML(childNode, widget);
-                styleNode->removeChild(childNode);
-            }
-        }
+        for(const CompiledStylePtr& child : style->children)
+            createWidgetFromStyle(child, widget);
     } else
-        stdext::throw_exception(stdext::format("unable to create widget of type '%s'", widgetType));
+        stdext::throw_exception(stdext::format("unable to create widget of type '%s'", style->widgetClass));
 
     widget->callLuaField("onSetup");
 
@@ -111,6 +111,19 @@ protected:
     friend class UIWidget;
 
 private:
+    // a style resolved once with all its bases and widget node, its properties are shared by the widgets created from it
+    struct CompiledStyle {
+        std::string widgetClass;
+        OTMLNodePtr properties; // without the child widgets, must never be modified
+        std::vector<std::shared_ptr<CompiledStyle>> children;
+        bool dynamic = false; // has ! tags, they are evaluated for each widget in a copy of the properties
+    };
+    typedef std::shared_ptr<CompiledStyle> CompiledStylePtr;
+
+    CompiledStylePtr compileStyle(const OTMLNodePtr& widgetNode);
+    CompiledStylePtr getCompiledStyle(const std::string& styleName);
+    UIWidgetPtr createWidgetFromStyle(const CompiledStylePtr& style, const UIWidgetPtr& parent);
+
     UIWidgetPtr m_rootWidget;
     UIWidgetPtr m_mouseReceiver;
     UIWidgetPtr m_keyboardReceiver;
@@ -122,6 +135,7 @@ private:
     stdext::boolean<false> m_hoverTextUpdateScheduled;
     stdext::boolean<false> m_drawDebugBoxes;
     std::unordered_map<std::string, OTMLNodePtr> m_styles;
+    std::unordered_map<std::string, CompiledStylePtr> m_compiledStyles;
     OTUIVars m_vars;
     UIWidgetList m_destroyedWidgets;
     ScheduledEventPtr m_checkEvent;
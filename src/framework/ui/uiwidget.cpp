@@ -581,6 +581,10 @@ void UIWidget::unlockChild(const UIWidgetPtr& child)
 void UIWidget::mergeStyle(const OTMLNodePtr& styleNode)
 {
     applyStyle(styleNode);
+    if(m_sharedStyle) {
+        m_style = m_style->clone();
+        m_sharedStyle = false;
+    }
     std::string name = m_style->tag();
     std::string source = m_style->source();
     m_style->merge(styleNode);
@@ -605,7 +609,7 @@ void UIWidget::applyStyle(const OTMLNodePtr& styleNode)
                 std::string tag = node->tag().substr(1);
                 std::string code = stdext::format("tostring(%s)", node->value());
                 std::string origin = std::string("@") + node->source() + ": [" + node->tag() + "]";
-                g_lua.evaluateExpression(code, origin);
+                g_lua.evaluateCompiledExpression(code, origin);
                 std::string value = g_lua.popString();
 
                 node->setTag(tag);
@@ -992,6 +996,7 @@ void UIWidget::setStyle(const std::string& styleName)
     styleNode = styleNode->clone();
     applyStyle(styleNode);
     m_style = styleNode;
+    m_sharedStyle = false;
     updateStyle();
 }
 
@@ -999,6 +1004,15 @@ void UIWidget::setStyleFromNode(const OTMLNodePtr& styleNode)
 {
     applyStyle(styleNode);
     m_style = styleNode;
+    m_sharedStyle = false;
+    updateStyle();
+}
+
+void UIWidget::setSharedStyle(const OTMLNodePtr& styleNode)
+{
+    applyStyle(styleNode);
+    m_style = styleNode;
+    m_sharedStyle = true;
     updateStyle();
 }
 
@@ -1490,6 +1504,28 @@ void UIWidget::updateChildrenIndexStates()
     }
 }
 
+// the states of a "$state !state" tag, with true for the negated ones, parsed only once for each tag
+static const std::vector<std::pair<Fw::WidgetState, bool>>& parseStyleStates(const std::string& tag)
+{
+    static std::unordered_map<std::string, std::vector<std::pair<Fw::WidgetState, bool>>> cache;
+    auto it = cache.find(tag);
+    if(it != cache.end())
+        return it->second;
+
+    std::vector<std::pair<Fw::WidgetState, bool>> states;
+    for(std::string stateStr : stdext::split(tag.substr(1), " ")) {
+        if(stateStr.length() == 0)
+            continue;
+
+        bool notstate = (stateStr[0] == '!');
+        if(notstate)
+            stateStr = stateStr.substr(1);
+
+        states.emplace_back(Fw::translateState(stateStr), notstate);
+    }
+    return cache.emplace(tag, std::move(states)).first->second;
+}
+
 void UIWidget::updateStyle()
 {
     if(m_destroyed)
@@ -1521,19 +1557,9 @@ void UIWidget::updateStyle()
     // checks for states combination
     for(const OTMLNodePtr& style : m_style->children()) {
         if(stdext::starts_with(style->tag(), "$")) {
-            std::string statesStr = style->tag().substr(1);
-            std::vector<std::string> statesSplit = stdext::split(statesStr, " ");
-
             bool match = true;
-            for(std::string stateStr : statesSplit) {
-                if(stateStr.length() == 0)
-                    continue;
-
-                bool notstate = (stateStr[0] == '!');
-                if(notstate)
-                    stateStr = stateStr.substr(1);
-
-                bool stateOn = hasState(Fw::translateState(stateStr));
+            for(const auto& [state, notstate] : parseStyleStates(style->tag())) {
+                bool stateOn = hasState(state);
                 if((!notstate && !stateOn) || (notstate && stateOn))
                     match = false;
             }
@@ -99,6 +99,7 @@ protected:
     std::map<UIWidgetPtr, std::string> m_childrenShortcuts;
     UIWidgetPtr m_focusedChild;
     OTMLNodePtr m_style;
+    stdext::boolean<false> m_sharedStyle;
     Timer m_clickTimer;
     Fw::FocusReason m_lastFocusReason;
     Fw::AutoFocusPolicy m_autoFocusPolicy;
@@ -147,6 +148,8 @@ public:
     bool setRect(const Rect& rect);
     void setStyle(const std::string& styleName);
     void setStyleFromNode(const OTMLNodePtr& styleNode);
+    /// Same as setStyleFromNode, but the node is shared with other widgets and it is copied before being modified
+    void setSharedStyle(const OTMLNodePtr& styleNode);
     void setEnabled(bool enabled);
     void setVisible(bool visible);
     void setAutoDraw(bool value);
@@ -24,6 +24,8 @@ public:
         DEFINE_OPTION(debugWidgets, "Debug widgets");
 
         DEFINE_OPTION(disablePredictiveWalking, "Disable predictive walking");
+        DEFINE_OPTION(batchDraws, "Batch draws by texture");
+        DEFINE_OPTION(parallelMapDraw, "Draw map floors in parallel");
     }
 
     bool botDetection = default_value;
@@ -39,6 +41,8 @@ public:
     bool disablePredictiveWalking = false;
     bool showPredictions = false;
     bool debugWidgets = false;
+    bool batchDraws = false;
+    bool parallelMapDraw = false;
 
     int testMode = 0;
 
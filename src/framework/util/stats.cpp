@@ -3,29 +3,212 @@
 #include <sstream>
 #include <iomanip>
 #include <map>
+#include <algorithm>
 #include <framework/stdext/time.h>
 #include <framework/ui/uiwidget.h>
 #include <framework/ui/ui.h>
 
 Stats g_stats;
 
-void Stats::add(int type, Stat* stat) {
+namespace {
+
+const char* statsTypeNames[STATS_LAST + 1] = { "general", "main", "render", "dispatcher", "lua", "luacallback", "packets" };
+
+struct StatsBufferHolder {
+    StatsBufferPtr buffer;
+    ~StatsBufferHolder() {
+        if (buffer)
+            buffer->retired = true;
+    }
+};
+
+struct CachedZone {
+    uint32_t zone;
+    int type;
+    std::string name;
+};
+
+thread_local StatsBufferHolder t_statsBuffer;
+thread_local std::unordered_multimap<size_t, CachedZone> t_zoneCache;
+
+size_t zoneHash(int type, std::string_view prefix, std::string_view name)
+{
+    std::hash<std::string_view> hash;
+    return (hash(prefix) * 31 + hash(name)) ^ (size_t)type;
+}
+
+void writeJsonString(std::ostream& out, const std::string& str)
+{
+    out << '"';
+    for (char c : str) {
+        if (c == '"' || c == '\\')
+            out << '\\' << c;
+        else if ((unsigned char)c < 0x20)
+            out << ' ';
+        else
+            out << c;
+    }
+    out << '"';
+}
+
+}
+
+uint32_t Stats::registerZone(int type, const std::string& name)
+{
+    if (type < 0 || type > STATS_LAST)
+        return INVALID_STATS_ZONE;
+    std::lock_guard<std::mutex> lock(m_zonesMutex);
+    auto it = m_zoneIds[type].find(name);
+    if (it != m_zoneIds[type].end())
+        return it->second;
+    uint32_t zone = m_registeredZones.size();
+    m_registeredZones.push_back(StatsZone{ type, name });
+    m_zoneIds[type].emplace(name, zone);
+    return zone;
+}
+
+uint32_t Stats::getZone(int type, const std::string& name)
+{
+    size_t hash = zoneHash(type, std::string_view(), name);
+    auto range = t_zoneCache.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.type == type && it->second.name == name)
+            return it->second.zone;
+    }
+
+    uint32_t zone = registerZone(type, name);
+    t_zoneCache.emplace(hash, CachedZone{ zone, type, name });
+    return zone;
+}
+
+uint32_t Stats::getZone(int type, std::string_view prefix, std::string_view name)
+{
+    size_t hash = zoneHash(type, prefix, name);
+    auto range = t_zoneCache.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const std::string& cached = it->second.name;
+        if (it->second.type == type && cached.size() == prefix.size() + 1 + name.size() &&
+            cached.compare(0, prefix.size(), prefix) == 0 && cached[prefix.size()] == ':' &&
+            cached.compare(prefix.size() + 1, std::string::npos, name) == 0)
+            return it->second.zone;
+    }
+
+    std::string fullName;
+    fullName.reserve(prefix.size() + 1 + name.size());
+    fullName.append(prefix).append(1, ':').append(name);
+    uint32_t zone = registerZone(type, fullName);
+    t_zoneCache.emplace(hash, CachedZone{ zone, type, std::move(fullName) });
+    return zone;
+}
+
+void Stats::setEnabled(int type, bool enabled)
+{
     if (type < 0 || type > STATS_LAST)
         return;
+    m_enabled[type] = enabled;
+}
+
+StatsBuffer* Stats::createBuffer()
+{
+    auto buffer = std::make_shared<StatsBuffer>();
+    std::lock_guard<std::mutex> lock(m_buffersMutex);
+    buffer->thread = ++m_threads;
+    m_buffers.push_back(buffer);
+    t_statsBuffer.buffer = buffer;
+    return buffer.get();
+}
+
+void Stats::addEvent(uint32_t zone, ticks_t begin, ticks_t end, const std::string& extraDescription)
+{
+    if (zone == INVALID_STATS_ZONE)
+        return;
+
+    StatsBuffer* buffer = t_statsBuffer.buffer.get();
+    if (!buffer)
+        buffer = createBuffer();
+
+    // the ring only carries ids, slow zones with a description are stored right away
+    uint32_t flags = 0;
+    if (!extraDescription.empty() && end - begin > SLOW_TIME) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        addSlow(zone, end - begin, extraDescription);
+        flags = 1;
+    }
+
+    uint32_t head = buffer->head.load(std::memory_order_relaxed);
+    if (head - buffer->tail.load(std::memory_order_acquire) >= StatsBuffer::SIZE) {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    buffer->events[head & StatsBuffer::MASK] = StatsEvent{ zone, flags, begin, end };
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void Stats::collect()
+{
     std::lock_guard<std::mutex> lock(m_mutex);
+    drain();
+}
 
-    auto it = stats[type].data.emplace(stat->description, StatsData(0, 0, stat->extraDescription)).first;
-    it->second.calls += 1;
-    it->second.executionTime += stat->executionTime;
+void Stats::syncZones()
+{
+    std::lock_guard<std::mutex> lock(m_zonesMutex);
+    for (size_t i = m_zones.size(); i < m_registeredZones.size(); ++i)
+        m_zones.push_back(m_registeredZones[i]);
+}
 
-    if (stat->executionTime > 1000) {
-        if (stats[type].slow.size() > 10000) {
-            delete stats[type].slow.front();
-            stats[type].slow.pop_front();
+void Stats::drain()
+{
+    std::vector<StatsBufferPtr> buffers;
+    {
+        std::lock_guard<std::mutex> lock(m_buffersMutex);
+        buffers = m_buffers;
+    }
+    syncZones();
+
+    bool tracing = m_tracing;
+    bool removeRetired = false;
+    for (auto& buffer : buffers) {
+        bool retired = buffer->retired.load(std::memory_order_acquire);
+        uint32_t tail = buffer->tail.load(std::memory_order_relaxed);
+        uint32_t head = buffer->head.load(std::memory_order_acquire);
+        for (; tail != head; ++tail) {
+            const StatsEvent& event = buffer->events[tail & StatsBuffer::MASK];
+            if (event.zone >= m_zones.size())
+                syncZones();
+            StatsZone& zone = m_zones[event.zone];
+            uint64_t executionTime = event.end - event.begin;
+            zone.calls += 1;
+            zone.executionTime += executionTime;
+            if (executionTime > SLOW_TIME && !(event.flags & 1))
+                addSlow(event.zone, executionTime, "");
+            if (tracing && m_trace.size() < MAX_TRACE_EVENTS)
+                m_trace.push_back(StatsTraceEvent{ event.zone, buffer->thread, event.begin, event.end });
         }
-        stats[type].slow.push_back(stat);
-    } else
-        delete stat;
+        buffer->tail.store(tail, std::memory_order_release);
+        m_droppedEvents += buffer->dropped.exchange(0);
+        removeRetired |= retired;
+    }
+
+    if (removeRetired) {
+        std::lock_guard<std::mutex> lock(m_buffersMutex);
+        m_buffers.erase(std::remove_if(m_buffers.begin(), m_buffers.end(), [](const StatsBufferPtr& buffer) {
+            return buffer->retired && buffer->tail == buffer->head;
+        }), m_buffers.end());
+    }
+}
+
+void Stats::addSlow(uint32_t zone, uint64_t executionTime, const std::string& extraDescription)
+{
+    int type;
+    {
+        std::lock_guard<std::mutex> lock(m_zonesMutex);
+        type = m_registeredZones[zone].type;
+    }
+    auto& slow = stats[type].slow;
+    if (slow.size() > MAX_SLOW)
+        slow.pop_front();
+    slow.push_back(SlowStat{ zone, executionTime, extraDescription });
 }
 
 std::string Stats::get(int type, int limit, bool pretty) {
@@ -33,14 +216,18 @@ std::string Stats::get(int type, int limit, bool pretty) {
         return "";
 
     std::lock_guard<std::mutex> lock(m_mutex);
-    std::multimap<uint64_t, StatsMap::const_iterator> sorted_stats;
+    drain();
+
+    std::multimap<uint64_t, const StatsZone*> sorted_stats;
     
     uint64_t total_time = 0;
     uint64_t time_from_start = (stdext::micros() - stats[type].start);
 
-    for (auto it = stats[type].data.cbegin(); it != stats[type].data.cend(); ++it) {
-        sorted_stats.emplace(it->second.executionTime, it);
-        total_time += it->second.executionTime;
+    for (const StatsZone& zone : m_zones) {
+        if (zone.type != type || zone.calls == 0)
+            continue;
+        sorted_stats.emplace(zone.executionTime, &zone);
+        total_time += zone.executionTime;
     }
 
     if (total_time == 0 || time_from_start == 0)
@@ -57,12 +244,13 @@ std::string Stats::get(int type, int limit, bool pretty) {
     for (auto it = sorted_stats.rbegin(); it != sorted_stats.rend(); ++it) {
         if (i++ > limit)
             break;
+        const StatsZone& zone = *it->second;
         if (pretty) {
-            std::string name = it->second->first.substr(0, 45);
-            ret << name << std::setw(50 - name.size()) << it->second->second.calls << std::setw(10) << (it->second->second.executionTime / 1000)
-                << std::setw(10) << ((it->second->second.executionTime * 100) / (total_time)) << std::setw(10) << ((it->second->second.executionTime * 100) / (time_from_start)) << "\n";
+            std::string name = zone.name.substr(0, 45);
+            ret << name << std::setw(50 - name.size()) << zone.calls << std::setw(10) << (zone.executionTime / 1000)
+                << std::setw(10) << ((zone.executionTime * 100) / (total_time)) << std::setw(10) << ((zone.executionTime * 100) / (time_from_start)) << "\n";
         } else {
-            ret << it->second->first << "|" << it->second->second.calls << "|" << it->second->second.executionTime << "\n";
+            ret << zone.name << "|" << zone.calls << "|" << zone.executionTime << "\n";
         }
     }
 
@@ -73,23 +261,39 @@ void Stats::clear(int type) {
     if (type < 0 || type > STATS_LAST)
         return;
     std::lock_guard<std::mutex> lock(m_mutex);
+    drain();
     stats[type].start = stdext::micros();
-    stats[type].data.clear();
+    for (StatsZone& zone : m_zones) {
+        if (zone.type != type)
+            continue;
+        zone.calls = 0;
+        zone.executionTime = 0;
+    }
 }
 
 void Stats::clearAll() {
     std::lock_guard<std::mutex> lock(m_mutex);
-    for (int i = 0; i <= STATS_LAST; ++i) {
-        stats[i].data.clear();
-        stats[i].slow.clear();
+    drain();
+    for (StatsZone& zone : m_zones) {
+        zone.calls = 0;
+        zone.executionTime = 0;
     }
+    for (int i = 0; i <= STATS_LAST; ++i)
+        stats[i].slow.clear();
     resetSleepTime();
+    asyncThingTextures = 0;
+    asyncThingTexturesTime = 0;
+    syncThingTextures = 0;
+    syncThingTexturesTime = 0;
+    maxSyncThingTextureTime = 0;
+    thingTextureMisses = 0;
 }
 
 std::string Stats::getSlow(int type, int limit, unsigned int minTime, bool pretty) {
     if (type < 0 || type > STATS_LAST)
         return "";
     std::lock_guard<std::mutex> lock(m_mutex);
+    drain();
 
     std::stringstream ret;
 
@@ -102,15 +306,16 @@ std::string Stats::getSlow(int type, int limit, unsigned int minTime, bool prett
     minTime *= 1000;
 
     for (auto it = stats[type].slow.rbegin(); it != stats[type].slow.rend(); ++it) {
-        if ((*it)->executionTime < (minTime))
+        if (it->executionTime < (minTime))
             continue;
         if (i++ > limit)
             break;
+        const std::string& description = m_zones[it->zone].name;
         if (pretty) {
-            std::string name = (*it)->description.substr(0, 45);
-            ret << name << std::setw(50 - name.size()) << (*it)->executionTime / 1000 << std::setw(20) << (*it)->extraDescription << "\n";
+            std::string name = description.substr(0, 45);
+            ret << name << std::setw(50 - name.size()) << it->executionTime / 1000 << std::setw(20) << it->extraDescription << "\n";
         } else {
-            ret << (*it)->description << "|" << (*it)->executionTime << "|" << (*it)->extraDescription << "\n";
+            ret << description << "|" << it->executionTime << "|" << it->extraDescription << "\n";
         }
     }
 
@@ -121,11 +326,54 @@ void Stats::clearSlow(int type) {
     if (type < 0 || type > STATS_LAST)
         return;
     std::lock_guard<std::mutex> lock(m_mutex);
-    for (auto& stat : stats[type].slow)
-        delete stat;
+    drain();
     stats[type].slow.clear();
 }
 
+void Stats::startTrace()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    drain();
+    m_trace.clear();
+    m_droppedEvents = 0;
+    m_tracing = true;
+}
+
+void Stats::stopTrace()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    drain();
+    m_tracing = false;
+}
+
+bool Stats::saveTrace(const std::string& file)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    drain();
+
+    std::ofstream out(file, std::ios::out | std::ios::trunc);
+    if (!out.is_open())
+        return false;
+
+    std::set<uint32_t> threads;
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (const StatsTraceEvent& event : m_trace) {
+        const StatsZone& zone = m_zones[event.zone];
+        out << (first ? "" : ",\n") << "{\"name\":";
+        writeJsonString(out, zone.name);
+        out << ",\"cat\":\"" << statsTypeNames[zone.type] << "\",\"ph\":\"X\",\"ts\":" << event.begin << ",\"dur\":" << (event.end - event.begin)
+            << ",\"pid\":1,\"tid\":" << event.thread << "}";
+        threads.insert(event.thread);
+        first = false;
+    }
+    for (uint32_t thread : threads) {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread << ",\"args\":{\"name\":\"thread " << thread << "\"}}";
+        first = false;
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEvents\":" << m_droppedEvents << "}}\n";
+    return out.good();
+}
 
 void Stats::addWidget(UIWidget* widget)
 {
@@ -165,6 +413,163 @@ void printNode(std::stringstream& ret, WidgetTreeNode& node, int depth, int limi
     }
 }
 
+void Stats::addThingTextureBake(bool async, uint64_t microseconds)
+{
+    if (async) {
+        asyncThingTextures += 1;
+        asyncThingTexturesTime += microseconds;
+        return;
+    }
+
+    syncThingTextures += 1;
+    syncThingTexturesTime += microseconds;
+    uint64_t maxTime = maxSyncThingTextureTime.load();
+    while (microseconds > maxTime && !maxSyncThingTextureTime.compare_exchange_weak(maxTime, microseconds));
+}
+
+std::string Stats::getThingTexturesInfo(bool pretty)
+{
+    std::stringstream ret;
+    if (pretty) {
+        ret << "Async bakes: " << asyncThingTextures << " (" << asyncThingTexturesTime / 1000 << " ms)\n";
+        ret << "Sync bakes: " << syncThingTextures << " (" << syncThingTexturesTime / 1000 << " ms, max " << maxSyncThingTextureTime << " us)\n";
+        ret << "Draws without texture: " << thingTextureMisses << "\n";
+    } else {
+        ret << asyncThingTextures << "|" << asyncThingTexturesTime << "|" << syncThingTextures << "|" << syncThingTexturesTime << "|"
+            << maxSyncThingTextureTime << "|" << thingTextureMisses << "\n";
+    }
+    return ret.str();
+}
+
+void Stats::addFrameDraws(uint32_t calls, uint32_t binds, uint32_t cacheFlushes)
+{
+    uint32_t batched = batchedDraws.exchange(0);
+    frameDrawCalls = calls;
+    frameTextureBinds = binds;
+    frameCacheFlushes = cacheFlushes;
+    frameBatchedDraws = batched;
+    drawFrames += 1;
+    totalDrawCalls += calls;
+    totalTextureBinds += binds;
+    totalCacheFlushes += cacheFlushes;
+    totalBatchedDraws += batched;
+}
+
+std::string Stats::getDrawsInfo(bool pretty)
+{
+    uint32_t frames = std::max<uint32_t>(1, drawFrames);
+    std::stringstream ret;
+    if (pretty) {
+        ret << "Draw calls: " << frameDrawCalls << " (avg " << totalDrawCalls / frames << ")\n";
+        ret << "Texture binds: " << frameTextureBinds << " (avg " << totalTextureBinds / frames << ")\n";
+        ret << "Cache flushes: " << frameCacheFlushes << " (avg " << totalCacheFlushes / frames << ")\n";
+        ret << "Batched draws: " << frameBatchedDraws << " (avg " << totalBatchedDraws / frames << ")\n";
+    } else {
+        ret << frameDrawCalls << "|" << frameTextureBinds << "|" << frameCacheFlushes << "|" << frameBatchedDraws << "|"
+            << drawFrames << "|" << totalDrawCalls << "|" << totalTextureBinds << "|" << totalCacheFlushes << "|" << totalBatchedDraws << "\n";
+    }
+    return ret.str();
+}
+
+void Stats::resetDraws()
+{
+    drawFrames = 0;
+    totalDrawCalls = 0;
+    totalTextureBinds = 0;
+    totalCacheFlushes = 0;
+    totalBatchedDraws = 0;
+}
+
+void Stats::addEventBatch(uint32_t size)
+{
+    eventBatches += 1;
+    uint32_t max = maxEventBatch;
+    while (size > max && !maxEventBatch.compare_exchange_weak(max, size));
+}
+
+std::string Stats::getEventsInfo(bool pretty)
+{
+    std::stringstream ret;
+    if (pretty) {
+        ret << "Posted: " << eventPosts << " in " << eventBatches << " batches (max " << maxEventBatch << ")\n";
+        ret << "Contended: " << contendedEventPosts << " (" << eventPostRetries << " retries)\n";
+    } else {
+        ret << eventPosts << "|" << eventBatches << "|" << maxEventBatch << "|" << contendedEventPosts << "|" << eventPostRetries << "\n";
+    }
+    return ret.str();
+}
+
+void Stats::resetEvents()
+{
+    eventPosts = 0;
+    contendedEventPosts = 0;
+    eventPostRetries = 0;
+    eventBatches = 0;
+    maxEventBatch = 0;
+}
+
+void Stats::addFrameTime(int type, uint64_t microseconds)
+{
+    if (type < 0 || type > STATS_LAST)
+        return;
+    std::lock_guard<std::mutex> lock(m_frameTimesMutex);
+    auto& frameTimes = m_frameTimes[type];
+    uint32_t sample = (uint32_t)std::min<uint64_t>(microseconds, 0xFFFFFFFF);
+    if (frameTimes.samples.size() < MAX_FRAME_TIMES)
+        frameTimes.samples.push_back(sample);
+    else
+        frameTimes.samples[frameTimes.next] = sample;
+    frameTimes.next = (frameTimes.next + 1) % MAX_FRAME_TIMES;
+}
+
+std::string Stats::getFrameTimesInfo(bool pretty)
+{
+    const int types[] = { STATS_MAIN, STATS_RENDER };
+    const int percentiles[] = { 50, 90, 95, 99 };
+
+    std::stringstream ret;
+    if (pretty)
+        ret << "Thread" << std::setw(12) << "Frames" << std::setw(10) << "p50 (us)" << std::setw(10) << "p90 (us)"
+            << std::setw(10) << "p95 (us)" << std::setw(10) << "p99 (us)" << std::setw(10) << "max (us)" << "\n";
+
+    for (int type : types) {
+        std::vector<uint32_t> samples;
+        {
+            std::lock_guard<std::mutex> lock(m_frameTimesMutex);
+            samples = m_frameTimes[type].samples;
+        }
+        std::sort(samples.begin(), samples.end());
+
+        const char* name = type == STATS_MAIN ? "main" : "render";
+        if (pretty)
+            ret << name << std::setw(18 - strlen(name)) << samples.size();
+        else
+            ret << name << "|" << samples.size();
+        for (int percentile : percentiles) {
+            uint32_t value = samples.empty() ? 0 : samples[std::min(samples.size() - 1, samples.size() * percentile / 100)];
+            if (pretty)
+                ret << std::setw(10) << value;
+            else
+                ret << "|" << value;
+        }
+        uint32_t max = samples.empty() ? 0 : samples.back();
+        if (pretty)
+            ret << std::setw(10) << max << "\n";
+        else
+            ret << "|" << max << "\n";
+    }
+    return ret.str();
+}
+
+void Stats::resetFrameTimes()
+{
+    std::lock_guard<std::mutex> lock(m_frameTimesMutex);
+    for (auto& frameTimes : m_frameTimes) {
+        frameTimes.samples.clear();
+        frameTimes.next = 0;
+    }
+}
+
 std::string Stats::getWidgetsInfo(int limit, bool pretty)
 {
     int unusedWidgets = 0;
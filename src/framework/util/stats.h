@@ -3,16 +3,21 @@
 #ifndef OTCLIENT_STATS_H
 #define OTCLIENT_STATS_H
 
-#include <list>
+#include <deque>
 #include <atomic>
+#include <memory>
 #include <mutex>
-#include <chrono>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 #include <set>
+#include <framework/stdext/time.h>
 
-// NOT THREAD SAFE
+// Zones and counters can be recorded from any thread. Widgets are only added and removed by the
+// dispatcher thread.
 
+// the Stats constants in modules/corelib/const.lua mirror these values
 enum StatsTypes{
     STATS_FIRST = 0,
     STATS_GENERAL = STATS_FIRST,
@@ -25,30 +30,70 @@ enum StatsTypes{
     STATS_LAST = STATS_PACKETS
 };
 
-struct Stat {
-    Stat(uint64_t _executionTime, const std::string& _description, const std::string& _extraDescription) :
-            executionTime(_executionTime), description(_description), extraDescription(_extraDescription) {};
-    uint64_t executionTime = 0;
-    std::string description;
-    std::string extraDescription;
+// zones are registered once per call site, timings go through per thread lock-free rings
+// and are only aggregated when somebody reads them (or once per frame)
+enum : uint32_t { INVALID_STATS_ZONE = 0xFFFFFFFF };
+
+struct StatsEvent {
+    uint32_t zone;
+    uint32_t flags;
+    int64_t begin;
+    int64_t end;
+};
+
+struct StatsBuffer {
+    enum : uint32_t { SIZE = 1 << 15, MASK = SIZE - 1 };
+
+    StatsEvent events[SIZE];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint32_t> dropped{0};
+    std::atomic<bool> retired{false};
+    uint32_t thread = 0;
 };
+using StatsBufferPtr = std::shared_ptr<StatsBuffer>;
 
-struct StatsData {
-    StatsData(uint32_t _calls, uint64_t _executionTime, const std::string& _extraInfo) :
-            calls(_calls), executionTime(_executionTime), extraInfo(_extraInfo) {}
+struct StatsZone {
+    int type;
+    std::string name;
     uint32_t calls = 0;
     uint64_t executionTime = 0;
-    std::string extraInfo;
 };
 
-using StatsMap = std::unordered_map<std::string, StatsData>;
-using StatsList = std::list<Stat*>;
+struct SlowStat {
+    uint32_t zone;
+    uint64_t executionTime;
+    std::string extraDescription;
+};
+
+struct StatsTraceEvent {
+    uint32_t zone;
+    uint32_t thread;
+    int64_t begin;
+    int64_t end;
+};
 
 class UIWidget;
 
 class Stats {
 public:
-    void add(int type, Stat* stats);
+    enum { SLOW_TIME = 1000, MAX_SLOW = 10000, MAX_TRACE_EVENTS = 1 << 20, MAX_FRAME_TIMES = 1 << 16 };
+
+    // registers the zone once, use STATS_ZONE for constant names
+    uint32_t registerZone(int type, const std::string& name);
+    // zones with runtime names, looked up in a per thread cache without allocating
+    uint32_t getZone(int type, const std::string& name);
+    uint32_t getZone(int type, std::string_view prefix, std::string_view name);
+
+    // zones of a disabled type aren't looked up nor timed, lua calls are too many to time them all the time
+    void setEnabled(int type, bool enabled);
+    bool isEnabled(int type) {
+        return type >= 0 && type <= STATS_LAST && (m_enabled[type].load(std::memory_order_relaxed) || m_tracing.load(std::memory_order_relaxed));
+    }
+
+    void addEvent(uint32_t zone, ticks_t begin, ticks_t end, const std::string& extraDescription);
+    // drains the thread buffers into the totals, called once per frame so they never fill up
+    void collect();
 
     std::string get(int type, int limit, bool pretty);
     void clear(int type);
@@ -82,13 +127,72 @@ public:
     inline void addCreature() { createdCreatures += 1; }
     inline void removeCreature() { destroyedCreatures += 1; }
 
+    // thing textures are baked on worker threads, synchronous bakes on the main thread are hitches
+    void addThingTextureBake(bool async, uint64_t microseconds);
+    inline void addThingTextureMiss() { thingTextureMisses += 1; }
+    std::string getThingTexturesInfo(bool pretty);
+
+    // gl work of the last rendered frame and the average since the last reset
+    void addFrameDraws(uint32_t calls, uint32_t binds, uint32_t cacheFlushes);
+    inline void addBatchedDraws(uint32_t count) { batchedDraws += count; }
+    std::string getDrawsInfo(bool pretty);
+    void resetDraws();
+
+    // events posted to the dispatchers, retries are posts that raced with posts from other threads
+    inline void addEventPost(uint32_t retries) {
+        eventPosts += 1;
+        if (retries) {
+            contendedEventPosts += 1;
+            eventPostRetries += retries;
+        }
+    }
+    // posted events taken at once by the polling thread
+    void addEventBatch(uint32_t size);
+    std::string getEventsInfo(bool pretty);
+    void resetEvents();
+
+    // frame times of the dispatcher (STATS_MAIN) and render (STATS_RENDER) threads, reported as percentiles
+    void addFrameTime(int type, uint64_t microseconds);
+    std::string getFrameTimesInfo(bool pretty);
+    void resetFrameTimes();
+
+    // chrome://tracing / perfetto json of every zone recorded between start and stop
+    void startTrace();
+    void stopTrace();
+    bool isTracing() { return m_tracing; }
+    bool saveTrace(const std::string& file);
+
 private:
+    StatsBuffer* createBuffer();
+    void syncZones();
+    void drain();
+    void addSlow(uint32_t zone, uint64_t executionTime, const std::string& extraDescription);
+
     struct {
-        StatsMap data;
-        StatsList slow;
+        std::deque<SlowStat> slow;
         int64_t start = 0;
     } stats[STATS_LAST + 1];
 
+    std::vector<StatsZone> m_zones;
+    std::vector<StatsTraceEvent> m_trace;
+    std::atomic<bool> m_tracing{false};
+    std::atomic<bool> m_enabled[STATS_LAST + 1] = { {true}, {true}, {true}, {true}, {false}, {true}, {true} };
+    uint32_t m_droppedEvents = 0;
+
+    std::vector<StatsZone> m_registeredZones;
+    std::unordered_map<std::string, uint32_t> m_zoneIds[STATS_LAST + 1];
+    std::mutex m_zonesMutex;
+
+    struct {
+        std::vector<uint32_t> samples;
+        size_t next = 0;
+    } m_frameTimes[STATS_LAST + 1];
+    std::mutex m_frameTimesMutex;
+
+    std::vector<StatsBufferPtr> m_buffers;
+    uint32_t m_threads = 0;
+    std::mutex m_buffersMutex;
+
     std::set<UIWidget*> widgets;
     int createdWidgets = 0;
     int destroyedWidgets = 0;
@@ -98,32 +202,52 @@ private:
     int destroyedThings = 0;
     int createdCreatures = 0;
     int destroyedCreatures = 0;
+    std::atomic<uint32_t> asyncThingTextures{0};
+    std::atomic<uint64_t> asyncThingTexturesTime{0};
+    std::atomic<uint32_t> syncThingTextures{0};
+    std::atomic<uint64_t> syncThingTexturesTime{0};
+    std::atomic<uint64_t> maxSyncThingTextureTime{0};
+    std::atomic<uint32_t> thingTextureMisses{0};
+    std::atomic<uint32_t> frameDrawCalls{0};
+    std::atomic<uint32_t> frameTextureBinds{0};
+    std::atomic<uint32_t> frameCacheFlushes{0};
+    std::atomic<uint32_t> frameBatchedDraws{0};
+    std::atomic<uint32_t> batchedDraws{0};
+    std::atomic<uint32_t> drawFrames{0};
+    std::atomic<uint64_t> totalDrawCalls{0};
+    std::atomic<uint64_t> totalTextureBinds{0};
+    std::atomic<uint64_t> totalCacheFlushes{0};
+    std::atomic<uint64_t> totalBatchedDraws{0};
+    std::atomic<uint64_t> eventPosts{0};
+    std::atomic<uint64_t> contendedEventPosts{0};
+    std::atomic<uint64_t> eventPostRetries{0};
+    std::atomic<uint64_t> eventBatches{0};
+    std::atomic<uint32_t> maxEventBatch{0};
     std::mutex m_mutex;
 };
 
 extern Stats g_stats;
 
+#define STATS_ZONE(type, name) ([]() -> uint32_t { static const uint32_t zone = g_stats.registerZone(type, name); return zone; }())
+
 class AutoStat {
 public:
-    AutoStat(int type, const std::string& description, const std::string& extraDescription = "") :
-            m_type(type), m_stat(new Stat(0, description, extraDescription)), m_timePoint(std::chrono::high_resolution_clock::now()) {}
+    AutoStat(uint32_t zone) : m_zone(zone), m_start(zone != INVALID_STATS_ZONE ? stdext::micros() : 0) {}
+    AutoStat(uint32_t zone, const std::string& extraDescription) :
+            m_zone(zone), m_start(zone != INVALID_STATS_ZONE ? stdext::micros() : 0), m_extraDescription(extraDescription) {}
 
     ~AutoStat() {
-        m_stat->executionTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - m_timePoint).count();
-        m_stat->executionTime -= m_minusTime;
-        g_stats.add(m_type, m_stat);
+        if (m_zone != INVALID_STATS_ZONE)
+            g_stats.addEvent(m_zone, m_start, stdext::micros(), m_extraDescription);
     }
 
     AutoStat(const AutoStat&) = delete;
     AutoStat & operator=(const AutoStat&) = delete;
 
 private:
-    int m_type;
-    Stat* m_stat;
-
-protected:
-    uint64_t m_minusTime = 0;
-    std::chrono::high_resolution_clock::time_point m_timePoint;
+    uint32_t m_zone;
+    ticks_t m_start;
+    std::string m_extraDescription;
 };
 
 #endif